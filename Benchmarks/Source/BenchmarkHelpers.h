@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    BenchmarkHelpers.h
+
+    ### Shared pieces of the benchmarks ###
+
+    - Timing: best of several rounds, so a busy machine only makes it slower
+    - A synthetic track: kick drum on every beat over a C major chord,
+      deterministic so every run measures the same audio
+    - A temporary folder that is the working directory while it exists, the
+      app's json files and caches land there instead of next to the binary
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+namespace Benchmark
+{
+    // Milliseconds per call, best of `rounds` rounds of `iterations` calls
+    template <typename Function>
+    double timeMs(int iterations, Function&& function, int rounds = 5)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int r = 0; r < rounds; ++r)
+        {
+            double start = Time::getMillisecondCounterHiRes();
+            for (int i = 0; i < iterations; ++i)
+                function();
+            best = jmin(best, (Time::getMillisecondCounterHiRes() - start) / iterations);
+        }
+        return best;
+    }
+
+    // Stereo, kick on every beat plus a quiet C major chord
+    inline AudioBuffer<float> makeTrack(double sampleRate, double seconds, double bpm = 124.0)
+    {
+        int numSamples = (int)(sampleRate * seconds);
+        AudioBuffer<float> track(2, numSamples);
+
+        const double chord[] = { 261.63, 329.63, 392.00 };
+        int beatSamples = (int)(sampleRate * 60.0 / bpm);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double t = i / sampleRate;
+            float sample = 0.0f;
+            for (double frequency : chord)
+                sample += 0.1f * (float)std::sin(MathConstants<double>::twoPi * frequency * t);
+
+            // Decaying 55 Hz thump at the start of each beat
+            double sinceBeat = (i % beatSamples) / sampleRate;
+            sample += 0.6f * (float)(std::exp(-sinceBeat * 30.0) * std::sin(MathConstants<double>::twoPi * 55.0 * sinceBeat));
+
+            track.setSample(0, i, sample);
+            track.setSample(1, i, sample);
+        }
+        return track;
+    }
+
+    inline AudioBuffer<float> toMono(const AudioBuffer<float>& buffer)
+    {
+        AudioBuffer<float> mono(1, buffer.getNumSamples());
+        mono.clear();
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            mono.addFrom(0, 0, buffer, ch, 0, buffer.getNumSamples(), 1.0f / buffer.getNumChannels());
+        return mono;
+    }
+
+    // Writes the buffer with the given format, metadata goes to formats that store it
+    inline bool writeAudioFile(const File& file, AudioFormat& format, const AudioBuffer<float>& buffer,
+        double sampleRate, int bitsPerSample, const StringPairArray& metadata = {})
+    {
+        file.deleteFile();
+        std::unique_ptr<OutputStream> stream(file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate,
+            (unsigned int)buffer.getNumChannels(), bitsPerSample, metadata, 0));
+        if (writer == nullptr)
+            return false;
+        stream.release(); // the writer owns it now
+
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    // Temporary working directory, deleted with everything in it
+    class TempFolder
+    {
+        public:
+            TempFolder(const String& name) :
+                folder(File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("OtoDecks" + name, "")),
+                previous(File::getCurrentWorkingDirectory())
+            {
+                folder.createDirectory();
+                folder.setAsCurrentWorkingDirectory();
+            }
+
+            ~TempFolder()
+            {
+                previous.setAsCurrentWorkingDirectory();
+                folder.deleteRecursively();
+            }
+
+            const File folder;
+
+        private:
+            const File previous;
+
+            JUCE_DECLARE_NON_COPYABLE(TempFolder)
+    };
+}
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    BlockCacheBenchmark.cpp
+
+    ### Hit rate of the decoded block cache ###
+
+    - A five minute FLAC read the way the app reads it: a deck playing the
+      first 30 s in 512-sample blocks while two scans (analysis and the
+      overview) read the whole file, then a second deck loading the same
+      track, then a scratch window around the playhead
+    - Logs the cache stats of every step, the playback hit rate and the
+      decodes per track load (every block decoded once is 1.0)
+    - The load must stay under 1.5 decodes per block; the second deck and
+      the scratch window must be served from the cache, so the scans did not
+      evict the deck's blocks
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/MappedAudioReader.h"
+#include "../../Source/DecodedBlockCache.h"
+#include "BenchmarkHelpers.h"
+
+class BlockCacheBenchmark : public UnitTest
+{
+    public:
+        BlockCacheBenchmark() : UnitTest("Decoded block cache hit rate", "Cache") {}
+
+        void runTest() override
+        {
+            // Keeps the cache alive between the readers
+            SharedResourcePointer<DecodedBlockCache> cache;
+
+            Benchmark::TempFolder temp("BlockCache");
+            File file = temp.folder.getChildFile("track.flac");
+            FlacAudioFormat flac;
+            expect(Benchmark::writeAudioFile(file, flac, Benchmark::makeTrack(sampleRate, trackSeconds), sampleRate, 24));
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            const int64 playedSamples = (int64)(sampleRate * playSeconds);
+
+            beginTest("Deck plays while two scans read the file");
+            {
+                auto before = cache->getStats();
+
+                // Analysis and overview, each with its own scan reader like the app
+                OwnedArray<AudioFormatReader> scanReaders;
+                OwnedArray<WaitableEvent> scansDone;
+                for (int i = 0; i < numScans; ++i)
+                {
+                    auto* scanReader = scanReaders.add(MappedAudioReader::createFor(URL(file), formatManager, true));
+                    auto* scanDone = scansDone.add(new WaitableEvent());
+                    expect(scanReader != nullptr);
+                    if (scanReader == nullptr) {
+                        scanDone->signal();
+                        continue;
+                    }
+                    Thread::launch([scanReader, scanDone] {
+                        AudioBuffer<float> chunk(2, 65536);
+                        for (int64 pos = 0; pos < scanReader->lengthInSamples; pos += chunk.getNumSamples())
+                            scanReader->read(&chunk, 0, chunk.getNumSamples(), pos, true, true);
+                        scanDone->signal();
+                    });
+                }
+
+                double ms = play(formatManager, file, 0, playedSamples);
+                for (auto* scanDone : scansDone)
+                    scanDone->wait(60000);
+
+                auto after = cache->getStats();
+                logStats("Deck + scans", before, after, ms);
+
+                // Every miss, deck or scan, is one decode of one block
+                int64 trackBlocks = (int64)(sampleRate * trackSeconds) / DecodedBlockCache::blockSize + 1;
+                int64 decodes = after.misses - before.misses + after.scanMisses - before.scanMisses;
+                double decodesPerLoad = (double)decodes / trackBlocks;
+                logMessage("Track load: " + String(decodes) + " decodes for " + String(trackBlocks) + " blocks, "
+                    + String(decodesPerLoad, 2) + " decodes per block");
+                expectLessThan(decodesPerLoad, 1.5);
+            }
+
+            beginTest("Second deck loads the same track");
+            {
+                auto before = cache->getStats();
+                double ms = play(formatManager, file, 0, playedSamples);
+                auto after = cache->getStats();
+                logStats("Second deck", before, after, ms);
+                expectEquals(after.misses - before.misses, (int64)0);
+            }
+
+            beginTest("Scratch window around the playhead");
+            {
+                auto before = cache->getStats();
+                int64 centre = playedSamples / 2, halfWindow = (int64)(sampleRate * 3.0);
+                double ms = play(formatManager, file, centre - halfWindow, centre + halfWindow);
+                auto after = cache->getStats();
+                logStats("Scratch window", before, after, ms);
+                expectEquals(after.misses - before.misses, (int64)0);
+            }
+
+            logMessage("Playback hit rate overall: " + String(100.0 * cache->getHitRate(), 1) + "%");
+        }
+
+    private:
+        // Reads [start, end) in device-sized blocks through a fresh reader, like a deck
+        double play(AudioFormatManager& formatManager, const File& file, int64 start, int64 end)
+        {
+            std::unique_ptr<AudioFormatReader> reader(MappedAudioReader::createFor(URL(file), formatManager));
+            expect(reader != nullptr);
+            if (reader == nullptr)
+                return 0.0;
+
+            AudioBuffer<float> block(2, blockSize);
+            double startMs = Time::getMillisecondCounterHiRes();
+            for (int64 pos = start; pos < end; pos += blockSize)
+                reader->read(&block, 0, blockSize, pos, true, true);
+            return Time::getMillisecondCounterHiRes() - startMs;
+        }
+
+        void logStats(const String& step, const DecodedBlockCache::Stats& before, const DecodedBlockCache::Stats& after, double ms)
+        {
+            int64 hits = after.hits - before.hits, misses = after.misses - before.misses;
+            double hitRate = hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0;
+            logMessage(step + ": " + String(ms, 1) + " ms, playback " + String(hits) + " hits / " + String(misses)
+                + " misses (" + String(hitRate, 1) + "%), scan " + String(after.scanHits - before.scanHits) + " hits / "
+                + String(after.scanMisses - before.scanMisses) + " misses, "
+                + String(after.sharedDecodes - before.sharedDecodes) + " shared decodes, "
+                + String(after.evictions - before.evictions) + " evictions, "
+                + String(after.memoryBytes / (1024 * 1024)) + " of " + String(after.budgetBytes / (1024 * 1024)) + " MB");
+        }
+
+        enum { blockSize = 512, numScans = 2 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 300.0;
+        const double playSeconds = 30.0;
+};
+
+static BlockCacheBenchmark blockCacheBenchmark;
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    DeckLoopTest.cpp
+
+    ### A looping deck keeps playing past the end of the track ###
+
+    - Plays a four second WAV on a DJAudioPlayer for seven seconds, block by
+      block at the pace of an audio device (the read-ahead thread needs it)
+    - Looping: no silent block after the start, the playhead wraps and the
+      deck still reports playing
+    - Not looping: the deck stops by itself at the end
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DJAudioPlayer.h"
+#include "BenchmarkHelpers.h"
+
+class DeckLoopTest : public UnitTest
+{
+    public:
+        DeckLoopTest() : UnitTest("Looping deck past the track end", "Playback") {}
+
+        void runTest() override
+        {
+            Benchmark::TempFolder temp("DeckLoop");
+            File file = temp.folder.getChildFile("loop.wav");
+            WavAudioFormat wav;
+            expect(Benchmark::writeAudioFile(file, wav, Benchmark::makeTrack(sampleRate, trackSeconds), sampleRate, 16));
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+
+            beginTest("Looping");
+            {
+                Playback playback = play(formatManager, file, true);
+                logMessage("Looping: " + String(playback.silentBlocks) + " silent blocks after the start, playhead wrapped "
+                    + String(playback.wraps) + " time(s)");
+                expectEquals(playback.silentBlocks, 0);
+                expectGreaterThan(playback.wraps, 0);
+                expect(playback.stillPlaying, "the deck stopped at the end of the track");
+            }
+
+            beginTest("Not looping");
+            {
+                Playback playback = play(formatManager, file, false);
+                expect(!playback.stillPlaying, "the deck kept playing past the end");
+                expectEquals(playback.wraps, 0);
+            }
+        }
+
+    private:
+        struct Playback {
+            int silentBlocks = 0;
+            int wraps = 0;
+            bool stillPlaying = false;
+        };
+
+        Playback play(AudioFormatManager& formatManager, const File& file, bool looping)
+        {
+            Playback playback;
+            DJAudioPlayer player(formatManager);
+            player.setLooping(looping);
+            expect(player.loadURL(URL(file)));
+            player.prepareToPlay(blockSize, sampleRate);
+            player.start();
+
+            AudioBuffer<float> block(2, blockSize);
+            AudioSourceChannelInfo info(block);
+            const int numBlocks = (int)(playSeconds * sampleRate / blockSize);
+            const int warmUpBlocks = (int)(0.5 * sampleRate / blockSize);
+            const double blockMs = blockSize * 1000.0 / sampleRate;
+            double previousPosition = 0.0;
+
+            double startMs = Time::getMillisecondCounterHiRes();
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                player.getNextAudioBlock(info);
+
+                if (i >= warmUpBlocks && block.getMagnitude(0, blockSize) < 1.0e-4f)
+                    ++playback.silentBlocks;
+
+                double position = player.getPositionRelative();
+                if (position < previousPosition - 0.5)
+                    ++playback.wraps;
+                previousPosition = position;
+
+                // Device pace, the read-ahead fills in real time
+                double due = startMs + (i + 1) * blockMs;
+                while (Time::getMillisecondCounterHiRes() < due)
+                    Thread::sleep(1);
+            }
+
+            playback.stillPlaying = player.isPlaying();
+            player.releaseResources();
+            return playback;
+        }
+
+        enum { blockSize = 512 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 4.0;
+        const double playSeconds = 7.0;
+};
+
+static DeckLoopTest deckLoopTest;
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    DeckMixerBenchmark.cpp
+
+    ### Per-block cost of the mixer chain ###
+
+    - Four tone decks through DeckMixer with every EQ band and the crossfader
+      away from their defaults, so the smoothing and all filters run
+    - 512-sample blocks at 44.1 kHz, about 11.6 ms of audio each
+    - Budget: under 5% of the block duration
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DeckMixer.h"
+#include "BenchmarkHelpers.h"
+
+class DeckMixerBenchmark : public UnitTest
+{
+    public:
+        DeckMixerBenchmark() : UnitTest("Mixer chain per block", "Mixer") {}
+
+        void runTest() override
+        {
+            beginTest("4 decks, 512 samples, 44.1 kHz");
+
+            ToneGeneratorAudioSource tones[DeckMixer::maxDecks];
+            DeckMixer mixer;
+            for (int d = 0; d < DeckMixer::maxDecks; ++d)
+            {
+                tones[d].setFrequency(110.0 * (d + 1));
+                tones[d].setAmplitude(0.25f);
+                mixer.addDeck(&tones[d], d % 2 == 0 ? DeckMixer::leftSide : DeckMixer::rightSide);
+                mixer.setEQ(d, DeckMixer::lowBand, 0.0f);
+                mixer.setEQ(d, DeckMixer::midBand, 0.7f);
+                mixer.setEQ(d, DeckMixer::highBand, 1.2f);
+            }
+            mixer.setCrossfader(0.3f);
+            mixer.prepareToPlay(blockSize, sampleRate);
+
+            AudioBuffer<float> output(2, blockSize);
+            AudioSourceChannelInfo info(output);
+
+            // A second of warm-up, the gains have settled afterwards
+            for (int i = 0; i < 100; ++i)
+                mixer.getNextAudioBlock(info);
+
+            double ms = Benchmark::timeMs(2000, [&] { mixer.getNextAudioBlock(info); });
+            double budget = blockSize * 1000.0 / sampleRate;
+            logMessage("Mixer chain: " + String(ms * 1000.0, 1) + " us per block, "
+                + String(100.0 * ms / budget, 2) + "% of the block, getCpuLoad() "
+                + String(100.0 * mixer.getCpuLoad(), 2) + "%");
+
+            expect(output.getMagnitude(0, blockSize) > 0.0f, "the mix is silent");
+            expectLessThan(ms, budget * 0.05);
+
+            mixer.releaseResources();
+        }
+
+    private:
+        enum { blockSize = 512 };
+        const double sampleRate = 44100.0;
+};
+
+static DeckMixerBenchmark deckMixerBenchmark;
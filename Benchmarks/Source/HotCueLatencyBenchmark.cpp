@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    HotCueLatencyBenchmark.cpp
+
+    ### Hot cue trigger-to-sound latency ###
+
+    - Renders a DJAudioPlayer offline, block by block at the pace of an
+      audio device, with eight hot cues on beats of a one minute WAV
+    - Every half second a cue is triggered at a random point between two
+      blocks, the way a click lands between device callbacks
+    - Logs getLastCueLatencyMs() for every trigger and checks that the
+      next block already plays from the cue
+    - Budget: every trigger heard within two blocks (about 23 ms)
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DJAudioPlayer.h"
+#include "BenchmarkHelpers.h"
+
+class HotCueLatencyBenchmark : public UnitTest
+{
+    public:
+        HotCueLatencyBenchmark() : UnitTest("Hot cue trigger latency", "Playback") {}
+
+        void runTest() override
+        {
+            beginTest("8 cues, 512 samples, 44.1 kHz");
+
+            Benchmark::TempFolder temp("HotCueLatency");
+            File file = temp.folder.getChildFile("cues.wav");
+            WavAudioFormat wav;
+            expect(Benchmark::writeAudioFile(file, wav, Benchmark::makeTrack(sampleRate, trackSeconds, bpm), sampleRate, 16));
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            DJAudioPlayer player(formatManager);
+            expect(player.loadURL(URL(file)));
+
+            // A cue every eight beats, from the second bar on
+            double cues[HotCueSource::maxHotCues];
+            for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot) {
+                cues[slot] = (4 + slot * 8) * 60.0 / bpm;
+                player.setHotCue(slot, cues[slot]);
+            }
+
+            // The cue audio is decoded in the background
+            Thread::sleep(1000);
+
+            player.prepareToPlay(blockSize, sampleRate);
+            player.start();
+
+            AudioBuffer<float> block(2, blockSize);
+            AudioSourceChannelInfo info(block);
+            const double blockMs = blockSize * 1000.0 / sampleRate;
+            const int blocksPerTrigger = (int)(0.5 * sampleRate / blockSize);
+            Random random(1);
+
+            StatisticsAccumulator<double> latency;
+            int late = 0;
+            double startMs = Time::getMillisecondCounterHiRes();
+            for (int i = 0; i < numTriggers * blocksPerTrigger; ++i)
+            {
+                double due = startMs + i * blockMs;
+                int slot = -1;
+                if (i % blocksPerTrigger == blocksPerTrigger - 1) {
+                    // Somewhere between the previous callback and this one
+                    slot = (i / blocksPerTrigger) % HotCueSource::maxHotCues;
+                    wait(due - random.nextDouble() * blockMs);
+                    player.triggerHotCue(slot);
+                }
+
+                wait(due);
+                player.getNextAudioBlock(info);
+
+                if (slot >= 0)
+                {
+                    latency.addValue(player.getLastCueLatencyMs());
+
+                    // The block after the trigger is the cue's audio, the resampler reads a little ahead
+                    double position = player.getPositionInSeconds();
+                    if (position < cues[slot] || position > cues[slot] + 0.05)
+                        ++late;
+                }
+            }
+            player.releaseResources();
+
+            logMessage("Trigger to sound: " + String(latency.getAverage(), 2) + " ms average, "
+                + String(latency.getMaxValue(), 2) + " ms worst over " + String((int)latency.getCount())
+                + " triggers, " + String(late) + " not playing the cue on the next block");
+
+            expectEquals(late, 0);
+            expectLessThan(latency.getMaxValue(), 2.0 * blockMs);
+        }
+
+    private:
+        static void wait(double untilMs)
+        {
+            while (Time::getMillisecondCounterHiRes() < untilMs)
+                Thread::sleep(1);
+        }
+
+        enum { blockSize = 512, numTriggers = 32 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 60.0;
+        const double bpm = 124.0;
+};
+
+static HotCueLatencyBenchmark hotCueLatencyBenchmark;
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    KeyDetectorBenchmark.cpp
+
+    ### Cost of the key detection stage per track ###
+
+    - Times KeyDetector::estimateKey on the mono buffer AnalysisQueue hands
+      it, for a four minute track at 44.1 kHz
+    - Budget: 100 ms per track, a bulk import of a thousand tracks then
+      spends under two minutes of one core on keys
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/KeyDetector.h"
+#include "BenchmarkHelpers.h"
+
+class KeyDetectorBenchmark : public UnitTest
+{
+    public:
+        KeyDetectorBenchmark() : UnitTest("Key detection per track", "Analysis") {}
+
+        void runTest() override
+        {
+            beginTest("Four minute track, 44.1 kHz");
+
+            const double sampleRate = 44100.0;
+            AudioBuffer<float> mono = Benchmark::toMono(Benchmark::makeTrack(sampleRate, 240.0));
+
+            KeyDetector detector;
+            int key = -1;
+            double ms = Benchmark::timeMs(1, [&] { key = detector.estimateKey(mono, sampleRate); });
+
+            logMessage("Key detection: " + String(ms, 2) + " ms per track, detected " + KeyDetector::getKeyName(key));
+            expect(key >= 0, "no key found");
+            expectLessThan(ms, budgetMs);
+        }
+
+    private:
+        const double budgetMs = 100.0;
+};
+
+static KeyDetectorBenchmark keyDetectorBenchmark;
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    LibraryScannerBenchmark.cpp
+
+    ### Rescan of an unchanged watch folder ###
+
+    - Builds a 50k-file tree (500 folders of 100 empty .mp3 files), lets the
+      first scan import all of it, then times a rescan that finds nothing
+    - Budget: well under a second, held to 1000 ms here
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/LibraryScanner.h"
+#include "BenchmarkHelpers.h"
+
+class LibraryScannerBenchmark : public UnitTest
+{
+    public:
+        LibraryScannerBenchmark() : UnitTest("Unchanged 50k-file rescan", "Library") {}
+
+        void runTest() override
+        {
+            beginTest("500 folders x 100 files");
+
+            Benchmark::TempFolder temp("LibraryScan");
+            File music = temp.folder.getChildFile("Music");
+            for (int folder = 0; folder < numFolders; ++folder)
+            {
+                File dir = music.getChildFile("Album " + String(folder));
+                dir.createDirectory();
+                for (int i = 0; i < filesPerFolder; ++i)
+                    dir.getChildFile("Track " + String(i) + ".mp3").create();
+            }
+
+            LibraryScanner scanner("*.mp3;*.wav");
+            int imported = 0;
+            scanner.onScanComplete = [&imported](const LibraryScanner::Result& result) {
+                imported += result.newOrChanged.size();
+            };
+
+            // First scan reports every file, results arrive on this (the message) thread
+            scanner.addWatchFolder(music);
+            waitUntil([&] { return imported >= numFolders * filesPerFolder; });
+            expectEquals(imported, numFolders * filesPerFolder);
+
+            // Each rescan stores its own time, a new value means it has finished
+            double best = std::numeric_limits<double>::max();
+            for (int round = 0; round < 5; ++round)
+            {
+                double previous = scanner.getLastScanTimeMs();
+                scanner.rescan();
+                waitUntil([&] { return scanner.getLastScanTimeMs() != previous; });
+                best = jmin(best, scanner.getLastScanTimeMs());
+            }
+
+            logMessage("Unchanged rescan: " + String(best, 1) + " ms for " + String(imported) + " files");
+            expectEquals(imported, numFolders * filesPerFolder, "an unchanged rescan reported files");
+            expectLessThan(best, budgetMs);
+        }
+
+    private:
+        template <typename Condition>
+        void waitUntil(Condition&& condition)
+        {
+            double timeout = Time::getMillisecondCounterHiRes() + 120000.0;
+            while (!condition() && Time::getMillisecondCounterHiRes() < timeout)
+                MessageManager::getInstance()->runDispatchLoopUntil(20);
+        }
+
+        enum { numFolders = 500, filesPerFolder = 100 };
+        const double budgetMs = 1000.0;
+};
+
+static LibraryScannerBenchmark libraryScannerBenchmark;
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    ### Benchmarks and offline tests for OtoDecks ###
+
+    - Console runner for the UnitTests in this folder, each file measures or
+      checks one part of the app against the numbers its feature asked for
+    - Pass a category (Analysis, Library, Mixer, Playback, Recording, Display, Cache)
+      to run only those, with no argument every test runs
+    - Timings only mean something in a Release build
+    - Files the tests need are generated in a temporary folder, which is
+      also the working directory while they run
+    - Save OtoDecks.jucer in the Projucer first: the app sources built into
+      this target, and so these files, use the app's JuceHeader.h
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+int main(int argc, char* argv[])
+{
+    // Message manager for the parts that broadcast changes or run timers
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    if (argc > 1)
+        runner.runTestsInCategory(argv[1]);
+    else
+        runner.runAllTests();
+
+    // Non-zero exit code if anything failed, so scripts can check it
+    for (int i = 0; i < runner.getNumResults(); ++i) {
+        if (runner.getResult(i)->failures > 0)
+            return 1;
+    }
+    return 0;
+}
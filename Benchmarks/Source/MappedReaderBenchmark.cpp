@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    MappedReaderBenchmark.cpp
+
+    ### WAV seeks and reads, mapped against streamed ###
+
+    - The same five minute 24-bit WAV read through MappedAudioReader and
+      through the stream reader the format manager makes
+    - Seek: a jump to a random position and one 512-sample block from it,
+      like a hot cue or a click on the waveform
+    - Read: the whole file in 512-sample blocks, like a deck playing it;
+      wall time and process CPU time (std::clock), so the page touching
+      ahead is counted too
+    - The file was just written, so both readers start from the page cache
+    - The mapped reader has to seek faster
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/MappedAudioReader.h"
+#include "BenchmarkHelpers.h"
+#include <ctime>
+
+class MappedReaderBenchmark : public UnitTest
+{
+    public:
+        MappedReaderBenchmark() : UnitTest("Mapped WAV seeks and reads", "Playback") {}
+
+        void runTest() override
+        {
+            Benchmark::TempFolder temp("MappedReader");
+            File file = temp.folder.getChildFile("track.wav");
+            WavAudioFormat wav;
+            expect(Benchmark::writeAudioFile(file, wav, Benchmark::makeTrack(sampleRate, trackSeconds), sampleRate, 24));
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+
+            std::unique_ptr<AudioFormatReader> mapped(MappedAudioReader::createFor(URL(file), formatManager));
+            std::unique_ptr<AudioFormatReader> streamed(formatManager.createReaderFor(file));
+            expect(dynamic_cast<MappedAudioReader*>(mapped.get()) != nullptr, "the WAV was not mapped");
+            expect(streamed != nullptr);
+            if (mapped == nullptr || streamed == nullptr)
+                return;
+
+            beginTest("Random seek + one block");
+            double mappedSeekMs = timeSeeks(*mapped);
+            double streamedSeekMs = timeSeeks(*streamed);
+            logMessage("Seek: mapped " + String(mappedSeekMs * 1000.0, 1) + " us, stream "
+                + String(streamedSeekMs * 1000.0, 1) + " us (" + String(streamedSeekMs / mappedSeekMs, 1) + "x)");
+            expectLessThan(mappedSeekMs, streamedSeekMs);
+
+            beginTest("Whole file in blocks");
+            Cost mappedRead = timeRead(*mapped);
+            Cost streamedRead = timeRead(*streamed);
+            logMessage("Read " + String(trackSeconds, 0) + " s: mapped " + String(mappedRead.wallMs, 1) + " ms wall / "
+                + String(mappedRead.cpuMs, 1) + " ms CPU, stream " + String(streamedRead.wallMs, 1) + " ms wall / "
+                + String(streamedRead.cpuMs, 1) + " ms CPU");
+        }
+
+    private:
+        struct Cost {
+            double wallMs = 0.0;
+            double cpuMs = 0.0;
+        };
+
+        double timeSeeks(AudioFormatReader& reader)
+        {
+            AudioBuffer<float> block(2, blockSize);
+            Random random(1); // the same positions for both readers
+            return Benchmark::timeMs(numSeeks, [&] {
+                int64 position = (int64)(random.nextDouble() * (double)(reader.lengthInSamples - blockSize));
+                reader.read(&block, 0, blockSize, position, true, true);
+            });
+        }
+
+        Cost timeRead(AudioFormatReader& reader)
+        {
+            AudioBuffer<float> block(2, blockSize);
+            Cost cost;
+            double startMs = Time::getMillisecondCounterHiRes();
+            std::clock_t startCpu = std::clock();
+            for (int64 pos = 0; pos < reader.lengthInSamples; pos += blockSize)
+                reader.read(&block, 0, blockSize, pos, true, true);
+            cost.cpuMs = 1000.0 * (double)(std::clock() - startCpu) / CLOCKS_PER_SEC;
+            cost.wallMs = Time::getMillisecondCounterHiRes() - startMs;
+            return cost;
+        }
+
+        enum { blockSize = 512, numSeeks = 1000 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 300.0;
+};
+
+static MappedReaderBenchmark mappedReaderBenchmark;
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    MasterRecorderTest.cpp
+
+    ### The recording is the mix, sample for sample ###
+
+    - Renders 30 s of a two-deck DeckMixer mix offline into a reference
+      buffer and pushes the same blocks into MasterRecorder, paced like an
+      audio device so the FIFO never overflows
+    - WAV (32-bit float) has to read back bit-exact, FLAC (24-bit) within
+      two 24-bit steps, one for the truncation and one for the rescaling
+    - No samples may be dropped
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DeckMixer.h"
+#include "../../Source/MasterRecorder.h"
+#include "BenchmarkHelpers.h"
+
+class MasterRecorderTest : public UnitTest
+{
+    public:
+        MasterRecorderTest() : UnitTest("Recording matches the offline mix", "Recording") {}
+
+        void runTest() override
+        {
+            Benchmark::TempFolder temp("Recorder");
+            AudioBuffer<float> mix = renderMix();
+
+            beginTest("WAV, 32-bit float");
+            {
+                AudioBuffer<float> recorded;
+                expect(record(mix, temp.folder.getChildFile("mix.wav"), recorded));
+                expectEquals(recorded.getNumSamples(), mix.getNumSamples());
+
+                bool identical = recorded.getNumSamples() == mix.getNumSamples();
+                for (int ch = 0; ch < 2 && identical; ++ch)
+                    identical = std::memcmp(recorded.getReadPointer(ch), mix.getReadPointer(ch),
+                        sizeof(float) * (size_t)mix.getNumSamples()) == 0;
+                expect(identical, "the WAV file differs from the mix");
+            }
+
+            beginTest("FLAC, 24-bit");
+            {
+                AudioBuffer<float> recorded;
+                expect(record(mix, temp.folder.getChildFile("mix.flac"), recorded));
+                expectEquals(recorded.getNumSamples(), mix.getNumSamples());
+
+                float worst = 0.0f;
+                for (int ch = 0; ch < 2 && recorded.getNumSamples() == mix.getNumSamples(); ++ch)
+                    for (int i = 0; i < mix.getNumSamples(); ++i)
+                        worst = jmax(worst, std::abs(recorded.getSample(ch, i) - mix.getSample(ch, i)));
+
+                logMessage("FLAC: largest difference " + String(worst * 8388608.0f, 2) + " steps of 2^-23");
+                expectLessOrEqual(worst, 2.0f / 8388608.0f);
+            }
+        }
+
+    private:
+        // Both decks play the test track, the second one a bar later, crossfader in the middle
+        AudioBuffer<float> renderMix()
+        {
+            AudioBuffer<float> track = Benchmark::makeTrack(sampleRate, seconds + 2.0);
+            track.applyGain(0.5f); // the sum stays inside +-1 for FLAC
+
+            MemoryAudioSource deckA(track, false, true), deckB(track, false, true);
+            deckB.setNextReadPosition((int64)(sampleRate * 4 * 60.0 / 124.0));
+
+            DeckMixer mixer;
+            mixer.addDeck(&deckA, DeckMixer::leftSide);
+            mixer.addDeck(&deckB, DeckMixer::rightSide);
+            mixer.setEQ(1, DeckMixer::lowBand, 0.0f);
+            mixer.prepareToPlay(blockSize, sampleRate);
+
+            int numSamples = (int)(sampleRate * seconds);
+            AudioBuffer<float> mix(2, numSamples);
+            for (int done = 0; done < numSamples; done += blockSize)
+            {
+                AudioSourceChannelInfo block(&mix, done, jmin((int)blockSize, numSamples - done));
+                mixer.getNextAudioBlock(block);
+            }
+            mixer.releaseResources();
+            return mix;
+        }
+
+        // Feeds the mix block by block, then reads the finished file back
+        bool record(const AudioBuffer<float>& mix, const File& file, AudioBuffer<float>& recorded)
+        {
+            MasterRecorder recorder;
+            recorder.prepareToPlay(sampleRate);
+            if (!recorder.startRecording(file))
+                return false;
+
+            AudioBuffer<float> device(2, blockSize);
+            for (int done = 0; done < mix.getNumSamples(); done += blockSize)
+            {
+                int numSamples = jmin((int)blockSize, mix.getNumSamples() - done);
+                for (int ch = 0; ch < 2; ++ch)
+                    device.copyFrom(ch, 0, mix, ch, done, numSamples);
+                recorder.pushBlock(AudioSourceChannelInfo(&device, 0, numSamples));
+
+                // Stay within a second of the writer, the FIFO holds four
+                while (done / sampleRate - recorder.getRecordedSeconds() > 1.0)
+                    Thread::sleep(1);
+            }
+            recorder.stopRecording();
+            expectEquals(recorder.getDroppedSamples(), (int64)0);
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+            if (reader == nullptr)
+                return false;
+
+            recorded.setSize(2, (int)reader->lengthInSamples);
+            return reader->read(&recorded, 0, recorded.getNumSamples(), 0, true, true);
+        }
+
+        enum { blockSize = 512 };
+        const double sampleRate = 44100.0;
+        const double seconds = 30.0;
+};
+
+static MasterRecorderTest masterRecorderTest;
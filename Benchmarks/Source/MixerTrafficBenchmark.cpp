@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    MixerTrafficBenchmark.cpp
+
+    ### Block copies of DeckMixer against the old mixer stack ###
+
+    - Old stack: MixerAudioSource over one ResamplingAudioSource per deck,
+      as every deck was wired before DeckMixer
+    - New path: DeckMixer over the decks directly, DJAudioPlayer skips its
+      resampler at normal speed
+    - Both are timed on the same four tone decks; the bytes per callback are
+      estimates counted from the copies each path makes, not measured
+    - DeckMixer also runs the EQ the old stack did not have, its lane copies
+      are listed on their own
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DeckMixer.h"
+#include "BenchmarkHelpers.h"
+
+class MixerTrafficBenchmark : public UnitTest
+{
+    public:
+        MixerTrafficBenchmark() : UnitTest("Mixer copies per callback", "Mixer") {}
+
+        void runTest() override
+        {
+            beginTest("4 decks, 512 samples, 44.1 kHz");
+
+            AudioBuffer<float> output(2, blockSize);
+            AudioSourceChannelInfo info(output);
+
+            ToneGeneratorAudioSource oldTones[numDecks];
+            std::unique_ptr<ResamplingAudioSource> resamplers[numDecks];
+            MixerAudioSource oldMixer;
+            for (int d = 0; d < numDecks; ++d)
+            {
+                oldTones[d].setFrequency(110.0 * (d + 1));
+                resamplers[d] = std::make_unique<ResamplingAudioSource>(&oldTones[d], false, 2);
+                resamplers[d]->setResamplingRatio(1.0);
+                oldMixer.addInputSource(resamplers[d].get(), false);
+            }
+            oldMixer.prepareToPlay(blockSize, sampleRate);
+            double oldMs = Benchmark::timeMs(2000, [&] { oldMixer.getNextAudioBlock(info); });
+            oldMixer.removeAllInputs();
+
+            ToneGeneratorAudioSource newTones[numDecks];
+            DeckMixer mixer;
+            for (int d = 0; d < numDecks; ++d)
+            {
+                newTones[d].setFrequency(110.0 * (d + 1));
+                mixer.addDeck(&newTones[d], DeckMixer::throughSide);
+            }
+            mixer.prepareToPlay(blockSize, sampleRate);
+            double newMs = Benchmark::timeMs(2000, [&] { mixer.getNextAudioBlock(info); });
+            mixer.releaseResources();
+
+            // One stereo block of floats, every count below is in these
+            const int64 block = (int64)blockSize * 2 * (int64)sizeof(float);
+
+            // Old: each resampler fills its own buffer, reads it back and writes the
+            // destination; decks after the first land in the mixer's temp buffer,
+            // which is read again and added into the output (read + write)
+            int64 oldBytes = numDecks * 3 * block + (numDecks - 1) * 3 * block;
+
+            // New: each deck writes its view once (the first one the device buffer),
+            // the first deck's gain is applied in place, the others are added with a ramp
+            int64 newBytes = numDecks * block + 2 * block + (numDecks - 1) * 3 * block;
+
+            // EQ: channels into the lane block and back, plus the filter pass over it
+            int64 eqBytes = 2 * 2 * numDecks * block + 2 * numDecks * block;
+
+            logMessage("MixerAudioSource + ResamplingAudioSource: " + String(oldMs * 1000.0, 1) + " us, ~"
+                + String(oldBytes / 1024) + " KB per callback (estimate)");
+            logMessage("DeckMixer: " + String(newMs * 1000.0, 1) + " us, ~" + String(newBytes / 1024)
+                + " KB per callback for the mix, ~" + String(eqBytes / 1024) + " KB more for the EQ (estimate)");
+
+            expectLessThan(newBytes, oldBytes);
+        }
+
+    private:
+        enum { blockSize = 512, numDecks = DeckMixer::maxDecks };
+        const double sampleRate = 44100.0;
+};
+
+static MixerTrafficBenchmark mixerTrafficBenchmark;
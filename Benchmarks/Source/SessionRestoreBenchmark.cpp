@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SessionRestoreBenchmark.cpp
+
+    ### Restoring the last session on startup ###
+
+    - Two decks set up like MainComponent's, each with a four minute WAV,
+      a playhead position and hot cues; the session
+      is captured and saved through SessionStore::saveNow()
+    - A fresh pair of decks then restores it: load() plus both
+      restoreSessionState calls, the work done before the window shows
+    - Positions and hot cues have to come back as saved
+    - Budget: under one second
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/DeckGUI.h"
+#include "../../Source/SessionStore.h"
+#include "BenchmarkHelpers.h"
+
+class SessionRestoreBenchmark : public UnitTest
+{
+    public:
+        SessionRestoreBenchmark() : UnitTest("Session restore on startup", "Playback") {}
+
+        void runTest() override
+        {
+            beginTest("2 decks, 4 minute tracks, 8 hot cues");
+
+            // session.json, library.json and the thumbnails go into the working directory
+            Benchmark::TempFolder temp("SessionRestore");
+            WavAudioFormat wav;
+            File files[numDecks];
+            for (int d = 0; d < numDecks; ++d) {
+                files[d] = temp.folder.getChildFile("deck" + String(d + 1) + ".wav");
+                expect(Benchmark::writeAudioFile(files[d], wav, Benchmark::makeTrack(sampleRate, trackSeconds), sampleRate, 16));
+            }
+
+            AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            ThumbnailStore thumbCache;
+            TrackStore trackStore;
+
+            // Saved positions and cues, different per deck
+            auto getPosition = [](int d) { return 60.0 + 30.0 * d; };
+            auto getCue = [](int d, int slot) { return slot == 3 ? -1.0 : 10.0 * slot + d; };
+
+            {
+                Decks decks(formatManager, thumbCache, trackStore);
+                for (int d = 0; d < numDecks; ++d)
+                {
+                    URL url(files[d]);
+                    expect(decks.gui[d]->loadTrack(url));
+                    for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot)
+                        decks.players[d]->setHotCue(slot, getCue(d, slot));
+                    decks.players[d]->setPosition(getPosition(d));
+                }
+
+                SessionStore sessionStore([&decks] { return decks.capture(); });
+                sessionStore.saveNow();
+            }
+
+            Decks decks(formatManager, thumbCache, trackStore);
+            double ms = Benchmark::timeMs(1, [&] {
+                var session = SessionStore::load();
+                if (auto* saved = session.getProperty("decks", var()).getArray()) {
+                    for (int d = 0; d < jmin(saved->size(), (int)numDecks); ++d)
+                        decks.gui[d]->restoreSessionState(saved->getReference(d));
+                }
+            }, 1);
+            logMessage("Restore: " + String(ms, 1) + " ms for " + String((int)numDecks) + " decks");
+
+            for (int d = 0; d < numDecks; ++d)
+            {
+                expectWithinAbsoluteError(decks.players[d]->getPositionInSeconds(), getPosition(d), 0.05);
+                for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot)
+                    expectWithinAbsoluteError(decks.players[d]->getHotCue(slot), getCue(d, slot), 0.001);
+            }
+            expectLessThan(ms, 1000.0);
+        }
+
+    private:
+        enum { numDecks = 2 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 240.0;
+
+        // Players, mixer and deck GUIs wired like MainComponent's
+        struct Decks {
+            Decks(AudioFormatManager& formatManager, ThumbnailStore& thumbCache, TrackStore& trackStore)
+            {
+                for (int d = 0; d < numDecks; ++d)
+                {
+                    players.add(new DJAudioPlayer(formatManager));
+                    mixer.addDeck(players[d], d == 0 ? DeckMixer::leftSide : DeckMixer::rightSide);
+                    gui.add(new DeckGUI(players[d], formatManager, thumbCache, trackStore, mixer, d));
+                }
+            }
+
+            var capture() const
+            {
+                DynamicObject* obj = new DynamicObject();
+                var saved;
+                for (auto* deck : gui)
+                    saved.append(deck->getSessionState());
+                obj->setProperty("decks", saved);
+                return var(obj);
+            }
+
+            // Destroyed bottom up, the GUIs go before the players they point to
+            OwnedArray<DJAudioPlayer> players;
+            DeckMixer mixer;
+            OwnedArray<DeckGUI> gui;
+        };
+};
+
+static SessionRestoreBenchmark sessionRestoreBenchmark;
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SpectrogramColourMapBenchmark.cpp
+
+    ### Spectrogram image generation, per pixel against per row ###
+
+    - A 4096x256 image from the same magnitudes both ways, the FFT is left
+      out since it did not change
+    - Before: the old generateSpectrogram loop, gainToDecibels, jmap, the
+      branchy colour pick and setPixelAt for every pixel
+    - After: SpectrogramColourMap::mapRow straight into the image rows
+    - The new path has to be faster
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/SpectrogramColourMap.h"
+#include "../../Source/ColourPalette.h"
+#include "BenchmarkHelpers.h"
+
+class SpectrogramColourMapBenchmark : public UnitTest
+{
+    public:
+        SpectrogramColourMapBenchmark() : UnitTest("Spectrogram image generation", "Display") {}
+
+        void runTest() override
+        {
+            beginTest("4096x256");
+
+            // Magnitudes from -120 dB to +6 dB, row-major like WaveformDisplay keeps them
+            std::vector<float> magnitudes((size_t)width * height);
+            Random random(1);
+            for (auto& magnitude : magnitudes)
+                magnitude = Decibels::decibelsToGain(random.nextFloat() * 126.0f - 120.0f, -200.0f);
+
+            Image image(Image::ARGB, width, height, false);
+
+            double beforeMs = Benchmark::timeMs(1, [&] {
+                for (int x = 0; x < width; ++x)
+                {
+                    for (int y = 0; y < height; ++y)
+                    {
+                        float magnitude = magnitudes[(size_t)y * width + x];
+                        float dB = Decibels::gainToDecibels(magnitude, -100.0f);
+                        float level = jmap(dB, -100.0f, 0.0f, 0.0f, 1.0f);
+                        image.setPixelAt(x, height - 1 - y, getOldColour(level));
+                    }
+                }
+            });
+
+            SpectrogramColourMap colourMap;
+            std::vector<float> row((size_t)width);
+            double afterMs = Benchmark::timeMs(1, [&] {
+                Image::BitmapData pixels(image, Image::BitmapData::writeOnly);
+                for (int y = 0; y < height; ++y)
+                {
+                    // mapRow clamps in place, work on a copy so every round sees the same input
+                    std::copy_n(magnitudes.begin() + (size_t)y * width, width, row.begin());
+                    colourMap.mapRow(row.data(), width, reinterpret_cast<PixelARGB*>(pixels.getLinePointer(height - 1 - y)));
+                }
+            });
+
+            logMessage("Per pixel: " + String(beforeMs, 2) + " ms, mapRow: " + String(afterMs, 2)
+                + " ms (" + String(beforeMs / afterMs, 1) + "x)");
+            expectLessThan(afterMs, beforeMs);
+        }
+
+    private:
+        // WaveformDisplay::getSpectrogramColour before the colour map replaced it
+        static Colour getOldColour(float level)
+        {
+            if (level < 0.2f)
+                return ColourPalette::btnColour;
+            if (level < 0.4f)
+                return ColourPalette::primaryColour;
+            if (level < 0.6f)
+                return ColourPalette::tertiaryColour;
+            if (level < 0.8f)
+                return ColourPalette::secondaryColour;
+            return ColourPalette::accentColour;
+        }
+
+        enum { width = 4096, height = 256 };
+};
+
+static SpectrogramColourMapBenchmark spectrogramColourMapBenchmark;
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    TrackQueryBenchmark.cpp
+
+    ### Compound queries over 250k tracks ###
+
+    - Generates 250k tracks (5000 artists, 500 albums, 40 genres, every key,
+      bpm 70-180, two to ten minutes) into a TrackStore
+    - Times each query on a fresh TrackQuery, so no term comes from the
+      cache; the first query also pays for the store's sorted columns and
+      word index, it is logged apart
+    - Queries mix free text with bpm, duration and key ranges and field
+      prefixes, sorted by title
+    - Budget: a compound query under 50 ms once the indices are built
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/TrackStore.h"
+#include "../../Source/TrackQuery.h"
+#include "BenchmarkHelpers.h"
+
+class TrackQueryBenchmark : public UnitTest
+{
+    public:
+        TrackQueryBenchmark() : UnitTest("Track queries on 250k tracks", "Library") {}
+
+        void runTest() override
+        {
+            beginTest("250k tracks, text and ranges");
+
+            // The store saves library.json into the working directory, the folder has to outlive it
+            Benchmark::TempFolder temp("TrackQuery");
+            File music = temp.folder.getChildFile("Music");
+
+            const char* words[] = { "night", "deep", "sun", "river", "echo", "fire", "glass", "motion",
+                "gold", "shadow", "dream", "city", "wave", "storm", "velvet", "signal" };
+            const int numWords = (int)numElementsInArray(words);
+
+            TrackStore store;
+            Random random(1);
+            for (int i = 0; i < numTracks; ++i)
+            {
+                Track track;
+                track.title = String(words[random.nextInt(numWords)]) + " " + words[random.nextInt(numWords)]
+                    + (i % 3 == 0 ? " (Extended Mix)" : " (Radio Edit)");
+                track.artist = "Artist " + String(random.nextInt(5000));
+                track.album = "Album " + String(random.nextInt(500));
+                track.genre = "Genre " + String(random.nextInt(40));
+                track.duration = 120 + random.nextInt(480);
+                track.bpm = 70.0 + random.nextInt(1100) / 10.0;
+                track.key = random.nextInt(24);
+                track.fileURL = URL(music.getChildFile(track.artist).getChildFile(String(i) + ".mp3"));
+                store.addTrack(track);
+            }
+            expectEquals(store.size(), (int)numTracks);
+
+            const StringArray queries = {
+                "bpm:120-128",
+                "deep bpm:120-128 dur:3:00-6:00",
+                "night mix bpm:>124 key:Am",
+                "artist:artist genre:genre dur:<4:00",
+                "echo bpm:<100 dur:>7:00",
+                "album:album bpm:124 key:C",
+                "river storm",
+            };
+
+            // First query builds the store's indices
+            double firstMs = Benchmark::timeMs(1, [&] {
+                TrackQuery query(store);
+                query.evaluate(queries[0], TrackStore::titleColumn, true);
+            }, 1);
+            logMessage("First query (index build): " + String(firstMs, 1) + " ms");
+
+            double worstMs = 0.0;
+            for (auto& text : queries)
+            {
+                size_t matches = 0;
+                double ms = Benchmark::timeMs(1, [&] {
+                    TrackQuery query(store);
+                    matches = query.evaluate(text, TrackStore::titleColumn, true).size();
+                });
+                logMessage("\"" + text + "\": " + String(ms, 2) + " ms, " + String((int)matches) + " tracks");
+                worstMs = jmax(worstMs, ms);
+            }
+
+            expectLessThan(worstMs, 50.0);
+        }
+
+    private:
+        enum { numTracks = 250000 };
+};
+
+static TrackQueryBenchmark trackQueryBenchmark;
@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    TrackStoreBenchmark.cpp
+
+    ### Library memory and filtering at 100k tracks ###
+
+    - Adds 100k tracks (2000 artists, 100 albums, 20 genres) to a TrackStore
+      and reads its own accounting from getMemoryStats()
+    - Compared with the Array<Track> the library used before: one Track per
+      row with its own title, artist and URL strings. That side is an
+      estimate from sizeof and the string lengths, counted the same way
+      getMemoryStats counts strings
+    - The store has to come out smaller
+    - Then types two searches into a TrackQuery one keystroke at a time and
+      deletes them again, the way the search box filters, timing every
+      evaluate; budget under 10 ms per keystroke
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/TrackStore.h"
+#include "../../Source/TrackQuery.h"
+#include "BenchmarkHelpers.h"
+
+class TrackStoreBenchmark : public UnitTest
+{
+    public:
+        TrackStoreBenchmark() : UnitTest("Library of 100k tracks", "Library") {}
+
+        void runTest() override
+        {
+            beginTest("100k tracks");
+
+            // The store saves library.json into the working directory, the folder has to outlive it
+            Benchmark::TempFolder temp("TrackStore");
+            File music = temp.folder.getChildFile("Music");
+
+            // The library's row type before TrackStore
+            struct OldTrack {
+                String title;
+                int duration;
+                String artist;
+                URL fileURL;
+                double bpm = 0.0;
+            };
+            const int64 stringOverhead = 2 * sizeof(void*);
+            int64 oldBytes = (int64)sizeof(OldTrack) * numTracks;
+
+            TrackStore store;
+            for (int i = 0; i < numTracks; ++i)
+            {
+                Track track;
+                track.title = "Track " + String(i) + " (Extended Mix)";
+                track.artist = "Artist " + String(i % 2000);
+                track.album = "Album " + String(i % 100);
+                track.genre = "Genre " + String(i % 20);
+                track.duration = 180 + i % 240;
+                track.bpm = 120.0 + i % 10;
+                track.fileURL = URL(music.getChildFile(track.artist).getChildFile(track.title + ".mp3"));
+                store.addTrack(track);
+
+                // Every old row had its own copy of each string
+                for (auto& text : { track.title, track.artist, track.fileURL.toString(false) })
+                    oldBytes += (int64)text.getNumBytesAsUTF8() + 1 + stringOverhead;
+            }
+
+            auto stats = store.getMemoryStats();
+            expectEquals(stats.numTracks, (int)numTracks);
+
+            logMessage("TrackStore: " + String(stats.getTotalBytes() / (1024 * 1024)) + " MB ("
+                + String(stats.columnBytes / 1024) + " KB columns, " + String(stats.textBytes / 1024) + " KB text, "
+                + String(stats.indexBytes / 1024) + " KB index), " + String(stats.getTotalBytes() / numTracks)
+                + " bytes per track, " + String(stats.numPooledStrings) + " pooled strings");
+            logMessage("Array<Track> before: ~" + String(oldBytes / (1024 * 1024)) + " MB, "
+                + String(oldBytes / numTracks) + " bytes per track (estimate, without album and genre)");
+
+            expectLessThan(stats.getTotalBytes(), oldBytes);
+
+            beginTest("Filter per keystroke");
+            timeKeystrokes(store);
+        }
+
+    private:
+        void timeKeystrokes(TrackStore& store)
+        {
+            TrackQuery query(store);
+
+            // The list is on screen before anyone types, its sort order is built already
+            query.evaluate({}, TrackStore::titleColumn, true);
+
+            StatisticsAccumulator<double> keystrokes;
+            for (String search : { "artist 12 extended", "bpm:120-128 dur:<6:00 mix" })
+            {
+                auto type = [&](const String& text) {
+                    double start = Time::getMillisecondCounterHiRes();
+                    query.evaluate(text, TrackStore::titleColumn, true);
+                    keystrokes.addValue(Time::getMillisecondCounterHiRes() - start);
+                };
+
+                for (int length = 1; length <= search.length(); ++length)
+                    type(search.substring(0, length));
+                for (int length = search.length() - 1; length >= 0; --length)
+                    type(search.substring(0, length));
+            }
+
+            logMessage("Filter: " + String(keystrokes.getAverage(), 2) + " ms average, "
+                + String(keystrokes.getMaxValue(), 2) + " ms worst over " + String((int)keystrokes.getCount()) + " keystrokes");
+            expectLessThan(keystrokes.getMaxValue(), 10.0);
+        }
+
+        enum { numTracks = 100000 };
+};
+
+static TrackStoreBenchmark trackStoreBenchmark;
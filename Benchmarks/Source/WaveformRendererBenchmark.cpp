@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    WaveformRendererBenchmark.cpp
+
+    ### Per-frame cost of four scrolling waveforms ###
+
+    - Software: AudioThumbnail::drawChannels into a 1200x150 image per deck,
+      the way WaveformDisplay drew before the OpenGL path
+    - OpenGL: four components with their own context and WaveformRenderer,
+      the view scrolls every frame; the time is taken inside renderOpenGL up
+      to glFinish, so a software rasteriser (Mesa) is counted as well
+    - Four minute track, ten second window, 60 frames per second
+    - Needs a display; without one only the software path runs
+
+  ==============================================================================
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/WaveformRenderer.h"
+#include "BenchmarkHelpers.h"
+
+class WaveformRendererBenchmark : public UnitTest
+{
+    public:
+        WaveformRendererBenchmark() : UnitTest("Scrolling waveforms per frame", "Display") {}
+
+        void runTest() override
+        {
+            beginTest("4 decks, 1200x150, software");
+            double softwareMs = timeSoftwareFrame();
+            logMessage("Software: " + String(softwareMs, 2) + " ms per frame for " + String(numDecks) + " decks");
+
+            beginTest("4 decks, 1200x150, OpenGL");
+            if (Desktop::getInstance().getDisplays().getPrimaryDisplay() == nullptr) {
+                logMessage("No display, OpenGL path skipped");
+                return;
+            }
+
+            double glMs = timeOpenGLFrame();
+            logMessage("OpenGL: " + String(glMs, 2) + " ms per frame for " + String(numDecks) + " decks");
+            expect(glMs >= 0.0, "no OpenGL frames were drawn");
+            expectLessThan(glMs, softwareMs);
+        }
+
+    private:
+        enum { numDecks = 4, width = 1200, height = 150, numFrames = 240 };
+        const double sampleRate = 44100.0;
+        const double trackSeconds = 240.0;
+        const double windowSeconds = 10.0;
+
+        double timeSoftwareFrame()
+        {
+            AudioBuffer<float> track = Benchmark::makeTrack(sampleRate, trackSeconds);
+            AudioFormatManager formatManager;
+            AudioThumbnailCache cache(numDecks);
+            OwnedArray<AudioThumbnail> thumbnails;
+            for (int d = 0; d < numDecks; ++d)
+            {
+                auto* thumbnail = thumbnails.add(new AudioThumbnail(1000, formatManager, cache));
+                thumbnail->reset(2, sampleRate, track.getNumSamples());
+                thumbnail->addBlock(0, track, 0, track.getNumSamples());
+            }
+
+            Image images[numDecks];
+            for (auto& image : images)
+                image = Image(Image::ARGB, width, height, true);
+
+            int frame = 0;
+            return Benchmark::timeMs(numFrames, [&] {
+                double start = frame++ * (trackSeconds - windowSeconds) / numFrames;
+                for (int d = 0; d < numDecks; ++d)
+                {
+                    Graphics g(images[d]);
+                    g.fillAll(Colours::black);
+                    g.setColour(Colours::orange);
+                    thumbnails[d]->drawChannels(g, images[d].getBounds(), start, start + windowSeconds, 1.0f);
+                }
+            }, 1);
+        }
+
+        // Times renderOpenGL, including the GPU (or rasteriser) work, for one deck
+        class TimedRenderer : public OpenGLRenderer
+        {
+            public:
+                TimedRenderer(WaveformRenderer& rendererToTime) : renderer(rendererToTime) {}
+
+                void newOpenGLContextCreated() override { renderer.newOpenGLContextCreated(); }
+                void openGLContextClosing() override { renderer.openGLContextClosing(); }
+
+                void renderOpenGL() override
+                {
+                    double start = Time::getMillisecondCounterHiRes();
+                    renderer.renderOpenGL();
+                    gl::glFinish();
+                    if (renderer.isActive()) {
+                        totalMs = totalMs.load() + Time::getMillisecondCounterHiRes() - start;
+                        ++frames;
+                    }
+                }
+
+                std::atomic<double> totalMs{ 0.0 };
+                std::atomic<int> frames{ 0 };
+
+            private:
+                WaveformRenderer& renderer;
+        };
+
+        class GLDeck : public Component
+        {
+            public:
+                GLDeck() : renderer(context), timedRenderer(renderer)
+                {
+                    context.setRenderer(&timedRenderer);
+                    context.setComponentPaintingEnabled(false);
+                    context.attachTo(*this);
+                }
+
+                ~GLDeck() override
+                {
+                    context.detach();
+                }
+
+                OpenGLContext context;
+                WaveformRenderer renderer;
+                TimedRenderer timedRenderer;
+        };
+
+        double timeOpenGLFrame()
+        {
+            // Peaks packed like WaveformDisplay::buildPeakPyramid, one entry per 10 ms
+            const int numEntries = (int)(trackSeconds * 100.0);
+            std::vector<uint32> packed, packedBands;
+            Array<WaveformRenderer::Level> levels;
+            Random random(1);
+            for (int count = numEntries; ; count /= 2)
+            {
+                WaveformRenderer::Level level;
+                level.offset = (int)packed.size();
+                level.count = count;
+                levels.add(level);
+
+                for (int i = 0; i < count; ++i) {
+                    uint8 peak = (uint8)(128 + random.nextInt(127));
+                    uint8 rgba[4] = { peak, (uint8)(255 - peak), 0, 255 }, bands[4] = { 200, 120, 60, 255 };
+                    uint32 entry, bandEntry;
+                    memcpy(&entry, rgba, sizeof(entry));
+                    memcpy(&bandEntry, bands, sizeof(bandEntry));
+                    packed.push_back(entry);
+                    packedBands.push_back(bandEntry);
+                }
+                if (count <= 64)
+                    break;
+            }
+
+            Component content;
+            content.setSize(width, height * numDecks);
+            OwnedArray<GLDeck> decks;
+            for (int d = 0; d < numDecks; ++d)
+            {
+                auto* deck = decks.add(new GLDeck());
+                deck->setBounds(0, d * height, width, height);
+                content.addAndMakeVisible(deck);
+                deck->renderer.setPeaks(packed, packedBands, levels);
+            }
+
+            DocumentWindow window("Waveform benchmark", Colours::black, DocumentWindow::closeButton);
+            window.setUsingNativeTitleBar(true);
+            window.setContentNonOwned(&content, true);
+            window.setVisible(true);
+
+            // Let the contexts come up and the peaks upload before timing
+            double timeout = Time::getMillisecondCounterHiRes() + 5000.0;
+            auto allActive = [&decks] {
+                for (auto* deck : decks)
+                    if (!deck->renderer.isActive())
+                        return false;
+                return true;
+            };
+            while (!allActive() && Time::getMillisecondCounterHiRes() < timeout)
+                MessageManager::getInstance()->runDispatchLoopUntil(20);
+            for (auto* deck : decks) {
+                deck->timedRenderer.totalMs = 0.0;
+                deck->timedRenderer.frames = 0;
+            }
+
+            // Scroll the view once per frame, as playback does
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                double start = frame * (1.0 - windowSeconds / trackSeconds) / numFrames;
+                for (auto* deck : decks) {
+                    deck->renderer.setView(start, windowSeconds / trackSeconds);
+                    deck->context.triggerRepaint();
+                }
+                MessageManager::getInstance()->runDispatchLoopUntil(1000 / 60);
+            }
+
+            // Sum of the four decks' average frame
+            double perFrame = 0.0;
+            for (auto* deck : decks)
+            {
+                int frames = deck->timedRenderer.frames.load();
+                if (frames == 0)
+                    return -1.0;
+                perFrame += deck->timedRenderer.totalMs.load() / frames;
+            }
+            return perFrame;
+        }
+};
+
+static WaveformRendererBenchmark waveformRendererBenchmark;
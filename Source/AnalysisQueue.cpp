@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+
+    AnalysisQueue.cpp
+
+  ==============================================================================
+*/
+
+#include "AnalysisQueue.h"
+#include "MappedAudioReader.h"
+
+AnalysisQueue::AnalysisQueue() : Thread("Track analysis")
+{
+    formatManager.registerBasicFormats();
+    loadCache();
+    startThread(Thread::Priority::low);
+}
+
+AnalysisQueue::~AnalysisQueue()
+{
+    stopThread(4000);
+    cancelPendingUpdate();
+    saveCache();
+}
+
+void AnalysisQueue::addJob(const File& file)
+{
+    AnalysisResult cached;
+    {
+        const ScopedLock sl(lock);
+        if (findCachedResult(file, cached))
+            finishedResults.add(cached);
+        else
+            pendingJobs.addIfNotAlreadyThere(file);
+    }
+
+    if (cached.file != File())
+        triggerAsyncUpdate();
+    else
+        notify(); // wake up the worker
+}
+
+double AnalysisQueue::getAverageAnalysisTimeMs() const
+{
+    int count = numAnalysed.load();
+    return count > 0 ? totalAnalysisTimeMs.load() / count : 0.0;
+}
+
+void AnalysisQueue::run()
+{
+    while (!threadShouldExit())
+    {
+        File job;
+        {
+            const ScopedLock sl(lock);
+            if (!pendingJobs.isEmpty())
+                job = pendingJobs.removeAndReturn(0);
+        }
+
+        // Nothing left to do - write the cache once and sleep until notified
+        if (job == File()) {
+            saveCache();
+            wait(-1);
+            continue;
+        }
+
+        double startMs = Time::getMillisecondCounterHiRes();
+        AnalysisResult result = analyse(job);
+        if (threadShouldExit())
+            break;
+
+        totalAnalysisTimeMs = totalAnalysisTimeMs.load() + (Time::getMillisecondCounterHiRes() - startMs);
+        ++numAnalysed;
+
+        {
+            const ScopedLock sl(lock);
+            CacheEntry entry;
+            entry.size = job.getSize();
+            entry.modified = job.getLastModificationTime().toMilliseconds();
+            entry.bpm = result.bpm;
+            entry.downbeat = result.downbeat;
+            entry.key = result.key;
+            entry.duration = result.duration;
+            entry.artist = result.artist;
+            cache[job.getFullPathName()] = entry;
+            cacheChanged = true;
+            finishedResults.add(result);
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+void AnalysisQueue::handleAsyncUpdate()
+{
+    Array<AnalysisResult> results;
+    {
+        const ScopedLock sl(lock);
+        results.swapWith(finishedResults);
+    }
+
+    if (onAnalysisComplete != nullptr) {
+        for (auto& result : results)
+            onAnalysisComplete(result);
+    }
+}
+
+AnalysisResult AnalysisQueue::analyse(const File& file)
+{
+    AnalysisResult result;
+    result.file = file;
+
+    std::unique_ptr<AudioFormatReader> reader(MappedAudioReader::createFor(URL(file), formatManager, true));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return result;
+
+    result.duration = static_cast<int>(reader->lengthInSamples / reader->sampleRate);
+    if (reader->metadataValues.containsKey("artist"))
+        result.artist = reader->metadataValues["artist"];
+    // Check also for standard ID3 tag that contains artist name
+    else if (reader->metadataValues.containsKey("ID3:TPE1"))
+        result.artist = reader->metadataValues["ID3:TPE1"];
+
+    // Decode the file once, downmixing to mono chunk by chunk
+    int numChannels = (int)reader->numChannels;
+    int numSamples = (int)reader->lengthInSamples;
+    const int chunkSize = 65536;
+    AudioBuffer<float> chunk(numChannels, chunkSize);
+    AudioBuffer<float> monoBuffer(1, numSamples);
+    monoBuffer.clear();
+
+    for (int start = 0; start < numSamples; start += chunkSize) {
+        if (threadShouldExit())
+            return result;
+
+        int numToRead = jmin(chunkSize, numSamples - start);
+        reader->read(&chunk, 0, numToRead, start, true, true);
+        for (int ch = 0; ch < numChannels; ++ch)
+            monoBuffer.addFrom(0, start, chunk, ch, 0, numToRead, 1.0f / numChannels);
+    }
+
+    // Both analysers share the decoded buffer
+    result.bpm = bpmAnalyzer.estimateBPM(monoBuffer, reader->sampleRate);
+    result.downbeat = bpmAnalyzer.estimateDownbeat(monoBuffer, reader->sampleRate, result.bpm);
+    result.key = keyDetector.estimateKey(monoBuffer, reader->sampleRate);
+    return result;
+}
+
+bool AnalysisQueue::findCachedResult(const File& file, AnalysisResult& result)
+{
+    auto it = cache.find(file.getFullPathName());
+    if (it == cache.end())
+        return false;
+
+    // A changed file has to be analysed again, so do results from before downbeat detection
+    if (it->second.size != file.getSize()
+        || it->second.modified != file.getLastModificationTime().toMilliseconds()
+        || it->second.downbeat < 0.0)
+        return false;
+
+    result.file = file;
+    result.bpm = it->second.bpm;
+    result.downbeat = it->second.downbeat;
+    result.key = it->second.key;
+    result.duration = it->second.duration;
+    result.artist = it->second.artist;
+    return true;
+}
+
+void AnalysisQueue::loadCache()
+{
+    File f = File::getCurrentWorkingDirectory().getChildFile("analysis.json");
+    if (!f.existsAsFile())
+        return;
+
+    var json = JSON::parse(f);
+    if (!json.isArray())
+        return;
+
+    for (auto& item : *json.getArray())
+    {
+        if (auto* obj = item.getDynamicObject())
+        {
+            CacheEntry entry;
+            entry.size = (int64)obj->getProperty("size");
+            entry.modified = (int64)obj->getProperty("modified");
+            entry.bpm = obj->getProperty("bpm");
+            entry.downbeat = obj->hasProperty("downbeat") ? (double)obj->getProperty("downbeat") : -1.0;
+            entry.key = obj->getProperty("key");
+            entry.duration = obj->getProperty("duration");
+            entry.artist = obj->getProperty("artist").toString();
+            cache[obj->getProperty("path").toString()] = entry;
+        }
+    }
+}
+
+void AnalysisQueue::saveCache()
+{
+    var json;
+    {
+        const ScopedLock sl(lock);
+        if (!cacheChanged)
+            return;
+
+        for (auto& item : cache)
+        {
+            DynamicObject* obj = new DynamicObject();
+            obj->setProperty("path", item.first);
+            obj->setProperty("size", item.second.size);
+            obj->setProperty("modified", item.second.modified);
+            obj->setProperty("bpm", item.second.bpm);
+            obj->setProperty("downbeat", item.second.downbeat);
+            obj->setProperty("key", item.second.key);
+            obj->setProperty("duration", item.second.duration);
+            obj->setProperty("artist", item.second.artist);
+            json.append(var(obj));
+        }
+        cacheChanged = false;
+    }
+
+    File f = File::getCurrentWorkingDirectory().getChildFile("analysis.json");
+    f.replaceWithText(JSON::toString(json));
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    AnalysisQueue.h
+
+    ### Background analysis pipeline for library tracks ###
+
+    - Worker thread that decodes each queued file once into a mono buffer
+    - Runs BPMAnalyzer (tempo and downbeat) and KeyDetector on the same
+      decoded buffer
+    - Also reports duration and artist, so bulk imports never open a
+      reader on the message thread
+    - Results are cached in analysis.json (keyed by path, size and mtime)
+      so known files are never analysed twice
+    - Finished results are delivered on the message thread
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "BPMAnalyzer.h"
+#include "KeyDetector.h"
+
+struct AnalysisResult {
+    File file;
+    double bpm = 0.0;
+    double downbeat = 0.0; // seconds to the first bar line
+    int key = -1;
+    int duration = 0; // seconds
+    String artist; // empty if the file has no artist tag
+};
+
+class AnalysisQueue : private Thread,
+    private AsyncUpdater
+{
+    public:
+        AnalysisQueue();
+        ~AnalysisQueue() override;
+
+        // Queue a file for analysis, cached files are answered straight away
+        void addJob(const File& file);
+
+        // Called on the message thread whenever a track has been analysed
+        std::function<void(const AnalysisResult&)> onAnalysisComplete;
+
+        // Average time spent analysing one (uncached) track
+        double getAverageAnalysisTimeMs() const;
+
+    private:
+        struct CacheEntry {
+            int64 size = 0;
+            int64 modified = 0;
+            double bpm = 0.0;
+            double downbeat = -1.0; // -1 for entries saved before downbeats were detected
+            int key = -1;
+            int duration = 0;
+            String artist;
+        };
+
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        AnalysisResult analyse(const File& file);
+        bool findCachedResult(const File& file, AnalysisResult& result);
+        void loadCache();
+        void saveCache();
+
+        AudioFormatManager formatManager;
+        BPMAnalyzer bpmAnalyzer;
+        KeyDetector keyDetector;
+
+        CriticalSection lock; // guards the job/result lists and the cache
+        Array<File> pendingJobs;
+        Array<AnalysisResult> finishedResults;
+        std::map<String, CacheEntry> cache;
+        bool cacheChanged = false;
+
+        std::atomic<double> totalAnalysisTimeMs{ 0.0 };
+        std::atomic<int> numAnalysed{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisQueue)
+};
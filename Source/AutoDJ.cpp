@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    AutoDJ.cpp
+
+  ==============================================================================
+*/
+
+#include "AutoDJ.h"
+#include "DeckGUI.h"
+
+AutoDJ::AutoDJ(TrackStore& trackStoreToUse, TransportScheduler& schedulerToUse) :
+    trackStore(trackStoreToUse),
+    scheduler(schedulerToUse)
+{
+
+}
+
+AutoDJ::~AutoDJ()
+{
+    stopTimer();
+}
+
+void AutoDJ::setDecks(DeckGUI* leftDeck, DeckGUI* rightDeck, std::function<void(float)> setCrossfader)
+{
+    decks[0] = leftDeck;
+    decks[1] = rightDeck;
+    crossfader = std::move(setCrossfader);
+}
+
+void AutoDJ::addTrack(const URL& url)
+{
+    playlist.add(url);
+    sendChangeMessage();
+}
+
+void AutoDJ::removeTrack(int position)
+{
+    playlist.remove(position);
+    sendChangeMessage();
+}
+
+void AutoDJ::clear()
+{
+    playlist.clear();
+    sendChangeMessage();
+}
+
+const Array<URL>& AutoDJ::getPlaylist() const
+{
+    return playlist;
+}
+
+void AutoDJ::setEnabled(bool shouldBeEnabled)
+{
+    if (enabled == shouldBeEnabled || decks[0] == nullptr || decks[1] == nullptr)
+        return;
+
+    enabled = shouldBeEnabled;
+    mixing = false;
+    nextLoaded = false;
+
+    if (enabled) {
+        // Keep going from whatever is playing, otherwise start the first queued track
+        if (decks[1]->getPlayer()->isPlaying() && !decks[0]->getPlayer()->isPlaying())
+            activeDeck = 1;
+        else
+            activeDeck = 0;
+
+        if (!decks[activeDeck]->getPlayer()->isPlaying()) {
+            if (!preloadNext(activeDeck)) {
+                enabled = false;
+                sendChangeMessage();
+                return;
+            }
+            decks[activeDeck]->getPlayer()->start();
+        }
+        crossfader((float)activeDeck);
+        mixStart = getMixStart(activeDeck, mixLength);
+
+        startTimer(20);
+    }
+    else {
+        stopTimer();
+    }
+    sendChangeMessage();
+}
+
+bool AutoDJ::isEnabled() const
+{
+    return enabled;
+}
+
+void AutoDJ::timerCallback()
+{
+    int idleDeck = 1 - activeDeck;
+    DJAudioPlayer* active = decks[activeDeck]->getPlayer();
+
+    // Prime the idle deck well before it is needed
+    if (!nextLoaded && !mixing)
+        nextLoaded = preloadNext(idleDeck);
+
+    double position = active->getPositionInSeconds();
+
+    if (!mixing)
+    {
+        // Nothing left to mix into, let the last track play out
+        if (!nextLoaded) {
+            if (!active->isPlaying())
+                setEnabled(false);
+            return;
+        }
+
+        // Scheduled a little ahead so the start lands on the bar line
+        if (position >= mixStart - 0.5 || !active->isPlaying()) {
+            mixing = true;
+            scheduleIncomingStart();
+        }
+        return;
+    }
+
+    // Crossfader follows the outgoing track's position
+    double progress = mixLength > 0.0 ? (position - mixStart) / mixLength : 1.0;
+    if (progress >= 1.0 || !active->isPlaying()) {
+        finishMix();
+        return;
+    }
+
+    float side = (float)jlimit(0.0, 1.0, progress);
+    crossfader(activeDeck == 0 ? side : 1.0f - side);
+}
+
+void AutoDJ::scheduleIncomingStart()
+{
+    int idleDeck = 1 - activeDeck;
+    DJAudioPlayer* active = decks[activeDeck]->getPlayer();
+    TransportScheduler::Event event;
+    event.player = decks[idleDeck]->getPlayer();
+    event.type = TransportScheduler::startEvent;
+
+    // Position and clock read together, so the offset is exact
+    double position = 0.0;
+    bool playing = false;
+    event.sampleTime = scheduler.getSampleTime([&] {
+        position = active->getPositionInSeconds();
+        playing = active->isPlaying();
+    });
+
+    double speed = active->getSpeed();
+    if (playing && speed > 0.0 && position < mixStart)
+        event.sampleTime += (int64)std::llround((mixStart - position) / speed * scheduler.getSampleRate());
+
+    // The incoming track starts on its own first bar line, at the outgoing track's tempo;
+    // the jump and the speed land on the same sample as the start
+    double incomingDownbeat = 0.0, outgoingDownbeat = 0.0;
+    double incomingBpm = getBpm(idleDeck, incomingDownbeat);
+    double outgoingBpm = getBpm(activeDeck, outgoingDownbeat);
+
+    TransportScheduler::Event jump = event;
+    jump.type = TransportScheduler::positionEvent;
+    jump.value = incomingDownbeat;
+
+    // A full queue starts it straight away, from where it is
+    if (!scheduler.schedule(jump) || !scheduler.schedule(event)) {
+        event.player->start();
+        return;
+    }
+
+    // Without both BPMs the incoming deck keeps its own speed
+    if (incomingBpm <= 0.0 || outgoingBpm <= 0.0 || speed <= 0.0)
+        return;
+
+    // BPM estimates an octave off are folded back, both tracks keep four beats to the bar
+    TransportScheduler::Event tempo = event;
+    tempo.type = TransportScheduler::speedEvent;
+    tempo.value = outgoingBpm * speed / incomingBpm;
+    while (tempo.value >= 1.5)
+        tempo.value *= 0.5;
+    while (tempo.value < 0.75)
+        tempo.value *= 2.0;
+
+    if (scheduler.schedule(tempo))
+        decks[idleDeck]->showSpeed(tempo.value);
+}
+
+bool AutoDJ::preloadNext(int deckIndex)
+{
+    // Tracks that can no longer be opened are skipped
+    while (!playlist.isEmpty())
+    {
+        URL url = playlist.removeAndReturn(0);
+        sendChangeMessage();
+        if (decks[deckIndex]->loadTrack(url))
+            return true;
+    }
+    return false;
+}
+
+double AutoDJ::getMixStart(int deckIndex, double& length) const
+{
+    DJAudioPlayer* player = decks[deckIndex]->getPlayer();
+    double trackLength = player->getLengthInSeconds();
+    double downbeat = 0.0;
+    double bpm = getBpm(deckIndex, downbeat);
+
+    if (bpm <= 0.0) {
+        length = jmin(8.0, trackLength * 0.5);
+        return trackLength - length;
+    }
+
+    // 16 beats, starting on the last bar line that leaves room for them; bars are counted from the downbeat
+    double beat = 60.0 / bpm;
+    double bar = beat * 4.0;
+    length = jmin(beat * 16.0, trackLength * 0.5);
+    return jmax(0.0, downbeat + std::floor((trackLength - length - downbeat) / bar) * bar);
+}
+
+double AutoDJ::getBpm(int deckIndex, double& downbeat) const
+{
+    int index = trackStore.findTrack(decks[deckIndex]->getPlayer()->getURL());
+    downbeat = index >= 0 ? trackStore.getDownbeat(index) : 0.0;
+    return index >= 0 ? trackStore.getBpm(index) : 0.0;
+}
+
+void AutoDJ::finishMix()
+{
+    decks[activeDeck]->getPlayer()->stop();
+    activeDeck = 1 - activeDeck;
+    crossfader((float)activeDeck);
+
+    mixing = false;
+    nextLoaded = false;
+    mixStart = getMixStart(activeDeck, mixLength);
+}
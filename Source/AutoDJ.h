@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    AutoDJ.h
+
+    ### Ordered playlist with automatic mixing ###
+
+    - Tracks are queued from the library and played in order
+    - The next track is loaded into the idle deck as soon as the current one
+      starts, so it is opened, read ahead and has its thumbnail long before
+      the mix; nothing waits on the disk or the decoder at the handover
+    - BPM and downbeat come from the library's background analysis; the
+      crossfade starts on a bar line near the end and lasts 16 beats
+      (8 seconds if unknown)
+    - The incoming deck is started through the TransportScheduler, on the
+      exact sample of the mix point, from its own downbeat and at the
+      outgoing deck's tempo (it keeps that tempo after the mix)
+    - Drives the crossfader through a callback, deck 1 is on the left
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackStore.h"
+#include "TransportScheduler.h"
+
+class DeckGUI; // forward declaration
+
+class AutoDJ : public ChangeBroadcaster,
+    private Timer
+{
+    public:
+        AutoDJ(TrackStore& trackStoreToUse, TransportScheduler& schedulerToUse);
+        ~AutoDJ() override;
+
+        // Left and right deck, and how to move the crossfader (0 = left, 1 = right)
+        void setDecks(DeckGUI* leftDeck, DeckGUI* rightDeck, std::function<void(float)> setCrossfader);
+
+        // Playlist
+        void addTrack(const URL& url);
+        void removeTrack(int position);
+        void clear();
+        const Array<URL>& getPlaylist() const;
+
+        // Starting takes the first queued track unless a deck is already playing
+        void setEnabled(bool shouldBeEnabled);
+        bool isEnabled() const;
+
+    private:
+        void timerCallback() override;
+        bool preloadNext(int deckIndex);
+        double getMixStart(int deckIndex, double& mixLength) const;
+        double getBpm(int deckIndex, double& downbeat) const;
+        void finishMix();
+
+        void scheduleIncomingStart();
+
+        TrackStore& trackStore;
+        TransportScheduler& scheduler;
+        DeckGUI* decks[2] = { nullptr, nullptr };
+        std::function<void(float)> crossfader;
+
+        Array<URL> playlist;
+        bool enabled = false;
+
+        int activeDeck = 0;
+        bool nextLoaded = false; // idle deck holds the next track
+        bool mixing = false;
+        double mixStart = 0.0, mixLength = 0.0; // on the active deck, in seconds
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutoDJ)
+};
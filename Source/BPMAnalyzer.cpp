@@ -7,6 +7,7 @@
 */
 
 #include "BPMAnalyzer.h"
+#include "MappedAudioReader.h"
 
 double BPMAnalyzer::estimateBPM(const File& file)
 {
@@ -15,7 +16,7 @@ double BPMAnalyzer::estimateBPM(const File& file)
     formatManager.registerBasicFormats();
 
 	// Create reader to read samples from the audio file
-    if (auto* reader = formatManager.createReaderFor(file)) {
+    if (auto* reader = MappedAudioReader::createFor(URL(file), formatManager, true)) {
 		// Read audio samples into buffer
         int numChannels = (int)reader->numChannels; // number of channels
         int numSamples = (int)reader->lengthInSamples; // number of samples in the file
@@ -28,27 +29,7 @@ double BPMAnalyzer::estimateBPM(const File& file)
 			monoBuffer.addFrom(0, 0, buffer, ch, 0, buffer.getNumSamples(), 1.0f / buffer.getNumChannels());
         }
 
-		// Simple peak detection for BPM estimation
-		int sampleRate = (int)reader->sampleRate; // sample rate
-		int numSamplesMono = monoBuffer.getNumSamples(); // number of samples
-        float threshold = 0.5f * monoBuffer.getMagnitude(0, numSamplesMono); // magnitude threshold
-		int beatCount = 0; // count of detected beats
-		int lastSample = -10000; // last detected beat sample index
-
-        // Check if sample is above threshold
-        for (int i = 0; i < numSamplesMono; ++i)
-        {
-            // Add 0.25s min distance to avoid counting the same beat
-            if (fabs(monoBuffer.getSample(0, i)) > threshold && i - lastSample > sampleRate / 4) 
-            {
-                beatCount++;
-                lastSample = i;
-            }
-        }
-
-		// Calculate BPM
-        double durationSec = numSamplesMono / (double)sampleRate; // song's duration in sec
-        double bpm = (beatCount / durationSec) * 60.0; // beats per minute
+        double bpm = estimateBPM(monoBuffer, reader->sampleRate);
 
         delete reader;
         return bpm;
@@ -57,3 +38,73 @@ double BPMAnalyzer::estimateBPM(const File& file)
 	// Failed to read file
     return 0.0;
 }
+
+double BPMAnalyzer::estimateBPM(const AudioBuffer<float>& monoBuffer, double sampleRate)
+{
+	// Simple peak detection for BPM estimation
+	int numSamplesMono = monoBuffer.getNumSamples(); // number of samples
+    if (numSamplesMono <= 0 || sampleRate <= 0)
+        return 0.0;
+
+    float threshold = 0.5f * monoBuffer.getMagnitude(0, numSamplesMono); // magnitude threshold
+	int beatCount = 0; // count of detected beats
+	int lastSample = -10000; // last detected beat sample index
+    int minDistance = (int)sampleRate / 4; // 0.25s min distance to avoid counting the same beat
+    const float* samples = monoBuffer.getReadPointer(0);
+
+    // Check if sample is above threshold
+    for (int i = 0; i < numSamplesMono; ++i)
+    {
+        if (std::abs(samples[i]) > threshold && i - lastSample > minDistance)
+        {
+            beatCount++;
+            lastSample = i;
+        }
+    }
+
+	// Calculate BPM
+    double durationSec = numSamplesMono / sampleRate; // song's duration in sec
+    return (beatCount / durationSec) * 60.0; // beats per minute
+}
+
+double BPMAnalyzer::estimateDownbeat(const AudioBuffer<float>& monoBuffer, double sampleRate, double bpm)
+{
+    int numSamplesMono = monoBuffer.getNumSamples();
+    if (bpm <= 0.0 || numSamplesMono <= 0 || sampleRate <= 0)
+        return 0.0;
+
+    // Onset strength per 10 ms hop: how much the energy rose since the previous hop
+    const int hop = jmax(1, (int)(sampleRate * 0.01));
+    int numHops = numSamplesMono / hop;
+    const float* samples = monoBuffer.getReadPointer(0);
+    std::vector<float> onsets((size_t)numHops, 0.0f);
+    float previous = 0.0f;
+    for (int h = 0; h < numHops; ++h)
+    {
+        float energy = 0.0f;
+        for (int i = h * hop; i < (h + 1) * hop; ++i)
+            energy += samples[i] * samples[i];
+        onsets[(size_t)h] = jmax(0.0f, energy - previous);
+        previous = energy;
+    }
+
+    // Fold onto one beat, the strongest phase is where the beats fall
+    double beatHops = 60.0 / bpm * sampleRate / hop;
+    int numPhases = jmax(1, (int)beatHops);
+    std::vector<float> phaseStrength((size_t)numPhases, 0.0f);
+    for (int h = 0; h < numHops; ++h)
+        phaseStrength[(size_t)jmin(numPhases - 1, (int)std::fmod((double)h, beatHops))] += onsets[(size_t)h];
+    int phase = (int)(std::max_element(phaseStrength.begin(), phaseStrength.end()) - phaseStrength.begin());
+
+    // The bar starts on whichever of its four beats is hit hardest over the track
+    float beatStrength[4] = {};
+    for (int beat = 0; phase + beat * beatHops < numHops; ++beat)
+    {
+        int h = (int)(phase + beat * beatHops);
+        for (int near = jmax(0, h - 1); near <= jmin(numHops - 1, h + 1); ++near)
+            beatStrength[beat % 4] += onsets[(size_t)near];
+    }
+    int downbeat = (int)(std::max_element(beatStrength, beatStrength + 4) - beatStrength);
+
+    return (phase + downbeat * beatHops) * hop / sampleRate;
+}
@@ -5,6 +5,8 @@
 
     - Estimate BPM from each uploaded track in the library
     - Uses peak detection to find spikes in the volume (drum hit)
+    - Finds the first bar line (downbeat) for a known BPM, by folding the
+      energy rises of the whole track onto one beat and then one bar
 
   ==============================================================================
 */
@@ -15,4 +17,7 @@
 class BPMAnalyzer {
     public:
         double estimateBPM(const File& audioFile);
+        double estimateBPM(const AudioBuffer<float>& monoBuffer, double sampleRate);
+        // Seconds from the start of the track to its first downbeat, below one bar
+        double estimateDownbeat(const AudioBuffer<float>& monoBuffer, double sampleRate, double bpm);
 };
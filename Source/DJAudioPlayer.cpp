@@ -7,40 +7,82 @@
 */
 
 #include "DJAudioPlayer.h"
+#include "SpectrumAnalyzer.h"
+#include "MappedAudioReader.h"
 
 DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager) : formatManager(_formatManager)
 {
-
+    readAheadThread.startThread(Thread::Priority::high);
 }
 
 DJAudioPlayer::~DJAudioPlayer()
 {
-
+    // Detach the chain before its sources are deleted
+    transportSource.setSource(nullptr);
+    readAheadThread.stopThread(1000);
 }
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    parameters.prepareToPlay(sampleRate);
 }
 
 void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-    resampleSource.getNextAudioBlock(bufferToFill);
-
-    // Check if playback has reached the end
-    if (readerSource != nullptr && transportSource.getCurrentPosition() >= transportSource.getLengthInSeconds())
-    {
-        if (looping)
-        {
-            transportSource.setPosition(0.0);
-            transportSource.start();
-        }
-        else
-        {
-            transportSource.stop();
-        }
+    // Knob moves since the last block, smoothed
+    DeckParameters::Block params = parameters.nextBlock(bufferToFill.numSamples);
+    if (params.speed != speedRatio.load()) {
+        resampleSource.setResamplingRatio(params.speed);
+        speedRatio = params.speed;
+    }
+
+    // At normal speed the transport writes straight into the caller's buffer
+    bool needsResampling = speedRatio != 1.0;
+    if (needsResampling && !resamplerActive)
+        resampleSource.flushBuffers(); // drop input left over from the last resampled stretch
+    resamplerActive = needsResampling;
+
+    // A held track replaces the transport, which waits where it was; so does a stopped deck
+    bool scratching = scratchEngine.isActive();
+    bool shouldRun = running.load();
+    if (scratching)
+        scratchEngine.render(bufferToFill);
+    else if (!shouldRun && !wasRunning)
+        bufferToFill.clearActiveBufferRegion();
+    else if (resamplerActive)
+        resampleSource.getNextAudioBlock(bufferToFill);
+    else
+        transportSource.getNextAudioBlock(bufferToFill);
+
+    // Starting and stopping fade over one block, as the transport does
+    if (!scratching && shouldRun != wasRunning) {
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+            bufferToFill.buffer->applyGainRamp(ch, bufferToFill.startSample, bufferToFill.numSamples, wasRunning ? 1.0f : 0.0f, shouldRun ? 1.0f : 0.0f);
     }
+    wasRunning = shouldRun;
+
+    // Check if playback has reached the end, a looping deck never gets there (HotCueSource wraps it)
+    if (shouldRun && !looping && hotCueSource != nullptr && transportSource.getCurrentPosition() >= transportSource.getLengthInSeconds())
+        running = false;
+
+    // Gain as a ramp over the block, no steps between blocks
+    if (params.gainStart != params.gainEnd) {
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+            bufferToFill.buffer->applyGainRamp(ch, bufferToFill.startSample, bufferToFill.numSamples, params.gainStart, params.gainEnd);
+    }
+    else if (params.gainEnd != 1.0f) {
+        bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples, params.gainEnd);
+    }
+
+    // The UI reads this instead of querying the transport
+    double length = transportSource.getLengthInSeconds();
+    double current = scratching ? scratchEngine.getPosition() : transportSource.getCurrentPosition();
+    positionSnapshot = length > 0 ? current / length : 0.0;
+
+    if (auto* a = analyzer.load())
+        a->pushSamples(bufferToFill);
 }
 
 void DJAudioPlayer::releaseResources()
@@ -49,35 +91,70 @@ void DJAudioPlayer::releaseResources()
     resampleSource.releaseResources();
 }
 
-void DJAudioPlayer::loadURL(URL audioURL)
+bool DJAudioPlayer::loadURL(URL audioURL)
 {
-    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+    // Missing local files fail early instead of going through the stream
+    if (audioURL.isLocalFile() && !audioURL.getLocalFile().existsAsFile())
+        return false;
+
+    // Uncompressed files are read straight from mapped memory
+    auto* reader = MappedAudioReader::createFor(audioURL, formatManager);
     if (reader != nullptr) {
         std::unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader, true));
-        transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
+
+        // Two seconds read ahead, decoded off the audio thread
+        std::unique_ptr<BufferingAudioSource> newBuffering(new BufferingAudioSource(newSource.get(), readAheadThread, false, (int)(reader->sampleRate * 2.0), 2));
+
+        // Cue buffers are filled from their own reader so they never seek the playing one
+        std::unique_ptr<HotCueSource> newHotCues(new HotCueSource(newBuffering.get(), MappedAudioReader::createFor(audioURL, formatManager)));
+        newHotCues->setLooping(looping);
+
+        // Scratching reads from RAM windows filled by a reader of its own
+        scratchEngine.setReader(MappedAudioReader::createFor(audioURL, formatManager));
+
+        // Stays started, play/stop only switch the running flag
+        running = false;
+        transportSource.setSource(newHotCues.get(), 0, nullptr, reader->sampleRate);
+        transportSource.start();
+        hotCueSource.reset(newHotCues.release());
+        bufferingSource.reset(newBuffering.release());
         readerSource.reset(newSource.release());
         currentURL = audioURL;  // store the loaded URL
+        positionSnapshot = 0.0;
+        return true;
     }
+    return false;
 }
 
 void DJAudioPlayer::setGain(double gain)
 {
-    if (gain < 0 || gain > 1.0) {
-        std::cout << "DJAudioPlayer::setGain gain should be between 0 and 1" << std::endl;
-    }
-    else {
-        transportSource.setGain(gain);
-    }
+    // Out of range values are clamped, this may run on the audio thread
+    parameters.set(DeckParameters::gainParameter, (float)jlimit(0.0, 1.0, gain));
 }
 
 void DJAudioPlayer::setSpeed(double ratio)
 {
-    if (ratio < 0 || ratio > 100.0) {
-        std::cout << "DJAudioPlayer::setSpeed ratio should be between 0 and 100" << std::endl;
-    }
-    else {
-        resampleSource.setResamplingRatio(ratio);
-    }
+    parameters.set(DeckParameters::speedParameter, (float)jlimit(0.0, 100.0, ratio));
+}
+
+void DJAudioPlayer::setGainNow(double gain)
+{
+    parameters.jumpTo(DeckParameters::gainParameter, (float)jlimit(0.0, 1.0, gain));
+}
+
+void DJAudioPlayer::setSpeedNow(double ratio)
+{
+    parameters.jumpTo(DeckParameters::speedParameter, (float)jlimit(0.0, 100.0, ratio));
+}
+
+double DJAudioPlayer::getSpeed() const
+{
+    return speedRatio.load();
+}
+
+DeckParameters& DJAudioPlayer::getParameters()
+{
+    return parameters;
 }
 
 void DJAudioPlayer::setPosition(double posInSecs)
@@ -93,27 +170,114 @@ void DJAudioPlayer::setPositionRelative(double pos)
     else {
         double posInSecs = transportSource.getLengthInSeconds() * pos;
         setPosition(posInSecs);
+        positionSnapshot = pos; // shown right away, even before the next block
+
     }
 }
 
+double DJAudioPlayer::getPositionInSeconds() const
+{
+    return transportSource.getCurrentPosition();
+}
+
+void DJAudioPlayer::setHotCue(int slot, double seconds)
+{
+    if (hotCueSource != nullptr)
+        hotCueSource->setCue(slot, seconds);
+}
+
+double DJAudioPlayer::getHotCue(int slot) const
+{
+    return hotCueSource != nullptr ? hotCueSource->getCue(slot) : -1.0;
+}
+
+void DJAudioPlayer::triggerHotCue(int slot)
+{
+    if (hotCueSource == nullptr || hotCueSource->getCue(slot) < 0.0)
+        return;
+
+    hotCueSource->trigger(slot);
+    start();
+}
+
+double DJAudioPlayer::getLastCueLatencyMs() const
+{
+    return hotCueSource != nullptr ? hotCueSource->getLastTriggerLatencyMs() : 0.0;
+}
+
+void DJAudioPlayer::beginScratch()
+{
+    if (readerSource != nullptr)
+        scratchEngine.begin(transportSource.getCurrentPosition());
+}
+
+void DJAudioPlayer::scratchTo(double seconds)
+{
+    scratchEngine.moveTo(seconds);
+}
+
+void DJAudioPlayer::endScratch()
+{
+    if (scratchEngine.isActive())
+        transportSource.setPosition(scratchEngine.end());
+}
+
+bool DJAudioPlayer::isScratching() const
+{
+    return scratchEngine.isActive();
+}
+
 void DJAudioPlayer::start()
 {
-    transportSource.start();
+    // The transport stops by itself when it runs past the end
+    if (readerSource != nullptr && !transportSource.isPlaying())
+        transportSource.start();
+    running = true;
 }
 
 void DJAudioPlayer::stop()
 {
-    transportSource.stop();
+    running = false;
+}
+
+bool DJAudioPlayer::isPlaying() const
+{
+    return running.load();
+}
+
+void DJAudioPlayer::startNow()
+{
+    // No transport call, it was started when the track was loaded
+    running = true;
+}
+
+void DJAudioPlayer::jumpToScheduledPosition()
+{
+    if (hotCueSource != nullptr)
+        hotCueSource->triggerJump();
+}
+
+void DJAudioPlayer::prepareScheduledPosition(double seconds)
+{
+    if (hotCueSource != nullptr)
+        hotCueSource->prepareJump(seconds);
+}
+
+double DJAudioPlayer::getLengthInSeconds() const
+{
+    return transportSource.getLengthInSeconds();
 }
 
 void DJAudioPlayer::setLooping(bool shouldLoop)
 {
     looping = shouldLoop;
+    if (hotCueSource != nullptr)
+        hotCueSource->setLooping(shouldLoop);
 }
 
 bool DJAudioPlayer::getLooping() const
 {
-    return looping;
+    return looping.load();
 }
 
 URL DJAudioPlayer::getURL() const
@@ -121,9 +285,12 @@ URL DJAudioPlayer::getURL() const
     return currentURL;
 }
 
-double DJAudioPlayer::getPositionRelative()
+double DJAudioPlayer::getPositionRelative() const
 {
-    // Check for division by 0
-    double length = transportSource.getLengthInSeconds();
-    return (length > 0) ? transportSource.getCurrentPosition() / length : 0.0;
-}
\ No newline at end of file
+    return positionSnapshot.load();
+}
+
+void DJAudioPlayer::setAnalyzer(SpectrumAnalyzer* analyzerToFeed)
+{
+    analyzer = analyzerToFeed;
+}
@@ -8,8 +8,20 @@
     - An individual audio player with playback controls
     - Allows setting gain, playback speed, and position
     - Loads audio from a URL
-    - ResamplingAudioSource to control playback speed
-    - getPositionRelative() to track playhead progress
+    - ResamplingAudioSource to control playback speed, skipped at normal speed
+    - getPositionRelative() to track playhead progress, read from a snapshot
+      the audio thread writes after every block
+    - Reads ahead on a background thread, hot cues jump from RAM
+    - WAV/AIFF files are memory-mapped (MappedAudioReader)
+    - Every output block is also handed to a SpectrumAnalyzer, if one is set
+    - Gain and speed are smoothed per block by DeckParameters, which can also
+      record and replay knob automation
+    - Scratching takes over the output while the track is held, the
+      transport continues from where it was let go
+    - Play/stop is a flag the audio thread fades on, the transport itself
+      stays started; together with the *Now() calls this lets the
+      TransportScheduler start, stop, jump and set gain/speed on the audio
+      thread without locks or change messages
 
   ==============================================================================
 */
@@ -17,6 +29,11 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "HotCueSource.h"
+#include "DeckParameters.h"
+#include "ScratchEngine.h"
+
+class SpectrumAnalyzer; // forward declaration
 
 class DJAudioPlayer : public AudioSource 
 {
@@ -28,28 +45,79 @@ class DJAudioPlayer : public AudioSource
         void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
         void releaseResources() override;
 
-        void loadURL(URL audioURL);
+        // Returns false if the file could not be opened
+        bool loadURL(URL audioURL);
 
         void setGain(double gain);
         void setSpeed(double ratio);
+        double getSpeed() const; // current, smoothed ratio
+
+        // Gain/speed smoothing and automation
+        DeckParameters& getParameters();
         void setPosition(double posInSecs);
-        double getPositionRelative();
+        double getPositionRelative() const;
         void setPositionRelative(double pos);
+        double getPositionInSeconds() const;
+
+        // Hot cues in seconds, -1 for an empty slot
+        void setHotCue(int slot, double seconds);
+        double getHotCue(int slot) const;
+        // Jumps to the cue and starts playback
+        void triggerHotCue(int slot);
+        double getLastCueLatencyMs() const;
+
+        // Grab the track at the playhead, move it (seconds, either direction), let go
+        void beginScratch();
+        void scratchTo(double seconds);
+        void endScratch();
+        bool isScratching() const;
 
         void start();
-        void stop();
+        void stop(); // any thread
+        bool isPlaying() const;
+
+        // Audio thread - scheduled events, they take effect on the next sample
+        void startNow();
+        void jumpToScheduledPosition();
+        void setGainNow(double gain);
+        void setSpeedNow(double ratio);
+        // Any thread but the audio thread - decodes the audio at the next scheduled jump ahead of time
+        void prepareScheduledPosition(double seconds);
+        double getLengthInSeconds() const;
 
         // Loop track functionality
         void setLooping(bool loopTrack);
         bool getLooping() const;
         URL getURL() const;
 
+        // Output tap for the live analyzer, nullptr to disconnect
+        void setAnalyzer(SpectrumAnalyzer* analyzerToFeed);
+
     private:
         AudioFormatManager& formatManager;
+        TimeSliceThread readAheadThread{ "Deck read-ahead" };
         AudioTransportSource transportSource;
         ResamplingAudioSource resampleSource{ &transportSource, false, 2 };
         std::unique_ptr<AudioFormatReaderSource> readerSource;
+        std::unique_ptr<BufferingAudioSource> bufferingSource; // reads readerSource ahead
+        std::unique_ptr<HotCueSource> hotCueSource; // feeds the transport
 
-        bool looping = false;
+        std::atomic<bool> looping{ false }; // read by the audio thread
         URL currentURL;
+
+        DeckParameters parameters;
+        ScratchEngine scratchEngine;
+
+        // Playback speed, 1.0 bypasses the resampler and its extra buffer copy
+        std::atomic<double> speedRatio{ 1.0 }; // written by the audio thread
+        bool resamplerActive = false; // audio thread only
+
+        // Play/stop, the transport only stops by itself at the end of the track
+        std::atomic<bool> running{ false };
+        bool wasRunning = false; // audio thread only
+
+        // Relative playhead, written by the audio thread for the UI
+        std::atomic<double> positionSnapshot{ 0.0 };
+
+        std::atomic<SpectrumAnalyzer*> analyzer{ nullptr };
 };
@@ -14,10 +14,16 @@
 DeckGUI::DeckGUI(
     DJAudioPlayer* _player,
     AudioFormatManager& formatManagerToUse,
-    AudioThumbnailCache& cacheToUse
+    ThumbnailStore& cacheToUse,
+    TrackStore& trackStoreToUse,
+    DeckMixer& mixerToUse,
+    int deckIndexInMixer
 ) :
+    waveformDisplay(formatManagerToUse, cacheToUse),
     player(_player),
-    waveformDisplay(formatManagerToUse, cacheToUse)
+    trackStore(trackStoreToUse),
+    mixer(mixerToUse),
+    deckIndex(deckIndexInMixer)
 {
     // Play button
     addAndMakeVisible(playButton);
@@ -49,6 +55,11 @@ DeckGUI::DeckGUI(
     spectrogramButton.addListener(this);
     spectrogramButton.setLookAndFeel(&buttonDesign);
 
+    // Automation button
+    addAndMakeVisible(automationButton);
+    automationButton.setLookAndFeel(&buttonDesign);
+    automationButton.onClick = [this] { showAutomationMenu(); };
+
     // Volume slider
     addAndMakeVisible(volSlider);
     volSlider.addListener(this);
@@ -86,9 +97,53 @@ DeckGUI::DeckGUI(
     speedLabel.setColour(Label::textColourId, ColourPalette::textColour);
     speedLabel.setJustificationType(Justification::centred);
 
+    // EQ knobs, turning one all the way down kills the band
+    const char* bandNames[] = { "LOW", "MID", "HIGH" };
+    for (int band = 0; band < DeckMixer::numBands; ++band) {
+        addAndMakeVisible(eqKnobs[band]);
+        eqKnobs[band].setSliderStyle(Slider::Rotary);
+        eqKnobs[band].setRange(0.0, 2.0);
+        eqKnobs[band].setValue(1.0);
+        eqKnobs[band].setDoubleClickReturnValue(true, 1.0);
+        eqKnobs[band].setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+        eqKnobs[band].setColour(Slider::thumbColourId, ColourPalette::tertiaryColour);
+        eqKnobs[band].onValueChange = [this, band] { mixer.setEQ(deckIndex, (DeckMixer::Band)band, (float)eqKnobs[band].getValue()); };
+        addAndMakeVisible(eqLabels[band]);
+        eqLabels[band].setText(bandNames[band], dontSendNotification);
+        eqLabels[band].setColour(Label::textColourId, ColourPalette::textColour);
+        eqLabels[band].setJustificationType(Justification::centred);
+    }
+
+    // Headphone cue button
+    addAndMakeVisible(headphoneCueButton);
+    headphoneCueButton.setLookAndFeel(&buttonDesign);
+    headphoneCueButton.setClickingTogglesState(true);
+    headphoneCueButton.setColour(TextButton::textColourOnId, ColourPalette::accentColour);
+    headphoneCueButton.onClick = [this] { mixer.setCue(deckIndex, headphoneCueButton.getToggleState()); };
+
+    // Hot cue pads
+    for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot) {
+        addAndMakeVisible(cueButtons[slot]);
+        cueButtons[slot].setButtonText(String(slot + 1));
+        cueButtons[slot].setLookAndFeel(&buttonDesign);
+        cueButtons[slot].onClick = [this, slot] { cueButtonClicked(slot); };
+    }
+    updateCueButtons();
+
     addAndMakeVisible(waveformDisplay);
 
-    startTimer(500);
+    // Scratching, relative to where the track was grabbed
+    waveformDisplay.onScratchStart = [this] {
+        scratchGrabSeconds = player->getPositionInSeconds();
+        player->beginScratch();
+    };
+    waveformDisplay.onScratchMove = [this](double offset) { player->scratchTo(scratchGrabSeconds + offset); };
+    waveformDisplay.onScratchEnd = [this] { player->endScratch(); };
+
+    // Live spectrum of what the deck plays
+    addAndMakeVisible(spectrumAnalyzer);
+    if (player != nullptr)
+        player->setAnalyzer(&spectrumAnalyzer);
 }
 
 DeckGUI::~DeckGUI()
@@ -98,9 +153,14 @@ DeckGUI::~DeckGUI()
     loadButton.setLookAndFeel(nullptr);
     loopButton.setLookAndFeel(nullptr);
     openLibraryButton.setLookAndFeel(nullptr);
+    headphoneCueButton.setLookAndFeel(nullptr);
+    automationButton.setLookAndFeel(nullptr);
+    for (auto& cueButton : cueButtons)
+        cueButton.setLookAndFeel(nullptr);
     loopButton.removeListener(this);
     speedKnob.removeListener(this);
-    stopTimer();
+    if (player != nullptr)
+        player->setAnalyzer(nullptr);
 }
 
 void DeckGUI::paint(Graphics& g)
@@ -113,32 +173,48 @@ void DeckGUI::paint(Graphics& g)
 void DeckGUI::resized()
 {
     int padding = 4;
-	double rowH = getHeight() / 7; // divide height into 7 rows
+	double rowH = getHeight() / 9; // divide height into 9 rows
 	int buttonWidth = (getWidth() - padding * 4) / 3; // divide width into 3 columns with padding
     int buttonHeight = rowH - padding * 2; // set height with padding
 
-	// First section - LOAD, LIBRARY, SPECTROGRAM buttons
-    loadButton.setBounds(padding, padding, buttonWidth, buttonHeight);
-    openLibraryButton.setBounds(padding * 2 + buttonWidth, padding, buttonWidth, buttonHeight);
-    spectrogramButton.setBounds(padding * 3 + buttonWidth * 2, padding, buttonWidth, buttonHeight);
-
-	// Second section - WAVEFORM/SPECTROGRAM display (3 rows high)
-    waveformDisplay.setBounds(padding, rowH + padding, getWidth() - padding * 2, rowH * 3 - padding);
+	// First section - LOAD, LIBRARY, SPECTROGRAM, AUTOMATION buttons (4 columns)
+    int topWidth = (getWidth() - padding * 5) / 4;
+    loadButton.setBounds(padding, padding, topWidth, buttonHeight);
+    openLibraryButton.setBounds(padding * 2 + topWidth, padding, topWidth, buttonHeight);
+    spectrogramButton.setBounds(padding * 3 + topWidth * 2, padding, topWidth, buttonHeight);
+    automationButton.setBounds(padding * 4 + topWidth * 3, padding, topWidth, buttonHeight);
+
+	// Second section - WAVEFORM/SPECTROGRAM display (2 rows high) and live SPECTRUM below
+    waveformDisplay.setBounds(padding, rowH + padding, getWidth() - padding * 2, rowH * 2 - padding);
+    spectrumAnalyzer.setBounds(padding, rowH * 3 + padding, getWidth() - padding * 2, rowH - padding);
+
+	// Third section - HOT CUE pads
+    int cueWidth = (getWidth() - padding * (HotCueSource::maxHotCues + 1)) / HotCueSource::maxHotCues;
+    for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot)
+        cueButtons[slot].setBounds(padding + slot * (cueWidth + padding), rowH * 4 + padding, cueWidth, buttonHeight);
+
+	// Fourth section - LOW, MID, HIGH knobs
+    for (int band = 0; band < DeckMixer::numBands; ++band) {
+        eqKnobs[band].setBounds(padding + band * (buttonWidth + padding), rowH * 5, buttonWidth, rowH * 0.75);
+        eqLabels[band].setBounds(eqKnobs[band].getX(), rowH * 5.7, buttonWidth, rowH * 0.3);
+    }
 
-	// Third section - SPEED knob, VOLUME and POSITION sliders
-    speedKnob.setBounds(1, rowH * 4.5, getWidth() / 3, rowH);
-    speedLabel.setBounds(speedKnob.getX(), rowH * 5.25, getWidth() / 3, rowH / 2);
+	// Fifth section - SPEED knob, VOLUME and POSITION sliders
+    speedKnob.setBounds(1, rowH * 6.5, getWidth() / 3, rowH);
+    speedLabel.setBounds(speedKnob.getX(), rowH * 7.25, getWidth() / 3, rowH / 2);
 
-    volSlider.setBounds(getWidth() / 3, rowH * 4, getWidth() - speedKnob.getWidth() - 10, rowH);
+    volSlider.setBounds(getWidth() / 3, rowH * 6, getWidth() - speedKnob.getWidth() - 10, rowH);
     volLabel.setBounds(getWidth() / 3, volSlider.getY(), volSlider.getWidth(), rowH / 2);
 
-    posSlider.setBounds(getWidth() / 3, rowH * 5, getWidth() - speedKnob.getWidth() - 10, rowH);
+    posSlider.setBounds(getWidth() / 3, rowH * 7, getWidth() - speedKnob.getWidth() - 10, rowH);
     posLabel.setBounds(getWidth() / 3, posSlider.getY(), posSlider.getWidth(), rowH / 2);
 
-	// Fourth section - PLAY, STOP, LOOP buttons
-    playButton.setBounds(padding, rowH * 6 + padding, buttonWidth, buttonHeight);
-    stopButton.setBounds(padding * 2 + buttonWidth, rowH * 6 + padding, buttonWidth, buttonHeight);
-    loopButton.setBounds(padding * 3 + buttonWidth * 2, rowH * 6 + padding, buttonWidth, buttonHeight);
+	// Sixth section - PLAY, STOP, LOOP, CUE buttons (4 columns)
+    int transportWidth = (getWidth() - padding * 5) / 4;
+    playButton.setBounds(padding, rowH * 8 + padding, transportWidth, buttonHeight);
+    stopButton.setBounds(padding * 2 + transportWidth, rowH * 8 + padding, transportWidth, buttonHeight);
+    loopButton.setBounds(padding * 3 + transportWidth * 2, rowH * 8 + padding, transportWidth, buttonHeight);
+    headphoneCueButton.setBounds(padding * 4 + transportWidth * 3, rowH * 8 + padding, transportWidth, buttonHeight);
 }
 
 void DeckGUI::buttonClicked(Button* button)
@@ -156,13 +232,12 @@ void DeckGUI::buttonClicked(Button* button)
         // Set flag to select single files
         auto fileChooserFlags = FileBrowserComponent::canSelectFiles;
 
-        fChooser.launchAsync(fileChooserFlags, [player = player, &waveform = waveformDisplay](const FileChooser& chooser)
+        fChooser.launchAsync(fileChooserFlags, [this](const FileChooser& chooser)
             {
                 File chosenFile = chooser.getResult();
                 if (chosenFile.exists()) {
                     URL url{ chosenFile };
-                    player->loadURL(url);
-                    waveform.loadURL(url);
+                    loadTrack(url);
                 }
             });
 
@@ -212,28 +287,192 @@ void DeckGUI::filesDropped(const StringArray& files, int x, int y)
 {
     if (files.size() >= 1) {
         URL fileUrl = URL{ File{files[0]} };
-        player->loadURL(fileUrl);
-        waveformDisplay.loadURL(fileUrl);
+        loadTrack(fileUrl);
     }
 }
 
-void DeckGUI::timerCallback()
+void DeckGUI::refresh()
 {
     double pos = player->getPositionRelative();
     waveformDisplay.setPositionRelative(pos);
-    posSlider.setValue(pos, dontSendNotification);
+
+    // Only touch the slider once the thumb would move by a pixel
+    if (std::abs(pos - posSlider.getValue()) * posSlider.getWidth() >= 1.0)
+        posSlider.setValue(pos, dontSendNotification);
+
+    spectrumAnalyzer.refresh();
+    updateAutomationButton();
 }
 
 void DeckGUI::openLibraryWindow()
 {
     // Add 'this' as argument to the library so it knows to which DeckGUI to load the track
-    new MusicLibraryWindow(new MusicLibrary(this));
+    if (libraryWindow == nullptr)
+        libraryWindow = std::make_unique<MusicLibraryWindow>(new MusicLibrary(trackStore, this, autoDJ));
+
+    // Reopen the same window after it was closed
+    libraryWindow->setVisible(true);
+    libraryWindow->toFront(true);
+}
+
+void DeckGUI::setAutoDJ(AutoDJ* autoDJToUse)
+{
+    autoDJ = autoDJToUse;
 }
 
-void DeckGUI::loadTrack(URL& url)
+DJAudioPlayer* DeckGUI::getPlayer() const
 {
-    if (player != nullptr) {
-        player->loadURL(url);
+    return player;
+}
+
+void DeckGUI::showSpeed(double ratio)
+{
+    speedKnob.setValue(ratio, dontSendNotification);
+}
+
+bool DeckGUI::loadTrack(URL& url)
+{
+    if (player != nullptr && player->loadURL(url)) {
         waveformDisplay.loadURL(url);
+        loadHotCues();
+        return true;
     }
+    return false;
+}
+
+var DeckGUI::getSessionState() const
+{
+    DynamicObject* obj = new DynamicObject();
+    if (player != nullptr && !player->getURL().isEmpty()) {
+        obj->setProperty("url", player->getURL().toString(false));
+        obj->setProperty("position", player->getPositionInSeconds());
+        // Thumbnail cache key, also tells whether the file changed since
+        obj->setProperty("thumbnail", String::toHexString(waveformDisplay.getContentHash()));
+    }
+    obj->setProperty("gain", volSlider.getValue());
+    obj->setProperty("speed", speedKnob.getValue());
+    obj->setProperty("loop", looping);
+    obj->setProperty("cue", headphoneCueButton.getToggleState());
+    var eq;
+    for (auto& knob : eqKnobs)
+        eq.append(knob.getValue());
+    obj->setProperty("eq", eq);
+    // Cues live on the player too, a track loaded from outside the library has no other copy
+    var cues;
+    for (int slot = 0; player != nullptr && slot < HotCueSource::maxHotCues; ++slot)
+        cues.append(player->getHotCue(slot));
+    obj->setProperty("hotCues", cues);
+    return var(obj);
+}
+
+void DeckGUI::restoreSessionState(const var& state)
+{
+    auto* obj = state.getDynamicObject();
+    if (obj == nullptr || player == nullptr)
+        return;
+
+    // Controls first so the player starts with the saved settings
+    volSlider.setValue(obj->getProperty("gain").isVoid() ? 1.0 : (double)obj->getProperty("gain"), sendNotificationSync);
+    speedKnob.setValue(obj->getProperty("speed").isVoid() ? 1.0 : (double)obj->getProperty("speed"), sendNotificationSync);
+    if (auto* eq = obj->getProperty("eq").getArray()) {
+        for (int band = 0; band < jmin(eq->size(), (int)DeckMixer::numBands); ++band)
+            eqKnobs[band].setValue((double)eq->getReference(band), sendNotificationSync);
+    }
+
+    looping = obj->getProperty("loop");
+    player->setLooping(looping);
+    loopButton.setButtonText(looping ? "LOOP ON" : "LOOP OFF");
+
+    bool cue = obj->getProperty("cue");
+    headphoneCueButton.setToggleState(cue, dontSendNotification);
+    mixer.setCue(deckIndex, cue);
+
+    // Track ready to play at the saved position, the waveform comes from the thumbnail cache
+    URL url(obj->getProperty("url").toString());
+    if (url.isEmpty() || !loadTrack(url))
+        return;
+
+    bool sameFile = obj->getProperty("thumbnail").toString() == String::toHexString(waveformDisplay.getContentHash());
+    if (!sameFile)
+        return;
+
+    // Saved cues win over the library's, they are what the deck had
+    if (auto* cues = obj->getProperty("hotCues").getArray()) {
+        for (int slot = 0; slot < jmin(cues->size(), (int)HotCueSource::maxHotCues); ++slot)
+            player->setHotCue(slot, (double)cues->getReference(slot));
+        updateCueButtons();
+    }
+    player->setPosition((double)obj->getProperty("position"));
+}
+
+void DeckGUI::cueButtonClicked(int slot)
+{
+    if (player == nullptr)
+        return;
+
+    double cue = player->getHotCue(slot);
+    double newCue = cue;
+
+    // Shift-click clears, an empty pad stores the playhead, a set pad jumps
+    if (ModifierKeys::currentModifiers.isShiftDown())
+        newCue = -1.0;
+    else if (cue < 0.0)
+        newCue = player->getPositionInSeconds();
+    else
+        player->triggerHotCue(slot);
+
+    if (newCue != cue) {
+        player->setHotCue(slot, newCue);
+        // Only library tracks keep their cues
+        trackStore.setHotCue(trackStore.findTrack(player->getURL()), slot, newCue);
+        updateCueButtons();
+    }
+}
+
+void DeckGUI::loadHotCues()
+{
+    // Only hands the positions over, the cue audio is decoded on the deck's cue thread
+    int index = trackStore.findTrack(player->getURL());
+    for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot) {
+        // Array::operator[] gives 0.0 past the end, which is a valid cue
+        double cue = index >= 0 && slot < trackStore.getHotCues(index).size() ? trackStore.getHotCues(index)[slot] : -1.0;
+        player->setHotCue(slot, cue);
+    }
+    updateCueButtons();
+}
+
+void DeckGUI::updateCueButtons()
+{
+    // Set pads are highlighted
+    for (int slot = 0; slot < HotCueSource::maxHotCues; ++slot) {
+        bool isSet = player != nullptr && player->getHotCue(slot) >= 0.0;
+        cueButtons[slot].setColour(TextButton::textColourOffId, isSet ? ColourPalette::accentColour : ColourPalette::textColour.withAlpha(0.5f));
+    }
+}
+
+void DeckGUI::showAutomationMenu()
+{
+    if (player == nullptr)
+        return;
+
+    DeckParameters& parameters = player->getParameters();
+    bool hasRecording = parameters.getNumRecordedPoints() > 0;
+
+    PopupMenu menu;
+    if (parameters.isRecording() || parameters.isPlayingBack())
+        menu.addItem("Stop", [&parameters] { parameters.stopAutomation(); });
+    else
+        menu.addItem("Record volume and speed", [&parameters] { parameters.startRecording(); });
+    menu.addItem("Play back", hasRecording && !parameters.isRecording(), false, [&parameters] { parameters.startPlayback(false); });
+    menu.addItem("Loop playback", hasRecording && !parameters.isRecording(), false, [&parameters] { parameters.startPlayback(true); });
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&automationButton));
+}
+
+void DeckGUI::updateAutomationButton()
+{
+    // Playback that runs out stops by itself, so this is checked every frame
+    DeckParameters& parameters = player->getParameters();
+    String text = parameters.isRecording() ? "AUTO REC" : parameters.isPlayingBack() ? "AUTO PLAY" : "AUTOMATION";
+    if (automationButton.getButtonText() != text)
+        automationButton.setButtonText(text);
 }
@@ -8,9 +8,16 @@
     - User interface for a single deck (one DJAudioPlayer)
 	- Buttons: Play, Stop, Load, Library, Loop, Spectrogram/Waveform
     - Sliders: Volume, Speed (knob), Position
+    - Hot cue pads 1-8: set at the playhead, jump, shift-click clears
+    - EQ knobs: low, mid and high band of this deck in the DeckMixer
+    - CUE button sends the deck to the headphone bus
+    - AUTOMATION menu records and replays volume and speed knob moves
+    - Dragging on the waveform scratches the track
     - WaveformDisplay: shows track waveform
+    - SpectrumAnalyzer: live scrolling spectrogram of the deck's output
     - FileDragAndDropTarget: allows drag-and-drop loading
-    - Timer: updates waveform playhead every 500 ms
+    - RefreshClock listener: moves the playhead and position slider every frame
+    - Session state: track, position and controls as a JSON object
 
   ==============================================================================
 */
@@ -22,16 +29,22 @@
 #include "MusicLibrary.h"
 #include "WaveformDisplay.h"
 #include "ButtonLookAndFeel.h"
+#include "DeckMixer.h"
+#include "RefreshClock.h"
+#include "SpectrumAnalyzer.h"
 
+class MusicLibraryWindow; // forward declaration
+class AutoDJ;
 
 class DeckGUI : public Component,
     public Button::Listener,
     public Slider::Listener,
     public FileDragAndDropTarget,
-    public Timer
+    public RefreshClock::Listener
 {
     public:
-        DeckGUI(DJAudioPlayer* player, AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse);
+        DeckGUI(DJAudioPlayer* player, AudioFormatManager& formatManagerToUse, ThumbnailStore& cacheToUse, TrackStore& trackStoreToUse,
+            DeckMixer& mixerToUse, int deckIndexInMixer);
         ~DeckGUI();
 
         void paint(Graphics&) override;
@@ -46,12 +59,23 @@ class DeckGUI : public Component,
         bool isInterestedInFileDrag(const StringArray& files) override;
         void filesDropped(const StringArray& files, int x, int y) override;
 
-        void timerCallback() override;
+        void refresh() override;
 
         // Function to open library
         void openLibraryWindow();
 
-        void loadTrack(URL& url);
+        // Lets the library queue tracks for the auto-DJ
+        void setAutoDJ(AutoDJ* autoDJToUse);
+        DJAudioPlayer* getPlayer() const;
+        // Moves the speed knob to a ratio the player already has, e.g. after the auto-DJ matched tempos
+        void showSpeed(double ratio);
+
+        // Returns false if the player could not open the track
+        bool loadTrack(URL& url);
+
+        // Loaded track, position and control values, for session.json
+        var getSessionState() const;
+        void restoreSessionState(const var& state);
 
     private:
         FileChooser fChooser{ "Select a file..." };
@@ -71,17 +95,37 @@ class DeckGUI : public Component,
         TextButton loadButton{ "LOAD" };
         TextButton openLibraryButton{ "LIBRARY" }; // new button to open music library
 		TextButton spectrogramButton{ "DISPLAY SPECTROGRAM" }; // new button to toggle spectrogram/waveform
+        TextButton cueButtons[HotCueSource::maxHotCues]; // hot cue pads
+        TextButton headphoneCueButton{ "CUE" }; // pre-listen on the cue bus
+        TextButton automationButton{ "AUTOMATION" }; // record/replay knob moves
 
         Slider speedKnob; // new rotary knob for speed control
         Slider volSlider;
         Slider posSlider;
+        Slider eqKnobs[DeckMixer::numBands]; // low, mid, high
+        Label eqLabels[DeckMixer::numBands];
 
         WaveformDisplay waveformDisplay;
+        SpectrumAnalyzer spectrumAnalyzer;
         DJAudioPlayer* player;
+        TrackStore& trackStore; // shared library data
+        DeckMixer& mixer;
+        int deckIndex; // this deck's channel in the mixer
+        AutoDJ* autoDJ = nullptr;
+        double scratchGrabSeconds = 0.0; // where the waveform was grabbed
 
-		std::unique_ptr<juce::DialogWindow> libraryWindow; // pointer to dialog window
+		std::unique_ptr<MusicLibraryWindow> libraryWindow; // library window, created on first open
 
         bool looping = false; // new function for looping a song
 
+        // Hot cue pads
+        void cueButtonClicked(int slot);
+        void loadHotCues();
+        void updateCueButtons();
+
+        // Knob automation
+        void showAutomationMenu();
+        void updateAutomationButton();
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckGUI)
 };
@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    DeckMixer.cpp
+
+  ==============================================================================
+*/
+
+#include "DeckMixer.h"
+
+DeckMixer::DeckMixer()
+{
+    for (auto& deck : eqTargets)
+        for (auto& target : deck)
+            target = 1.0f;
+    for (auto& cue : cueEnabled)
+        cue = false;
+}
+
+DeckMixer::~DeckMixer()
+{
+
+}
+
+void DeckMixer::addDeck(AudioSource* deck, Side side)
+{
+    jassert(numDecks < maxDecks);
+    if (numDecks >= maxDecks)
+        return;
+
+    decks[numDecks].source = deck;
+    decks[numDecks].side = side;
+    ++numDecks;
+}
+
+void DeckMixer::setCrossfader(float position)
+{
+    crossfader = jlimit(0.0f, 1.0f, position);
+}
+
+void DeckMixer::setCrossfaderCurve(CrossfaderCurve curve)
+{
+    crossfaderCurve = curve;
+}
+
+void DeckMixer::setEQ(int deck, Band band, float gain)
+{
+    if (deck >= 0 && deck < maxDecks && band >= 0 && band < numBands)
+        eqTargets[deck][band] = jmax(0.0f, gain);
+}
+
+void DeckMixer::setCue(int deck, bool shouldCue)
+{
+    if (deck >= 0 && deck < maxDecks)
+        cueEnabled[deck] = shouldCue;
+}
+
+void DeckMixer::setCueMix(float mix)
+{
+    cueMix = jlimit(0.0f, 1.0f, mix);
+}
+
+double DeckMixer::getCpuLoad() const
+{
+    return cpuLoad.load();
+}
+
+void DeckMixer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    blockSize = jmax(1, samplesPerBlockExpected);
+
+    // One block for all scratch channels, each channel starts on a 64-byte boundary
+    const int floatsPerLine = 16;
+    int stride = (blockSize + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    scratchMemory.allocate((size_t)(maxDecks * 2 * stride + floatsPerLine), true);
+    auto* base = reinterpret_cast<float*>((reinterpret_cast<pointer_sized_int>(scratchMemory.get()) + 63) & ~(pointer_sized_int)63);
+    for (int d = 0; d < maxDecks; ++d)
+        for (int ch = 0; ch < 2; ++ch)
+            scratch[d][ch] = base + (d * 2 + ch) * stride;
+
+    // Room for the widest register, 16 lanes
+    laneMemory.allocate((size_t)(stride * floatsPerLine + floatsPerLine), true);
+    laneBlock = reinterpret_cast<float*>((reinterpret_cast<pointer_sized_int>(laneMemory.get()) + 63) & ~(pointer_sized_int)63);
+
+    for (int d = 0; d < numDecks; ++d)
+    {
+        decks[d].source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+        deckGains[d].reset(sampleRate, 0.02);
+        deckGains[d].setCurrentAndTargetValue(getCrossfaderGain(decks[d].side));
+        cueGains[d].reset(sampleRate, 0.02);
+        cueGains[d].setCurrentAndTargetValue(cueEnabled[d] ? 1.0f : 0.0f);
+        for (int b = 0; b < numBands; ++b) {
+            eqGains[d][b].reset(sampleRate, 0.05);
+            eqGains[d][b].setCurrentAndTargetValue(eqTargets[d][b]);
+        }
+    }
+    cueMixGain.reset(sampleRate, 0.02);
+    cueMixGain.setCurrentAndTargetValue(cueMix);
+
+    // Linkwitz-Riley 4th order = two Butterworth stages, the all-pass keeps the low band in phase with the rest
+    using Coefficients = dsp::IIR::Coefficients<float>;
+    const float butterworthQ = MathConstants<float>::sqrt2 * 0.5f;
+    Coefficients::Ptr lowPass = Coefficients::makeLowPass(sampleRate, lowMidFrequency, butterworthQ);
+    Coefficients::Ptr lowHighPass = Coefficients::makeHighPass(sampleRate, lowMidFrequency, butterworthQ);
+    Coefficients::Ptr allPass = Coefficients::makeAllPass(sampleRate, midHighFrequency, butterworthQ);
+    Coefficients::Ptr midLowPass = Coefficients::makeLowPass(sampleRate, midHighFrequency, butterworthQ);
+    Coefficients::Ptr highPass = Coefficients::makeHighPass(sampleRate, midHighFrequency, butterworthQ);
+    Coefficients::Ptr stages[numStages] = { lowPass, lowPass, allPass, lowHighPass, lowHighPass, midLowPass, midLowPass, highPass, highPass };
+
+    for (auto& group : filters) {
+        for (int s = 0; s < numStages; ++s) {
+            group[s].coefficients = stages[s];
+            group[s].reset();
+        }
+    }
+}
+
+void DeckMixer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    ScopedNoDenormals noDenormals;
+    auto startTicks = Time::getHighResolutionTicks();
+
+    if (blockSize == 0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    // Blocks bigger than announced are mixed in prepared-size pieces
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        int numSamples = jmin(blockSize, bufferToFill.numSamples - done);
+        renderBlock(*bufferToFill.buffer, bufferToFill.startSample + done, numSamples);
+        done += numSamples;
+    }
+
+    double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    double budget = bufferToFill.numSamples / currentSampleRate;
+    cpuLoad = 0.9 * cpuLoad.load() + 0.1 * (seconds / budget);
+}
+
+void DeckMixer::releaseResources()
+{
+    blockSize = 0;
+    for (int d = 0; d < numDecks; ++d)
+        decks[d].source->releaseResources();
+    scratchMemory.free();
+    laneMemory.free();
+    laneBlock = nullptr;
+}
+
+void DeckMixer::renderBlock(AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    // The first deck can use the device buffer itself, which saves a copy and a clear
+    bool firstDeckInOutput = numDecks > 0 && output.getNumChannels() >= 2;
+
+    float* channels[maxDecks][2] = {};
+    for (int d = 0; d < numDecks; ++d)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            channels[d][ch] = d == 0 && firstDeckInOutput ? output.getWritePointer(ch, startSample) : scratch[d][ch];
+
+        // A view, no allocation or copy
+        AudioBuffer<float> view(channels[d], 2, numSamples);
+        AudioSourceChannelInfo info(&view, 0, numSamples);
+        decks[d].source->getNextAudioBlock(info);
+    }
+
+    applyEQ(channels, numSamples);
+
+    // The cue bus takes the decks pre-fader, before the master gains touch them
+    bool hasCueBus = output.getNumChannels() >= 4;
+    if (hasCueBus)
+        renderCueBus(output, channels, startSample, numSamples);
+
+    int numChannels = jmin(2, output.getNumChannels());
+    if (!firstDeckInOutput)
+        output.clear(startSample, numSamples);
+
+    // Crossfader gains ramp over the block, summed straight into the device buffer
+    for (int d = 0; d < numDecks; ++d)
+    {
+        deckGains[d].setTargetValue(getCrossfaderGain(decks[d].side));
+        float startGain = deckGains[d].getCurrentValue();
+        float endGain = deckGains[d].skip(numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            if (d == 0 && firstDeckInOutput)
+                output.applyGainRamp(ch, startSample, numSamples, startGain, endGain);
+            else
+                output.addFromWithRamp(ch, startSample, channels[d][ch], numSamples, startGain, endGain);
+        }
+    }
+
+    // Blend the master into the headphones
+    if (hasCueBus)
+    {
+        cueMixGain.setTargetValue(cueMix);
+        float startMix = cueMixGain.getCurrentValue();
+        float endMix = cueMixGain.skip(numSamples);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            output.applyGainRamp(ch + 2, startSample, numSamples, 1.0f - startMix, 1.0f - endMix);
+            output.addFromWithRamp(ch + 2, startSample, output.getReadPointer(ch, startSample), numSamples, startMix, endMix);
+        }
+    }
+
+    // Nothing is routed to any further outputs
+    for (int ch = hasCueBus ? 4 : 2; ch < output.getNumChannels(); ++ch)
+        output.clear(ch, startSample, numSamples);
+}
+
+void DeckMixer::renderCueBus(AudioBuffer<float>& output, float* (&channels)[maxDecks][2], int startSample, int numSamples)
+{
+    output.clear(2, startSample, numSamples);
+    output.clear(3, startSample, numSamples);
+
+    // Same deck audio as the master gets, no second render
+    for (int d = 0; d < numDecks; ++d)
+    {
+        cueGains[d].setTargetValue(cueEnabled[d] ? 1.0f : 0.0f);
+        float startGain = cueGains[d].getCurrentValue();
+        float endGain = cueGains[d].skip(numSamples);
+        if (startGain == 0.0f && endGain == 0.0f)
+            continue;
+
+        for (int ch = 0; ch < 2; ++ch)
+            output.addFromWithRamp(ch + 2, startSample, channels[d][ch], numSamples, startGain, endGain);
+    }
+}
+
+void DeckMixer::applyEQ(float* (&deckChannels)[maxDecks][2], int numSamples)
+{
+    const int width = (int)Register::size();
+    const int numLanes = numDecks * 2;
+    const int numGroups = (numLanes + width - 1) / width;
+
+    // Smoothed gains become a straight ramp per block
+    float rampStart[maxDecks][numBands];
+    float rampStep[maxDecks][numBands];
+    for (int d = 0; d < numDecks; ++d) {
+        for (int b = 0; b < numBands; ++b) {
+            eqGains[d][b].setTargetValue(eqTargets[d][b]);
+            rampStart[d][b] = eqGains[d][b].getCurrentValue();
+            rampStep[d][b] = (eqGains[d][b].skip(numSamples) - rampStart[d][b]) / numSamples;
+        }
+    }
+
+    for (int g = 0; g < numGroups; ++g)
+    {
+        // Lane i of this group is channel (lane % 2) of deck (lane / 2), unused lanes stay silent
+        alignas(64) float laneGains[numBands][16] = {};
+        alignas(64) float laneSteps[numBands][16] = {};
+        float* channels[16] = {};
+
+        for (int i = 0; i < width; ++i)
+        {
+            int lane = g * width + i;
+            if (lane >= numLanes)
+                continue;
+
+            channels[i] = deckChannels[lane / 2][lane % 2];
+            for (int b = 0; b < numBands; ++b) {
+                laneGains[b][i] = rampStart[lane / 2][b];
+                laneSteps[b][i] = rampStep[lane / 2][b];
+            }
+        }
+
+        Register gains[numBands], steps[numBands];
+        for (int b = 0; b < numBands; ++b) {
+            gains[b] = Register::fromRawArray(laneGains[b]);
+            steps[b] = Register::fromRawArray(laneSteps[b]);
+        }
+
+        // Each channel is copied in one contiguous run into its lane, the sample loop then loads whole registers
+        for (int i = 0; i < width; ++i)
+        {
+            float* lane = laneBlock + i;
+            for (int n = 0; n < numSamples; ++n)
+                lane[n * width] = channels[i] != nullptr ? channels[i][n] : 0.0f;
+        }
+
+        Filter* stage = filters[g];
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float* frame = laneBlock + n * width;
+            Register in = Register::fromRawArray(frame);
+
+            // Low band, phase matched to mid + high
+            Register low = stage[2].processSample(stage[1].processSample(stage[0].processSample(in)));
+            // Everything above the low band, split again into mid and high
+            Register upper = stage[4].processSample(stage[3].processSample(in));
+            Register mid = stage[6].processSample(stage[5].processSample(upper));
+            Register high = stage[8].processSample(stage[7].processSample(upper));
+
+            Register out = low * gains[lowBand] + mid * gains[midBand] + high * gains[highBand];
+            for (int b = 0; b < numBands; ++b)
+                gains[b] += steps[b];
+
+            out.copyToRawArray(frame);
+        }
+
+        for (int i = 0; i < width; ++i)
+        {
+            if (channels[i] == nullptr)
+                continue;
+            const float* lane = laneBlock + i;
+            for (int n = 0; n < numSamples; ++n)
+                channels[i][n] = lane[n * width];
+        }
+    }
+}
+
+float DeckMixer::getCrossfaderGain(Side side) const
+{
+    if (side == throughSide)
+        return 1.0f;
+
+    // Distance from this deck's end of the fader, 0 = fader fully on this side
+    float x = side == leftSide ? crossfader.load() : 1.0f - crossfader.load();
+
+    switch (crossfaderCurve.load()) {
+        case linearCurve: return 1.0f - x;
+        case cutCurve: return jmin(1.0f, (1.0f - x) * 16.0f); // full level until the far end
+        default: return std::cos(x * MathConstants<float>::halfPi);
+    }
+}
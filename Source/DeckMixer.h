@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    DeckMixer.h
+
+    ### Mixes the decks through a crossfader and a 3-band kill EQ ###
+
+    - Replaces MixerAudioSource, the first deck renders straight into the device
+      buffer and the others into views of one preallocated, 64-byte aligned block
+    - EQ and crossfader work in place, the sum goes directly into the device buffer
+    - Crossfader with linear, constant power and cut curves
+    - 3-band EQ per deck from Linkwitz-Riley crossovers (juce_dsp IIR filters)
+    - The EQ runs on SIMDRegister lanes, each lane is one channel of one deck;
+      the channels are copied into a lane-major block first, so every sample
+      is one aligned register load
+    - Gains are smoothed, nothing is allocated in getNextAudioBlock
+    - Cue bus on outputs 3/4: decks flagged for cue go there pre-fader, blended
+      with the master. Each deck is rendered once and fanned out to both buses
+    - getCpuLoad() reports the share of the block time spent mixing
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class DeckMixer : public AudioSource
+{
+    public:
+        enum CrossfaderCurve { linearCurve, constantPowerCurve, cutCurve };
+        enum Side { leftSide, rightSide, throughSide }; // crossfader assignment
+        enum Band { lowBand, midBand, highBand, numBands };
+        enum { maxDecks = 4 };
+
+        DeckMixer();
+        ~DeckMixer() override;
+
+        // Call before the audio device starts
+        void addDeck(AudioSource* deck, Side side);
+
+        // 0 = full left, 1 = full right
+        void setCrossfader(float position);
+        void setCrossfaderCurve(CrossfaderCurve curve);
+
+        // Linear band gain, 0 kills the band, 1 is flat
+        void setEQ(int deck, Band band, float gain);
+
+        // Pre-listen on the cue bus (outputs 3/4)
+        void setCue(int deck, bool shouldCue);
+        // 0 = cue bus only in the headphones, 1 = master only
+        void setCueMix(float mix);
+
+        // Mixing time as a fraction of the block duration, smoothed
+        double getCpuLoad() const;
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+        void releaseResources() override;
+
+    private:
+        using Register = dsp::SIMDRegister<float>;
+        using Filter = dsp::IIR::Filter<Register>;
+
+        // Crossover stages per SIMD group, see applyEQ()
+        enum { numStages = 9, maxLanes = maxDecks * 2 };
+
+        void renderBlock(AudioBuffer<float>& output, int startSample, int numSamples);
+        void renderCueBus(AudioBuffer<float>& output, float* (&channels)[maxDecks][2], int startSample, int numSamples);
+        void applyEQ(float* (&channels)[maxDecks][2], int numSamples);
+        float getCrossfaderGain(Side side) const;
+
+        struct Deck {
+            AudioSource* source = nullptr;
+            Side side = throughSide;
+        };
+
+        Deck decks[maxDecks];
+        int numDecks = 0;
+
+        const float lowMidFrequency = 250.0f;
+        const float midHighFrequency = 2500.0f;
+
+        // Message thread -> audio thread
+        std::atomic<float> crossfader{ 0.5f };
+        std::atomic<int> crossfaderCurve{ constantPowerCurve };
+        std::atomic<float> eqTargets[maxDecks][numBands];
+        std::atomic<bool> cueEnabled[maxDecks];
+        std::atomic<float> cueMix{ 0.0f };
+
+        // Audio thread state, allocated in prepareToPlay
+        double currentSampleRate = 44100.0;
+        int blockSize = 0;
+        HeapBlock<float> scratchMemory;
+        float* scratch[maxDecks][2] = {}; // aligned channel pointers into scratchMemory
+        HeapBlock<float> laneMemory;
+        float* laneBlock = nullptr; // one SIMD group's channels, lane-major (the lanes of sample n start at n * width)
+        Filter filters[maxLanes][numStages]; // one row per SIMD group
+        SmoothedValue<float> eqGains[maxDecks][numBands];
+        SmoothedValue<float> deckGains[maxDecks];
+        SmoothedValue<float> cueGains[maxDecks];
+        SmoothedValue<float> cueMixGain;
+
+        std::atomic<double> cpuLoad{ 0.0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckMixer)
+};
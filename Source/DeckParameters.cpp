@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    DeckParameters.cpp
+
+  ==============================================================================
+*/
+
+#include "DeckParameters.h"
+
+DeckParameters::DeckParameters()
+{
+    for (int p = 0; p < numParameters; ++p) {
+        targets[p] = 1.0f;
+        lastRecorded[p] = 1.0f;
+        playbackTargets[p] = 1.0f;
+    }
+    points.malloc(maxPoints);
+    gain.setCurrentAndTargetValue(1.0f);
+    speed.setCurrentAndTargetValue(1.0);
+}
+
+void DeckParameters::set(Parameter parameter, float value)
+{
+    targets[parameter].store(value, std::memory_order_relaxed);
+}
+
+float DeckParameters::getTarget(Parameter parameter) const
+{
+    return targets[parameter].load(std::memory_order_relaxed);
+}
+
+void DeckParameters::startRecording()
+{
+    requestedMode = recordingMode;
+}
+
+void DeckParameters::startPlayback(bool shouldLoop)
+{
+    requestedMode = shouldLoop ? loopPlaybackMode : playbackMode;
+}
+
+void DeckParameters::stopAutomation()
+{
+    requestedMode = idleMode;
+}
+
+bool DeckParameters::isRecording() const
+{
+    return requestedMode == recordingMode;
+}
+
+bool DeckParameters::isPlayingBack() const
+{
+    return requestedMode == playbackMode || requestedMode == loopPlaybackMode;
+}
+
+int DeckParameters::getNumRecordedPoints() const
+{
+    return numPoints.load();
+}
+
+void DeckParameters::prepareToPlay(double sampleRate)
+{
+    // Short enough to feel direct, long enough to remove the steps
+    gain.reset(sampleRate, 0.02);
+    speed.reset(sampleRate, 0.05);
+    gain.setCurrentAndTargetValue(getTarget(gainParameter));
+    speed.setCurrentAndTargetValue(getTarget(speedParameter));
+}
+
+DeckParameters::Block DeckParameters::nextBlock(int numSamples)
+{
+    // Mode changes from the message thread take effect on a block boundary
+    int newMode = requestedMode.load(std::memory_order_relaxed);
+    if (newMode != mode)
+    {
+        // Playback runs for as long as the recording did
+        if (mode == recordingMode)
+            recordedLength = automationTime;
+
+        mode = newMode;
+        automationTime = 0;
+        playbackIndex = 0;
+        if (mode == recordingMode) {
+            numPoints.store(0);
+            // The starting values are the first points
+            for (int p = 0; p < numParameters; ++p)
+                record(p, getTarget((Parameter)p));
+        }
+        else if (mode != idleMode) {
+            for (int p = 0; p < numParameters; ++p)
+                playbackTargets[p] = getTarget((Parameter)p);
+        }
+    }
+
+    float newTargets[numParameters];
+    if (mode == playbackMode || mode == loopPlaybackMode)
+    {
+        // Every point up to the end of this block
+        int count = numPoints.load(std::memory_order_acquire);
+        while (playbackIndex < count && points[playbackIndex].time < automationTime + numSamples) {
+            playbackTargets[points[playbackIndex].parameter] = points[playbackIndex].value;
+            ++playbackIndex;
+        }
+        if (playbackIndex >= count && automationTime + numSamples >= recordedLength) {
+            if (mode == loopPlaybackMode) {
+                automationTime = -numSamples;
+                playbackIndex = 0;
+            }
+            else {
+                requestedMode.compare_exchange_strong(newMode, (int)idleMode);
+            }
+        }
+        for (int p = 0; p < numParameters; ++p)
+            newTargets[p] = playbackTargets[p];
+    }
+    else
+    {
+        for (int p = 0; p < numParameters; ++p) {
+            newTargets[p] = getTarget((Parameter)p);
+            if (mode == recordingMode && newTargets[p] != lastRecorded[p])
+                record(p, newTargets[p]);
+        }
+    }
+    automationTime += numSamples;
+
+    gain.setTargetValue(newTargets[gainParameter]);
+    speed.setTargetValue(newTargets[speedParameter]);
+
+    Block block;
+    block.gainStart = gain.getCurrentValue();
+    block.gainEnd = gain.skip(numSamples);
+    block.speed = speed.skip(numSamples);
+    return block;
+}
+
+void DeckParameters::jumpTo(Parameter parameter, float value)
+{
+    set(parameter, value);
+    if (parameter == gainParameter)
+        gain.setCurrentAndTargetValue(value);
+    else
+        speed.setCurrentAndTargetValue(value);
+}
+
+void DeckParameters::record(int parameter, float value)
+{
+    lastRecorded[parameter] = value;
+
+    // A full buffer keeps what it has
+    int count = numPoints.load(std::memory_order_relaxed);
+    if (count == maxPoints)
+        return;
+
+    points[count] = { automationTime, parameter, value };
+    numPoints.store(count + 1, std::memory_order_release);
+}
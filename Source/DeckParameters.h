@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    DeckParameters.h
+
+    ### Smoothed gain and speed of one deck, with automation ###
+
+    - Knob moves only store the latest value in an atomic slot, any number of
+      moves between two blocks cost one read on the audio thread
+    - The audio thread ramps towards the target with SmoothedValue, gain as a
+      per-block ramp over the samples, speed once per block
+    - Automation records every change of the targets with its sample time and
+      replays it (once or looped); while it plays back, knob moves are ignored
+    - The automation buffer is allocated up front, nothing is allocated per block
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class DeckParameters
+{
+    public:
+        enum Parameter { gainParameter, speedParameter, numParameters };
+
+        // What the audio thread applies to the next block
+        struct Block {
+            float gainStart = 1.0f;
+            float gainEnd = 1.0f;
+            double speed = 1.0;
+        };
+
+        DeckParameters();
+
+        // Any thread - the latest value wins
+        void set(Parameter parameter, float value);
+        float getTarget(Parameter parameter) const;
+
+        // Message thread - automation transport
+        void startRecording();
+        void startPlayback(bool shouldLoop);
+        void stopAutomation();
+        bool isRecording() const;
+        bool isPlayingBack() const;
+        int getNumRecordedPoints() const;
+
+        // Audio thread
+        void prepareToPlay(double sampleRate);
+        Block nextBlock(int numSamples);
+        // Sets the value without smoothing, for scheduled events that have to land on their sample
+        void jumpTo(Parameter parameter, float value);
+
+    private:
+        enum Mode { idleMode, recordingMode, playbackMode, loopPlaybackMode };
+
+        struct Point {
+            int64 time; // samples since recording started
+            int parameter;
+            float value;
+        };
+
+        void record(int parameter, float value);
+
+        std::atomic<float> targets[numParameters];
+        std::atomic<int> requestedMode{ idleMode };
+
+        // Audio thread only
+        SmoothedValue<float> gain;
+        SmoothedValue<double> speed;
+        int mode = idleMode;
+        int64 automationTime = 0;
+        int64 recordedLength = 0;
+        int playbackIndex = 0;
+        float lastRecorded[numParameters];
+        float playbackTargets[numParameters];
+
+        enum { maxPoints = 1 << 16 }; // hours of normal knob use
+        HeapBlock<Point> points;
+        std::atomic<int> numPoints{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckParameters)
+};
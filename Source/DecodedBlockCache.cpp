@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    DecodedBlockCache.cpp
+
+  ==============================================================================
+*/
+
+#include "DecodedBlockCache.h"
+
+DecodedBlockCache::DecodedBlockCache()
+{
+    int64 slotBytes = (int64)blockSize * maxChannels * (int64)sizeof(float);
+    numSets = jmax(1, (int)(budgetBytes / slotBytes / ways));
+    slots.reset(new Slot[(size_t)(numSets * ways)]);
+}
+
+DecodedBlockCache::~DecodedBlockCache()
+{
+
+}
+
+int64 DecodedBlockCache::getFileId(const File& file)
+{
+    // Changed files get a new id, their old blocks simply age out
+    String key = file.getFullPathName() + ":" + String(file.getSize()) + ":" + String(file.getLastModificationTime().toMilliseconds());
+    return key.hashCode64();
+}
+
+void DecodedBlockCache::read(int64 fileId, int64 blockIndex, float* const* destination,
+    const std::function<void(float* const*)>& decode, bool isScan)
+{
+    if (tryRead(fileId, blockIndex, destination, isScan)) {
+        ++(isScan ? scanHits : hits);
+        return;
+    }
+
+    auto key = std::make_pair(fileId, blockIndex);
+    {
+        std::unique_lock<std::mutex> lock(writeMutex);
+        if (inFlight.count(key) > 0)
+        {
+            // Someone else is decoding it right now
+            decodeFinished.wait(lock, [&] { return inFlight.count(key) == 0; });
+            lock.unlock();
+            if (tryRead(fileId, blockIndex, destination, isScan)) {
+                ++sharedDecodes;
+                ++(isScan ? scanHits : hits);
+                return;
+            }
+            lock.lock();
+        }
+        inFlight.insert(key);
+    }
+
+    ++(isScan ? scanMisses : misses);
+    decode(destination);
+
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        write(fileId, blockIndex, destination, isScan);
+        inFlight.erase(key);
+    }
+    decodeFinished.notify_all();
+}
+
+DecodedBlockCache::Stats DecodedBlockCache::getStats() const
+{
+    Stats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.scanHits = scanHits.load();
+    stats.scanMisses = scanMisses.load();
+    stats.sharedDecodes = sharedDecodes.load();
+    stats.evictions = evictions.load();
+    stats.memoryBytes = usedSlots.load() * (int64)blockSize * maxChannels * (int64)sizeof(float);
+    stats.budgetBytes = budgetBytes;
+    return stats;
+}
+
+double DecodedBlockCache::getHitRate() const
+{
+    int64 lookups = hits.load() + misses.load();
+    return lookups > 0 ? (double)hits.load() / lookups : 0.0;
+}
+
+bool DecodedBlockCache::tryRead(int64 fileId, int64 blockIndex, float* const* destination, bool isScan)
+{
+    Slot* set = &slots[(size_t)(getSet(fileId, blockIndex) * ways)];
+
+    for (int way = 0; way < ways; ++way)
+    {
+        Slot& slot = set[way];
+        uint32 before = slot.version.load(std::memory_order_acquire);
+        if ((before & 1) != 0 || slot.blockIndex.load(std::memory_order_relaxed) != blockIndex
+            || slot.fileId.load(std::memory_order_relaxed) != fileId)
+            continue;
+
+        for (int ch = 0; ch < maxChannels; ++ch)
+            memcpy(destination[ch], slot.data + ch * blockSize, sizeof(float) * blockSize);
+
+        // Overwritten while copying, treat as a miss
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != before)
+            return false;
+
+        // Scans leave the recency alone; playback keeps the block and lifts it out of the scan slots
+        if (!isScan) {
+            slot.lastUse = ++useClock;
+            slot.scanBlock = false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void DecodedBlockCache::write(int64 fileId, int64 blockIndex, float* const* source, bool isScan)
+{
+    // Empty slot first, then the oldest scan block; playback blocks fall back to the
+    // least recently used slot of the set, scan blocks are dropped instead
+    Slot* set = &slots[(size_t)(getSet(fileId, blockIndex) * ways)];
+    Slot* victim = nullptr;
+    for (int way = 0; way < ways && (victim == nullptr || victim->data != nullptr); ++way)
+    {
+        Slot& slot = set[way];
+        if (slot.data == nullptr || (slot.scanBlock && (victim == nullptr || slot.lastUse < victim->lastUse)))
+            victim = &slot;
+    }
+    if (victim == nullptr && !isScan)
+    {
+        victim = &set[0];
+        for (int way = 1; way < ways; ++way) {
+            if (set[way].lastUse < victim->lastUse)
+                victim = &set[way];
+        }
+    }
+    if (victim == nullptr)
+        return;
+
+    if (victim->data == nullptr) {
+        victim->data.malloc((size_t)(maxChannels * blockSize));
+        ++usedSlots;
+    }
+    else {
+        ++evictions;
+    }
+
+    victim->version.fetch_add(1, std::memory_order_acq_rel); // odd: readers skip or retry
+    std::atomic_thread_fence(std::memory_order_release);
+    victim->fileId.store(fileId, std::memory_order_relaxed);
+    victim->blockIndex.store(blockIndex, std::memory_order_relaxed);
+    for (int ch = 0; ch < maxChannels; ++ch)
+        memcpy(victim->data + ch * blockSize, source[ch], sizeof(float) * blockSize);
+    victim->lastUse = ++useClock;
+    victim->scanBlock = isScan;
+    victim->version.fetch_add(1, std::memory_order_release);
+}
+
+int DecodedBlockCache::getSet(int64 fileId, int64 blockIndex) const
+{
+    uint64 h = (uint64)fileId * 0x9E3779B97F4A7C15ull + (uint64)blockIndex;
+    h ^= h >> 29;
+    return (int)(h % (uint64)numSets);
+}
+
+CachedAudioReader::CachedAudioReader(AudioFormatReader* readerToUse, const File& file, bool isScan) :
+    AudioFormatReader(nullptr, readerToUse->getFormatName()),
+    source(readerToUse),
+    fileId(DecodedBlockCache::getFileId(file)),
+    scan(isScan)
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = 32;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = jmin(source->numChannels, (unsigned int)DecodedBlockCache::maxChannels);
+    usesFloatingPointData = true;
+    metadataValues = source->metadataValues;
+}
+
+CachedAudioReader::~CachedAudioReader()
+{
+
+}
+
+bool CachedAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples, lengthInSamples);
+
+    int done = 0;
+    while (done < numSamples)
+    {
+        int64 position = startSampleInFile + done;
+        int64 blockIndex = position / DecodedBlockCache::blockSize;
+
+        // Keep the last block, most reads continue where the previous one stopped
+        if (blockIndex != currentBlock)
+        {
+            cache->read(fileId, blockIndex, block.getArrayOfWritePointers(), [this, blockIndex](float* const* destination) {
+                AudioBuffer<float> view(destination, DecodedBlockCache::maxChannels, DecodedBlockCache::blockSize);
+                view.clear();
+                source->read(&view, 0, DecodedBlockCache::blockSize, blockIndex * DecodedBlockCache::blockSize, true, true);
+            }, scan);
+            currentBlock = blockIndex;
+        }
+
+        int offset = (int)(position - blockIndex * DecodedBlockCache::blockSize);
+        int count = jmin(numSamples - done, DecodedBlockCache::blockSize - offset);
+        for (int ch = 0; ch < numDestChannels; ++ch)
+        {
+            if (destChannels[ch] != nullptr)
+                memcpy(destChannels[ch] + startOffsetInDestBuffer + done, block.getReadPointer(jmin(ch, (int)numChannels - 1), offset), sizeof(float) * (size_t)count);
+        }
+        done += count;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    DecodedBlockCache.h
+
+    ### Process-wide cache of decoded audio ###
+
+    - Fixed-size float blocks keyed by (file, block index), shared by every
+      reader in the app through SharedResourcePointer
+    - Bounded by a memory budget; 4-way set-associative slots, the least
+      recently used slot of a set is replaced
+    - Lookups take no lock: each slot is a seqlock, readers copy the block
+      and retry if a writer touched it meanwhile
+    - A block that another thread is already decoding is waited for instead
+      of decoded twice, so a deck and the analysis share one decode
+    - Full-file scans (analysis, waveforms) share decodes like everyone else,
+      but their blocks are low priority: they only fill empty slots or replace
+      other scan blocks, so one pass over a long track (larger than the whole
+      budget) never evicts what the decks are playing. A deck that reads a
+      scan block promotes it
+    - CachedAudioReader reads any compressed file through the cache
+    - Hit rate and memory use are exposed through getStats()
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+class DecodedBlockCache
+{
+    public:
+        enum { blockSize = 32768, maxChannels = 2 }; // frames per block, channels kept per block
+
+        struct Stats {
+            int64 hits = 0; // playback reads only, scans are counted apart
+            int64 misses = 0;
+            int64 scanHits = 0;
+            int64 scanMisses = 0;
+            int64 sharedDecodes = 0; // misses that waited for another thread's decode
+            int64 evictions = 0;
+            int64 memoryBytes = 0;
+            int64 budgetBytes = 0;
+        };
+
+        DecodedBlockCache();
+        ~DecodedBlockCache();
+
+        // Identifies a file's contents by path, size and modification time
+        static int64 getFileId(const File& file);
+
+        // Copies block `blockIndex` of `fileId` into destination (maxChannels pointers of blockSize
+        // floats), calling decode to fill it on a miss. decode gets the same pointers.
+        // Scans store a missed block at low priority
+        void read(int64 fileId, int64 blockIndex, float* const* destination,
+            const std::function<void(float* const*)>& decode, bool isScan = false);
+
+        Stats getStats() const;
+        double getHitRate() const;
+
+    private:
+        struct Slot {
+            std::atomic<uint32> version{ 0 }; // odd while being written
+            std::atomic<int64> fileId{ 0 };
+            std::atomic<int64> blockIndex{ -1 };
+            std::atomic<uint32> lastUse{ 0 };
+            std::atomic<bool> scanBlock{ false }; // low priority, see write()
+            HeapBlock<float> data; // maxChannels * blockSize, allocated on first use
+        };
+
+        bool tryRead(int64 fileId, int64 blockIndex, float* const* destination, bool isScan);
+        void write(int64 fileId, int64 blockIndex, float* const* source, bool isScan);
+        int getSet(int64 fileId, int64 blockIndex) const;
+
+        enum { ways = 4 };
+        const int64 budgetBytes = 64 * 1024 * 1024;
+        int numSets = 0;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint32> useClock{ 0 };
+
+        // Writers and in-flight decodes
+        std::mutex writeMutex;
+        std::condition_variable decodeFinished;
+        std::set<std::pair<int64, int64>> inFlight;
+
+        std::atomic<int64> hits{ 0 }, misses{ 0 }, sharedDecodes{ 0 }, evictions{ 0 }, usedSlots{ 0 };
+        std::atomic<int64> scanHits{ 0 }, scanMisses{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedBlockCache)
+};
+
+// Reads a file through the DecodedBlockCache, float output
+class CachedAudioReader : public AudioFormatReader
+{
+    public:
+        // Takes ownership of the decoding reader. A scan reader's blocks are kept at low priority
+        CachedAudioReader(AudioFormatReader* readerToUse, const File& file, bool isScan = false);
+        ~CachedAudioReader() override;
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+            int64 startSampleInFile, int numSamples) override;
+
+    private:
+        std::unique_ptr<AudioFormatReader> source;
+        SharedResourcePointer<DecodedBlockCache> cache;
+        int64 fileId;
+        bool scan;
+
+        AudioBuffer<float> block{ DecodedBlockCache::maxChannels, DecodedBlockCache::blockSize };
+        int64 currentBlock = -1; // block held in `block`
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachedAudioReader)
+};
@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+
+    HotCueSource.cpp
+
+  ==============================================================================
+*/
+
+#include "HotCueSource.h"
+
+HotCueSource::HotCueSource(PositionableAudioSource* sourceToUse, AudioFormatReader* readerForCues) :
+    Thread("Hot cue decoder"),
+    source(sourceToUse),
+    cueReader(readerForCues)
+{
+    for (auto& position : requestedPositions)
+        position = -1;
+    if (cueReader != nullptr)
+        requestedPositions[startSlot] = 0;
+
+    startThread(Thread::Priority::normal);
+}
+
+HotCueSource::~HotCueSource()
+{
+    stopThread(4000);
+}
+
+void HotCueSource::setCue(int slot, double seconds)
+{
+    if (slot >= 0 && slot < maxHotCues)
+        request(slot, seconds);
+}
+
+void HotCueSource::request(int slot, double seconds)
+{
+    int64 position = -1;
+    if (seconds >= 0.0 && cueReader != nullptr) {
+        position = (int64)(seconds * cueReader->sampleRate);
+        if (position >= cueReader->lengthInSamples)
+            position = -1;
+    }
+
+    requestedPositions[slot] = position;
+    notify();
+}
+
+double HotCueSource::getCue(int slot) const
+{
+    if (slot < 0 || slot >= maxHotCues || requestedPositions[slot] < 0 || cueReader == nullptr)
+        return -1.0;
+    return requestedPositions[slot] / cueReader->sampleRate;
+}
+
+void HotCueSource::trigger(int slot)
+{
+    triggerTicks = Time::getHighResolutionTicks();
+    pendingCue = slot;
+}
+
+void HotCueSource::prepareJump(double seconds)
+{
+    request(jumpSlot, seconds);
+}
+
+void HotCueSource::triggerJump()
+{
+    trigger(jumpSlot);
+}
+
+double HotCueSource::getLastTriggerLatencyMs() const
+{
+    return lastTriggerLatencyMs.load();
+}
+
+void HotCueSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    lastBlock.setSize(2, samplesPerBlockExpected);
+    lastBlockLength = 0;
+}
+
+void HotCueSource::releaseResources()
+{
+    source->releaseResources();
+}
+
+void HotCueSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    // A trigger is only taken while the cue audio can be read, otherwise it waits for the next block
+    const SpinLock::ScopedTryLockType sl(cueLock);
+    if (!sl.isLocked())
+    {
+        // Cue audio is being swapped in, this one block plays the last one again rather than a gap
+        if (activeCue >= 0 || pendingSeek >= 0) {
+            repeatBlock(bufferToFill);
+            return;
+        }
+        source->getNextAudioBlock(bufferToFill);
+    }
+    else
+    {
+        render(bufferToFill);
+    }
+    keepBlock(bufferToFill);
+}
+
+void HotCueSource::render(const AudioSourceChannelInfo& bufferToFill)
+{
+    int slot = pendingCue.exchange(-1);
+    if (slot >= 0 && slot < numSlots)
+    {
+        if (cues[slot].position >= 0 && cues[slot].position == requestedPositions[slot])
+        {
+            startCue(slot);
+            lastTriggerLatencyMs = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - triggerTicks) * 1000.0;
+        }
+        else if (requestedPositions[slot] >= 0)
+        {
+            // Still being decoded - keep the trigger unless a newer one came in
+            int expected = -1;
+            pendingCue.compare_exchange_strong(expected, slot);
+        }
+    }
+
+    int done = readCue(bufferToFill);
+    if (done == bufferToFill.numSamples)
+        return;
+
+    AudioSourceChannelInfo rest(bufferToFill.buffer, bufferToFill.startSample + done, bufferToFill.numSamples - done);
+
+    // The rest of the block comes from the stream, which has had the RAM part to catch up.
+    // Only a decode thread that did not run for the whole cue leaves it unseeked here
+    if (pendingSeek >= 0) {
+        rest.clearActiveBufferRegion();
+        return;
+    }
+
+    // A loop stops streaming at the end of the track
+    int streamed = rest.numSamples;
+    if (looping)
+        streamed = (int)jlimit((int64)0, (int64)rest.numSamples, source->getTotalLength() - source->getNextReadPosition());
+
+    if (streamed > 0)
+        source->getNextAudioBlock(AudioSourceChannelInfo(rest.buffer, rest.startSample, streamed));
+    if (streamed == rest.numSamples)
+        return;
+
+    // ...and carries on from the RAM copy of the start, or from the stream once the decode thread has seeked it
+    AudioSourceChannelInfo wrapped(rest.buffer, rest.startSample + streamed, rest.numSamples - streamed);
+    int wrappedDone = 0;
+    if (cues[startSlot].position == 0) {
+        startCue(startSlot);
+        wrappedDone = readCue(wrapped);
+    }
+    else {
+        pendingSeek = 0;
+        notify();
+    }
+
+    if (wrappedDone < wrapped.numSamples)
+        AudioSourceChannelInfo(wrapped.buffer, wrapped.startSample + wrappedDone, wrapped.numSamples - wrappedDone).clearActiveBufferRegion();
+}
+
+void HotCueSource::startCue(int slot)
+{
+    // The decode thread seeks the stream to where the RAM copy ends
+    activeCueStart = cues[slot].position;
+    cueReadPosition = 0;
+    activeCue = slot;
+    pendingSeek = cues[slot].position + cues[slot].audio.getNumSamples();
+    notify();
+}
+
+int HotCueSource::readCue(const AudioSourceChannelInfo& bufferToFill)
+{
+    int cue = activeCue;
+    if (cue < 0)
+        return 0;
+
+    const auto& audio = cues[cue].audio;
+    int readPosition = cueReadPosition;
+    int done = jlimit(0, bufferToFill.numSamples, audio.getNumSamples() - readPosition);
+
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels() && done > 0; ++ch)
+        bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample, audio, jmin(ch, audio.getNumChannels() - 1), readPosition, done);
+
+    cueReadPosition = readPosition + done;
+    if (readPosition + done >= audio.getNumSamples())
+        activeCue = -1;
+    return done;
+}
+
+void HotCueSource::keepBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    lastBlockLength = jmin(bufferToFill.numSamples, lastBlock.getNumSamples());
+    for (int ch = 0; ch < lastBlock.getNumChannels(); ++ch)
+    {
+        int from = jmin(ch, bufferToFill.buffer->getNumChannels() - 1);
+        lastBlock.copyFrom(ch, 0, *bufferToFill.buffer, from, bufferToFill.startSample, lastBlockLength);
+    }
+}
+
+void HotCueSource::repeatBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    // A block longer than the kept one is padded with silence
+    int length = jmin(bufferToFill.numSamples, lastBlockLength);
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+    {
+        if (length > 0)
+            bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample, lastBlock, jmin(ch, lastBlock.getNumChannels() - 1), 0, length);
+        if (length < bufferToFill.numSamples)
+            bufferToFill.buffer->clear(ch, bufferToFill.startSample + length, bufferToFill.numSamples - length);
+    }
+}
+
+void HotCueSource::setNextReadPosition(int64 newPosition)
+{
+    // A normal seek cancels the cue playback
+    pendingSeek = -1;
+    activeCue = -1;
+    source->setNextReadPosition(newPosition);
+}
+
+int64 HotCueSource::getNextReadPosition() const
+{
+    if (activeCue >= 0)
+        return activeCueStart + cueReadPosition;
+    return source->getNextReadPosition();
+}
+
+int64 HotCueSource::getTotalLength() const
+{
+    return source->getTotalLength();
+}
+
+bool HotCueSource::isLooping() const
+{
+    // The transport only stops at the end of a source that does not loop
+    return looping.load();
+}
+
+void HotCueSource::setLooping(bool shouldLoop)
+{
+    // The wrap happens here, the stream itself never loops
+    looping = shouldLoop;
+}
+
+void HotCueSource::run()
+{
+    while (!threadShouldExit())
+    {
+        // The stream seek after a trigger, done here so the audio thread never takes the read-ahead locks
+        int64 seek = pendingSeek.exchange(-1);
+        if (seek >= 0)
+            source->setNextReadPosition(seek);
+
+        // Slots whose decoded audio no longer matches what was asked for
+        bool decoded = false;
+        for (int slot = 0; slot < numSlots && !threadShouldExit(); ++slot)
+        {
+            int64 wanted = requestedPositions[slot];
+            if (wanted != cues[slot].position) {
+                decodeCue(slot, wanted);
+                decoded = true;
+            }
+        }
+
+        // Woken by new cues and by the audio thread when the stream needs a seek
+        if (!decoded)
+            wait(-1);
+    }
+}
+
+void HotCueSource::decodeCue(int slot, int64 position)
+{
+    // Decode outside the lock, the audio thread keeps playing meanwhile
+    AudioBuffer<float> audio;
+    if (position >= 0)
+    {
+        int length = (int)jmin((int64)(cueBufferSeconds * cueReader->sampleRate), cueReader->lengthInSamples - position);
+        audio.setSize(jmax(2, (int)cueReader->numChannels), jmax(0, length));
+        if (length > 0)
+            cueReader->read(&audio, 0, length, position, true, true);
+    }
+
+    {
+        const SpinLock::ScopedLockType sl(cueLock);
+
+        // The cue that is playing is replaced, its stream carries on from the same spot
+        if (activeCue == slot) {
+            pendingSeek = -1;
+            source->setNextReadPosition(activeCueStart + cueReadPosition);
+            activeCue = -1;
+        }
+
+        cues[slot].position = position;
+        std::swap(cues[slot].audio, audio);
+    }
+    // The old cue audio is freed here, off the audio thread
+}
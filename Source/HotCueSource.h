@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    HotCueSource.h
+
+    ### Hot cues with instant jumps ###
+
+    - Sits between the read-ahead buffer and the transport of a deck
+    - The first 300 ms after every cue are decoded into RAM by a background
+      thread when the cue is set, so loading a track with cues never blocks
+    - A trigger is picked up by the next audio block and played from RAM,
+      while the decode thread, woken by the audio thread, seeks the
+      streaming source and it refills behind it - the audio thread never
+      seeks the stream itself
+    - A block that finds the cue audio being swapped in repeats the block
+      before it instead of dropping out
+    - Two more slots the deck uses internally: the start of the track, for
+      loops, and one scheduled jump decoded ahead of its event
+    - A looping track wraps here: the block that reaches the end carries on
+      from the RAM copy of the start, so the transport never sees the end
+    - Keeps the trigger-to-audio latency of the last jump
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class HotCueSource : public PositionableAudioSource,
+    private Thread
+{
+    public:
+        enum { maxHotCues = 8 };
+
+        // Takes ownership of cueReader, a second reader on the same file used to fill the cue buffers
+        HotCueSource(PositionableAudioSource* source, AudioFormatReader* cueReader);
+        ~HotCueSource() override;
+
+        // Message thread - the audio after the cue is decoded in the background, a negative position clears the slot
+        void setCue(int slot, double seconds);
+        double getCue(int slot) const;
+
+        // Any thread - jumps to the cue at the start of the next block that has its audio ready
+        void trigger(int slot);
+
+        // Any thread but the audio thread - decodes the audio at a scheduled jump, a later call replaces it
+        void prepareJump(double seconds);
+        // Any thread - the prepared jump
+        void triggerJump();
+
+        // Time from the last trigger() call until its audio was rendered
+        double getLastTriggerLatencyMs() const;
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+        void setNextReadPosition(int64 newPosition) override;
+        int64 getNextReadPosition() const override;
+        int64 getTotalLength() const override;
+        bool isLooping() const override;
+        void setLooping(bool shouldLoop) override;
+
+    private:
+        enum { startSlot = maxHotCues, jumpSlot, numSlots };
+
+        void run() override;
+        void request(int slot, double seconds);
+        void decodeCue(int slot, int64 position);
+
+        // Audio thread, cueLock held - cue, stream and loop wrap for one block
+        void render(const AudioSourceChannelInfo& bufferToFill);
+
+        // Audio thread - starts playing a decoded slot from RAM, copies from the playing one
+        void startCue(int slot);
+        int readCue(const AudioSourceChannelInfo& bufferToFill);
+
+        // Audio thread - the last block played, repeated when the cue audio cannot be read
+        void keepBlock(const AudioSourceChannelInfo& bufferToFill);
+        void repeatBlock(const AudioSourceChannelInfo& bufferToFill);
+
+        struct Cue {
+            int64 position = -1; // in source samples
+            AudioBuffer<float> audio;
+        };
+
+        PositionableAudioSource* source;
+        std::unique_ptr<AudioFormatReader> cueReader;
+
+        const double cueBufferSeconds = 0.3;
+
+        SpinLock cueLock; // held by the decode thread while swapping cue audio in
+        Cue cues[numSlots];
+        std::atomic<int64> requestedPositions[numSlots]; // set by setCue, -1 for an empty slot
+        std::atomic<int64> pendingSeek{ -1 }; // stream position the decode thread seeks to
+        std::atomic<bool> looping{ false };
+
+        // Audio thread state, read by getNextReadPosition() on the message thread
+        std::atomic<int> pendingCue{ -1 };
+        std::atomic<int> activeCue{ -1 };
+        std::atomic<int64> activeCueStart{ 0 };
+        std::atomic<int> cueReadPosition{ 0 };
+        AudioBuffer<float> lastBlock; // sized in prepareToPlay
+        int lastBlockLength = 0;
+
+        std::atomic<int64> triggerTicks{ 0 };
+        std::atomic<double> lastTriggerLatencyMs{ 0.0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HotCueSource)
+};
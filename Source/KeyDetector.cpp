@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    KeyDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "KeyDetector.h"
+
+int KeyDetector::estimateKey(const AudioBuffer<float>& monoBuffer, double sampleRate)
+{
+    int numSamples = monoBuffer.getNumSamples();
+    if (numSamples <= 0 || sampleRate <= 0)
+        return -1;
+
+    // Decimate first, the pitch range we look at tops out at a few kHz
+    int numDecimated = numSamples / decimation;
+    if (numDecimated < fftSize)
+        return -1;
+    double rate = sampleRate / decimation;
+
+    // Cut off at the new Nyquist. Aliases only land below 4 kHz from above (rate - 4 kHz),
+    // so the transition band can span that whole gap and the filter stays short
+    if (lowpass == nullptr || lowpassRate != sampleRate) {
+        double transition = jlimit(0.005, 0.2, 2.0 * (rate / 2.0 - 4000.0) / sampleRate);
+        lowpass = dsp::FilterDesign<float>::designFIRLowpassKaiserMethod((float)(rate / 2.0), sampleRate, (float)transition, -60.0f);
+        lowpassRate = sampleRate;
+    }
+
+    // Filtered samples are only computed where the decimated signal is read
+    const float* input = monoBuffer.getReadPointer(0);
+    const float* taps = lowpass->getRawCoefficients();
+    const int numTaps = (int)lowpass->getFilterOrder() + 1;
+    auto decimatedAt = [&](int index) {
+        int start = index * decimation - numTaps / 2;
+        int from = jmax(0, -start), to = jmin(numTaps, numSamples - start);
+        float sum = 0.0f;
+        for (int k = from; k < to; ++k)
+            sum += taps[k] * input[start + k];
+        return sum;
+    };
+
+    // Map every FFT bin to a pitch class (C = 0), bins outside 110 Hz - 4 kHz are skipped
+    int pitchClassForBin[fftSize / 2];
+    for (int bin = 0; bin < fftSize / 2; ++bin) {
+        double freq = bin * rate / fftSize;
+        if (freq < 110.0 || freq > 4000.0) {
+            pitchClassForBin[bin] = -1;
+            continue;
+        }
+        int midiNote = roundToInt(69.0 + 12.0 * std::log2(freq / 440.0));
+        pitchClassForBin[bin] = midiNote % 12;
+    }
+
+    // Spread a capped number of frames evenly over the track to keep bulk imports fast
+    int numFrames = jmin((int)maxFrames, numDecimated / fftSize);
+    int hop = numFrames > 1 ? (numDecimated - fftSize) / (numFrames - 1) : 0;
+    double chroma[12] = {};
+
+    for (int frame = 0; frame < numFrames; ++frame) {
+        std::fill(fftData.begin(), fftData.end(), 0.0f);
+        for (int i = 0; i < fftSize; ++i)
+            fftData[(size_t)i] = decimatedAt(frame * hop + i);
+
+        window.multiplyWithWindowingTable(fftData.data(), fftSize);
+        fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+        for (int bin = 0; bin < fftSize / 2; ++bin) {
+            if (pitchClassForBin[bin] >= 0)
+                chroma[pitchClassForBin[bin]] += fftData[(size_t)bin];
+        }
+    }
+
+    // Krumhansl-Kessler key profiles, starting from the tonic
+    static const double majorProfile[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+    static const double minorProfile[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+
+    // Pearson correlation between the chroma and a profile rotated to a given tonic
+    auto correlate = [&chroma](const double* profile, int tonic) {
+        double meanChroma = 0.0, meanProfile = 0.0;
+        for (int i = 0; i < 12; ++i) {
+            meanChroma += chroma[i] / 12.0;
+            meanProfile += profile[i] / 12.0;
+        }
+        double num = 0.0, denChroma = 0.0, denProfile = 0.0;
+        for (int i = 0; i < 12; ++i) {
+            double c = chroma[(i + tonic) % 12] - meanChroma;
+            double p = profile[i] - meanProfile;
+            num += c * p;
+            denChroma += c * c;
+            denProfile += p * p;
+        }
+        double den = std::sqrt(denChroma * denProfile);
+        return den > 0.0 ? num / den : 0.0;
+    };
+
+    int bestKey = -1;
+    double bestScore = 0.0;
+    for (int tonic = 0; tonic < 12; ++tonic) {
+        double major = correlate(majorProfile, tonic);
+        double minor = correlate(minorProfile, tonic);
+        if (major > bestScore) { bestScore = major; bestKey = tonic; }
+        if (minor > bestScore) { bestScore = minor; bestKey = tonic + 12; }
+    }
+
+    return bestKey;
+}
+
+String KeyDetector::getKeyName(int keyIndex)
+{
+    static const char* noteNames[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+    if (keyIndex < 0 || keyIndex >= 24)
+        return "--";
+
+    // Minor keys get an "m" suffix, e.g. "Am"
+    return String(noteNames[keyIndex % 12]) + (keyIndex >= 12 ? "m" : "");
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    KeyDetector.h
+
+    - Estimate the musical key of each uploaded track in the library
+    - Builds a chroma profile (energy per pitch class) from an FFT pass
+    - Low-pass filtered (dsp::FilterDesign FIR) before the 4x decimation,
+      so nothing above the new Nyquist folds into the pitch range
+    - Matches the chroma against major/minor key profiles
+
+  ==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class KeyDetector {
+    public:
+        // Returns 0-11 for C..B major, 12-23 for C..B minor, -1 if unknown
+        int estimateKey(const AudioBuffer<float>& monoBuffer, double sampleRate);
+
+        static String getKeyName(int keyIndex);
+
+    private:
+        // 4096 point FFT on a 4x decimated signal gives ~2.7 Hz per bin at 44.1 kHz
+        enum { fftOrder = 12, fftSize = 1 << fftOrder, decimation = 4, maxFrames = 200 };
+
+        dsp::FFT fft{ fftOrder };
+        dsp::WindowingFunction<float> window{ fftSize, dsp::WindowingFunction<float>::hann };
+        std::vector<float> fftData = std::vector<float>(fftSize * 2, 0.0f);
+
+        // Anti-aliasing low-pass, designed again only when the sample rate changes
+        dsp::FIR::Coefficients<float>::Ptr lowpass;
+        double lowpassRate = 0.0;
+};
@@ -0,0 +1,304 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryScanner.h"
+
+LibraryScanner::LibraryScanner(const String& audioFileWildcard) :
+    Thread("Library scanner"),
+    wildcard(audioFileWildcard)
+{
+    startThread(Thread::Priority::background);
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    stopThread(4000);
+    cancelPendingUpdate();
+}
+
+void LibraryScanner::addWatchFolder(const File& folder)
+{
+    {
+        const ScopedLock sl(lock);
+        watchFolders.addIfNotAlreadyThere(folder);
+        stateChanged = true;
+    }
+    rescan();
+}
+
+void LibraryScanner::removeWatchFolder(const File& folder)
+{
+    {
+        const ScopedLock sl(lock);
+        watchFolders.removeFirstMatchingValue(folder);
+        stateChanged = true;
+    }
+    rescan();
+}
+
+Array<File> LibraryScanner::getWatchFolders() const
+{
+    const ScopedLock sl(lock);
+    return watchFolders;
+}
+
+void LibraryScanner::addFiles(const Array<File>& files)
+{
+    const ScopedLock sl(lock);
+    pendingFiles.addArray(files);
+}
+
+void LibraryScanner::rescan()
+{
+    notify();
+}
+
+double LibraryScanner::getLastScanTimeMs() const
+{
+    return lastScanTimeMs.load();
+}
+
+void LibraryScanner::run()
+{
+    loadState();
+
+    while (!threadShouldExit())
+    {
+        scan();
+        if (threadShouldExit())
+            break;
+
+        saveState();
+        wait(rescanIntervalMs);
+    }
+}
+
+void LibraryScanner::handleAsyncUpdate()
+{
+    Array<Result> results;
+    {
+        const ScopedLock sl(lock);
+        results.swapWith(finishedResults);
+    }
+
+    if (onScanComplete != nullptr) {
+        for (auto& result : results)
+            onScanComplete(result);
+    }
+}
+
+void LibraryScanner::scan()
+{
+    double startMs = Time::getMillisecondCounterHiRes();
+    ++scanCount;
+
+    Result result;
+    auto reportChanged = [&result](const File& file) {
+        TrackMetadata metadata;
+        MetadataScanner::scan(file, metadata);
+        result.newOrChanged.add(file);
+        result.metadata.add(metadata);
+    };
+
+    Array<File> folders;
+    Array<File> newFiles;
+    {
+        const ScopedLock sl(lock);
+        folders = watchFolders;
+        newFiles.swapWith(pendingFiles);
+    }
+
+    // Library files join the snapshot as they are now, they are already analysed
+    for (auto& file : newFiles)
+    {
+        if (snapshot.find(file.getFullPathName()) != snapshot.end())
+            continue;
+
+        SnapshotEntry entry;
+        entry.size = file.getSize();
+        entry.modified = file.getLastModificationTime().toMilliseconds();
+        entry.missing = !file.existsAsFile();
+        if (entry.missing)
+            result.missing.add(file);
+        snapshot[file.getFullPathName()] = entry;
+    }
+
+    // Walk the watched folders, the iterator already knows size and mtime
+    for (auto& folder : folders)
+    {
+        for (const auto& item : RangedDirectoryIterator(folder, true, wildcard, File::findFiles))
+        {
+            if (threadShouldExit())
+                return;
+
+            const File& file = item.getFile();
+            int64 size = item.getFileSize();
+            int64 modified = item.getModificationTime().toMilliseconds();
+
+            auto it = snapshot.find(file.getFullPathName());
+            if (it == snapshot.end())
+            {
+                SnapshotEntry entry;
+                entry.size = size;
+                entry.modified = modified;
+                entry.inWatchFolder = true;
+                entry.lastSeenScan = scanCount;
+                snapshot[file.getFullPathName()] = entry;
+                reportChanged(file);
+                continue;
+            }
+
+            auto& entry = it->second;
+            entry.inWatchFolder = true;
+            entry.lastSeenScan = scanCount;
+
+            if (entry.missing) {
+                entry.missing = false;
+                result.restored.add(file);
+            }
+            if (entry.size != size || entry.modified != modified) {
+                entry.size = size;
+                entry.modified = modified;
+                reportChanged(file);
+            }
+        }
+    }
+
+    // Everything not seen by the walk is either gone or lives outside the folders
+    for (auto it = snapshot.begin(); it != snapshot.end();)
+    {
+        auto& entry = it->second;
+        if (entry.lastSeenScan == scanCount) {
+            ++it;
+            continue;
+        }
+
+        File file(it->first);
+
+        if (entry.inWatchFolder)
+        {
+            bool stillWatched = false;
+            for (auto& folder : folders)
+                stillWatched = stillWatched || file.isAChildOf(folder);
+
+            // Folder no longer watched - forget the file
+            if (!stillWatched) {
+                it = snapshot.erase(it);
+                continue;
+            }
+
+            // The walk would have found it
+            if (!entry.missing) {
+                entry.missing = true;
+                result.missing.add(file);
+            }
+        }
+        else if (!file.existsAsFile())
+        {
+            if (!entry.missing) {
+                entry.missing = true;
+                result.missing.add(file);
+            }
+        }
+        else
+        {
+            int64 size = file.getSize();
+            int64 modified = file.getLastModificationTime().toMilliseconds();
+
+            if (entry.missing) {
+                entry.missing = false;
+                result.restored.add(file);
+            }
+            if (entry.size != size || entry.modified != modified) {
+                entry.size = size;
+                entry.modified = modified;
+                reportChanged(file);
+            }
+        }
+        ++it;
+    }
+
+    lastScanTimeMs = Time::getMillisecondCounterHiRes() - startMs;
+
+    if (result.newOrChanged.isEmpty() && result.missing.isEmpty() && result.restored.isEmpty() && newFiles.isEmpty())
+        return;
+
+    {
+        const ScopedLock sl(lock);
+        finishedResults.add(result);
+        stateChanged = true;
+    }
+    triggerAsyncUpdate();
+}
+
+void LibraryScanner::loadState()
+{
+    File f = File::getCurrentWorkingDirectory().getChildFile("watchfolders.json");
+    if (!f.existsAsFile())
+        return;
+
+    var json = JSON::parse(f);
+
+    if (auto* folders = json.getProperty("folders", var()).getArray())
+    {
+        const ScopedLock sl(lock);
+        for (auto& folder : *folders)
+            watchFolders.addIfNotAlreadyThere(File(folder.toString()));
+    }
+
+    if (auto* files = json.getProperty("files", var()).getArray())
+    {
+        for (auto& item : *files)
+        {
+            if (auto* obj = item.getDynamicObject())
+            {
+                SnapshotEntry entry;
+                entry.size = (int64)obj->getProperty("size");
+                entry.modified = (int64)obj->getProperty("modified");
+                entry.inWatchFolder = obj->getProperty("watched");
+                snapshot[obj->getProperty("path").toString()] = entry;
+            }
+        }
+    }
+}
+
+void LibraryScanner::saveState()
+{
+    var folders;
+    {
+        const ScopedLock sl(lock);
+        if (!stateChanged)
+            return;
+        stateChanged = false;
+
+        for (auto& folder : watchFolders)
+            folders.append(folder.getFullPathName());
+    }
+
+    // Missing files are left out, they are reported again after a restart
+    var files;
+    for (auto& item : snapshot)
+    {
+        if (item.second.missing)
+            continue;
+
+        DynamicObject* obj = new DynamicObject();
+        obj->setProperty("path", item.first);
+        obj->setProperty("size", item.second.size);
+        obj->setProperty("modified", item.second.modified);
+        obj->setProperty("watched", item.second.inWatchFolder);
+        files.append(var(obj));
+    }
+
+    DynamicObject* root = new DynamicObject();
+    root->setProperty("folders", folders);
+    root->setProperty("files", files);
+
+    File f = File::getCurrentWorkingDirectory().getChildFile("watchfolders.json");
+    f.replaceWithText(JSON::toString(var(root)));
+}
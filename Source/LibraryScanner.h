@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.h
+
+    ### Watch folders and incremental library rescans ###
+
+    - Keeps a (path, size, mtime) snapshot of every watched folder and
+      every library file, persisted in watchfolders.json
+    - A rescan walks the watched folders on a background thread and only
+      reports files that are new, changed, missing or back again
+    - Tags of new/changed files are read here, off the message thread
+    - Rescans run on request and once a minute
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MetadataScanner.h"
+
+class LibraryScanner : private Thread,
+    private AsyncUpdater
+{
+    public:
+        struct Result {
+            Array<File> newOrChanged; // go to the analysis queue
+            Array<TrackMetadata> metadata; // tags of each newOrChanged file
+            Array<File> missing; // mark offline
+            Array<File> restored; // back online
+        };
+
+        LibraryScanner(const String& audioFileWildcard);
+        ~LibraryScanner() override;
+
+        void addWatchFolder(const File& folder);
+        void removeWatchFolder(const File& folder);
+        Array<File> getWatchFolders() const;
+
+        // Library files outside the watched folders, checked on every rescan
+        void addFiles(const Array<File>& files);
+
+        // Wake the scanner up now instead of waiting for the next interval
+        void rescan();
+
+        // Called on the message thread after each rescan that found something
+        std::function<void(const Result&)> onScanComplete;
+
+        double getLastScanTimeMs() const;
+
+    private:
+        struct SnapshotEntry {
+            int64 size = 0;
+            int64 modified = 0;
+            bool inWatchFolder = false;
+            bool missing = false;
+            uint32 lastSeenScan = 0;
+        };
+
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        void scan();
+        void loadState();
+        void saveState();
+
+        const String wildcard;
+        enum { rescanIntervalMs = 60000 };
+
+        CriticalSection lock; // guards the folder list, pending files and results
+        Array<File> watchFolders;
+        Array<File> pendingFiles;
+        Array<Result> finishedResults;
+        bool stateChanged = false;
+
+        // Only touched on the scanner thread
+        std::unordered_map<String, SnapshotEntry> snapshot;
+        uint32 scanCount = 0;
+
+        std::atomic<double> lastScanTimeMs{ 0.0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryScanner)
+};
@@ -14,47 +14,104 @@ MainComponent::MainComponent()
     // Make sure you set the size of the component after you add any child components
     setSize(1000, 800); // set the initial size of the main component window
 
+    // Deck 1 sits on the left of the crossfader, deck 2 on the right
+    mixer.addDeck(&player1, DeckMixer::leftSide);
+    mixer.addDeck(&player2, DeckMixer::rightSide);
+
     // Some platforms require permissions to open input channels so request that here
     if (RuntimePermissions::isRequired(RuntimePermissions::recordAudio)
         && !RuntimePermissions::isGranted(RuntimePermissions::recordAudio)) {
         // If audio recording permission is required and not granted, request it
         RuntimePermissions::request(RuntimePermissions::recordAudio, [&](bool granted) {
             if (granted)
-                setAudioChannels(2, 2); // if granted, set up 2 input and 2 output channels
+                setAudioChannels(2, 4); // if granted, set up 2 input and 4 output channels (master + cue)
             });
     }
     else {
         // Specify the number of input and output channels that we want to open
-        // Otherwise, set up 0 input and 2 output channels
-        setAudioChannels(0, 2); 
+        // Otherwise, set up 0 input and 4 output channels, 3/4 carry the cue bus when the device has them
+        setAudioChannels(0, 4); 
     }
 
     addAndMakeVisible(deckGUI1); // add the first deck GUI component to the main component and make it visible
     addAndMakeVisible(deckGUI2); // add the second deck GUI component to the main component and make it visible
 
+    // Playheads follow the display refresh
+    refreshClock.addListener(&deckGUI1);
+    refreshClock.addListener(&deckGUI2);
+
+    // Crossfader
+    addAndMakeVisible(crossfaderSlider);
+    crossfaderSlider.setRange(0.0, 1.0);
+    crossfaderSlider.setValue(0.5);
+    crossfaderSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    crossfaderSlider.setColour(Slider::thumbColourId, ColourPalette::accentColour);
+    crossfaderSlider.onValueChange = [this] { mixer.setCrossfader((float)crossfaderSlider.getValue()); };
+
+    // Crossfader curve
+    addAndMakeVisible(crossfaderCurveBox);
+    crossfaderCurveBox.addItem("Linear", DeckMixer::linearCurve + 1);
+    crossfaderCurveBox.addItem("Smooth", DeckMixer::constantPowerCurve + 1);
+    crossfaderCurveBox.addItem("Cut", DeckMixer::cutCurve + 1);
+    crossfaderCurveBox.setSelectedId(DeckMixer::constantPowerCurve + 1, dontSendNotification);
+    crossfaderCurveBox.onChange = [this] { mixer.setCrossfaderCurve((DeckMixer::CrossfaderCurve)(crossfaderCurveBox.getSelectedId() - 1)); };
+
+    // Cue/master blend for the headphones
+    addAndMakeVisible(cueMixSlider);
+    cueMixSlider.setSliderStyle(Slider::Rotary);
+    cueMixSlider.setRange(0.0, 1.0);
+    cueMixSlider.setValue(0.0);
+    cueMixSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    cueMixSlider.setColour(Slider::thumbColourId, ColourPalette::secondaryColour);
+    cueMixSlider.onValueChange = [this] { mixer.setCueMix((float)cueMixSlider.getValue()); };
+    addAndMakeVisible(cueMixLabel);
+    cueMixLabel.setText("CUE/MST", dontSendNotification);
+    cueMixLabel.setColour(Label::textColourId, ColourPalette::textColour);
+
+    // Record button
+    addAndMakeVisible(recordButton);
+    recordButton.setLookAndFeel(&buttonDesign);
+    recordButton.onClick = [this] { toggleRecording(); };
+
+    // Auto-DJ, tracks are queued from either deck's library
+    autoDJ.setDecks(&deckGUI1, &deckGUI2, [this](float position) { crossfaderSlider.setValue(position, sendNotificationSync); });
+    autoDJ.addChangeListener(this);
+    deckGUI1.setAutoDJ(&autoDJ);
+    deckGUI2.setAutoDJ(&autoDJ);
+    addAndMakeVisible(autoDJButton);
+    autoDJButton.setLookAndFeel(&buttonDesign);
+    autoDJButton.onClick = [this] { showAutoDJMenu(); };
+
     formatManager.registerBasicFormats(); // register basic audio formats (e.g., WAV, MP3) with the format manager
+
+    // Bring both decks back as they were
+    restoreSession(SessionStore::load());
 }
 
 MainComponent::~MainComponent()
 {
+    // Final snapshot while the decks still exist
+    sessionStore.saveNow();
+
     // This shuts down the audio device and clears the audio source
     shutdownAudio(); // release audio resources and shut down the audio device
+    recorder.stopRecording(); // finish the file
+    recordButton.setLookAndFeel(nullptr);
+    autoDJButton.setLookAndFeel(nullptr);
+    autoDJ.removeChangeListener(this);
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate); // prepare player1 for audio playback
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate); // prepare player2 for audio playback
-
-    mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate); // prepare the mixer source
-
-    mixerSource.addInputSource(&player1, false); // add player1 as an input source to the mixer
-    mixerSource.addInputSource(&player2, false); // add player2 as an input source to the mixer
+    mixer.prepareToPlay(samplesPerBlockExpected, sampleRate); // prepares both players and the EQ filters
+    recorder.prepareToPlay(sampleRate);
+    scheduler.prepareToPlay(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-    mixerSource.getNextAudioBlock(bufferToFill); //fill the audio buffer with the next block from the mixer source
+    scheduler.process(mixer, bufferToFill); // fill the audio buffer with the mixed decks, split at scheduled events
+    recorder.pushBlock(bufferToFill); // only copies into the recorder's FIFO
 }
 
 void MainComponent::releaseResources()
@@ -62,9 +119,7 @@ void MainComponent::releaseResources()
     // This will be called when the audio device stops, or when it is being restarted due to a setting change
 
     // For more details, see the help for AudioProcessor::releaseResources()
-    player1.releaseResources(); // release resources for player1
-    player2.releaseResources(); // release resources for player2
-    mixerSource.releaseResources(); // release resources for the mixer source
+    mixer.releaseResources(); // releases both players as well
 }
 
 void MainComponent::paint(Graphics& g)
@@ -76,8 +131,112 @@ void MainComponent::resized()
 {
     auto area = getLocalBounds();
 
+    // Crossfader strip along the bottom
+    auto strip = area.removeFromBottom(40).reduced(4);
+    crossfaderCurveBox.setBounds(strip.removeFromRight(100));
+    recordButton.setBounds(strip.removeFromLeft(100));
+    autoDJButton.setBounds(strip.removeFromLeft(120).withTrimmedLeft(4));
+    cueMixLabel.setBounds(strip.removeFromRight(70));
+    cueMixSlider.setBounds(strip.removeFromRight(40));
+    crossfaderSlider.setBounds(strip.withSizeKeepingCentre(getWidth() / 3, strip.getHeight()));
+
     // Set the bounds of deckGUI1 to the left half of the window
-    deckGUI1.setBounds(0, 0, getWidth() / 2, getHeight()); 
+    deckGUI1.setBounds(0, 0, getWidth() / 2, area.getHeight()); 
     // Set the bounds of deckGUI2 to the right half of the window
-    deckGUI2.setBounds(getWidth() / 2, 0, getWidth() / 2, getHeight()); 
+    deckGUI2.setBounds(getWidth() / 2, 0, getWidth() / 2, area.getHeight()); 
+}
+
+
+void MainComponent::toggleRecording()
+{
+    if (recorder.isRecording())
+    {
+        recorder.stopRecording();
+        recordButton.setButtonText("REC");
+
+        // Let the user know the file has gaps
+        if (recorder.getDroppedSamples() > 0)
+            AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon, "Recording",
+                String(recorder.getDroppedSamples()) + " samples could not be written in time and are missing from the recording.");
+        return;
+    }
+
+    auto flags = FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles | FileBrowserComponent::warnAboutOverwriting;
+    recordChooser.launchAsync(flags, [this](const FileChooser& chooser)
+        {
+            File file = chooser.getResult();
+            if (file == File())
+                return;
+            if (!file.hasFileExtension("wav;flac"))
+                file = file.withFileExtension("wav");
+
+            if (recorder.startRecording(file))
+                recordButton.setButtonText("STOP REC");
+            else
+                AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon, "Recording", "Could not write to " + file.getFullPathName());
+        });
+}
+
+void MainComponent::showAutoDJMenu()
+{
+    PopupMenu menu;
+    menu.addItem(autoDJ.isEnabled() ? "Stop auto-DJ" : "Start auto-DJ", [this] { autoDJ.setEnabled(!autoDJ.isEnabled()); });
+
+    // Queued tracks in play order, clicking one removes it
+    auto& playlist = autoDJ.getPlaylist();
+    if (!playlist.isEmpty()) {
+        menu.addSeparator();
+        for (int i = 0; i < playlist.size(); ++i)
+            menu.addItem(String(i + 1) + ". " + URL::removeEscapeChars(playlist[i].getFileName()), [this, i] { autoDJ.removeTrack(i); });
+        menu.addSeparator();
+        menu.addItem("Clear playlist", [this] { autoDJ.clear(); });
+    }
+    else {
+        menu.addItem("Queue tracks from the library", false, false, [] {});
+    }
+
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&autoDJButton));
+}
+
+void MainComponent::changeListenerCallback(ChangeBroadcaster* source)
+{
+    // Button shows whether it is running and how many tracks are left
+    String text = autoDJ.isEnabled() ? "AUTO DJ ON" : "AUTO DJ";
+    if (!autoDJ.getPlaylist().isEmpty())
+        text << " (" << autoDJ.getPlaylist().size() << ")";
+    autoDJButton.setButtonText(text);
+}
+
+var MainComponent::captureSession() const
+{
+    DynamicObject* obj = new DynamicObject();
+    var decks;
+    decks.append(deckGUI1.getSessionState());
+    decks.append(deckGUI2.getSessionState());
+    obj->setProperty("decks", decks);
+    obj->setProperty("crossfader", crossfaderSlider.getValue());
+    obj->setProperty("curve", crossfaderCurveBox.getSelectedId());
+    obj->setProperty("cueMix", cueMixSlider.getValue());
+    return var(obj);
+}
+
+void MainComponent::restoreSession(const var& session)
+{
+    auto* obj = session.getDynamicObject();
+    if (obj == nullptr)
+        return;
+
+    if (auto* decks = obj->getProperty("decks").getArray()) {
+        if (decks->size() > 0)
+            deckGUI1.restoreSessionState(decks->getReference(0));
+        if (decks->size() > 1)
+            deckGUI2.restoreSessionState(decks->getReference(1));
+    }
+
+    if (obj->hasProperty("crossfader"))
+        crossfaderSlider.setValue(obj->getProperty("crossfader"), sendNotificationSync);
+    if (obj->hasProperty("curve"))
+        crossfaderCurveBox.setSelectedId(obj->getProperty("curve"), sendNotificationSync);
+    if (obj->hasProperty("cueMix"))
+        cueMixSlider.setValue(obj->getProperty("cueMix"), sendNotificationSync);
 }
@@ -10,9 +10,18 @@
 
     - Creates DJAudioPlayer instances (player1, player2)
     - Creates DeckGUI instances (deckGUI1, deckGUI2) for UI controls
-    - Uses a MixerAudioSource to mix audio from both decks
+    - Mixes both decks through a DeckMixer (crossfader + per-deck EQ)
+    - REC button records the master output with a MasterRecorder
     - Registers basic audio formats using AudioFormatManager
+    - Owns the ThumbnailStore, waveform thumbnails persist across restarts
+    - Owns the TrackStore shared by both decks' library windows
     - Sets up input/output audio channels and handles permissions
+    - Outputs 1/2 are the master, 3/4 the headphone cue bus
+    - One RefreshClock updates both decks' playheads
+    - Decks and mixer controls are saved to session.json and restored on startup
+    - AUTO DJ plays the queued playlist, mixing between the two decks
+    - Audio is rendered through a TransportScheduler, scheduled events land
+      on their exact sample
 
   ==============================================================================
 */
@@ -22,12 +31,21 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
+#include "TrackStore.h"
+#include "DeckMixer.h"
+#include "MasterRecorder.h"
+#include "ThumbnailStore.h"
+#include "RefreshClock.h"
+#include "SessionStore.h"
+#include "AutoDJ.h"
+#include "TransportScheduler.h"
 
 /*
     This component lives inside our window, and this is where you should put all
     your controls and content
 */
-class MainComponent : public AudioAppComponent
+class MainComponent : public AudioAppComponent,
+    private ChangeListener
 {
     public:
         MainComponent();
@@ -42,15 +60,43 @@ class MainComponent : public AudioAppComponent
 
     private:
         AudioFormatManager formatManager;
-        AudioThumbnailCache thumbCache{ 100 };
+        ThumbnailStore thumbCache; // shared by both waveform displays
+        TrackStore trackStore;
 
         DJAudioPlayer player1{ formatManager };
         DJAudioPlayer player2{ formatManager };
 
-        DeckGUI deckGUI1{ &player1, formatManager, thumbCache };
-        DeckGUI deckGUI2{ &player2, formatManager, thumbCache };
+        DeckMixer mixer;
+        TransportScheduler scheduler; // shared audio clock for timed events
 
-        MixerAudioSource mixerSource;
+        DeckGUI deckGUI1{ &player1, formatManager, thumbCache, trackStore, mixer, 0 };
+        DeckGUI deckGUI2{ &player2, formatManager, thumbCache, trackStore, mixer, 1 };
+
+        RefreshClock refreshClock{ *this }; // drives the playheads of both decks
+
+        // Playlist and automatic mixing between the decks
+        AutoDJ autoDJ{ trackStore, scheduler };
+        TextButton autoDJButton{ "AUTO DJ" };
+        void showAutoDJMenu();
+        void changeListenerCallback(ChangeBroadcaster* source) override;
+
+        // Crossfader strip below the decks
+        Slider crossfaderSlider;
+        ComboBox crossfaderCurveBox;
+        Slider cueMixSlider;
+        Label cueMixLabel;
+
+        // Set recording
+        MasterRecorder recorder;
+        ButtonLookAndFeel buttonDesign;
+        TextButton recordButton{ "REC" };
+        FileChooser recordChooser{ "Save recording as...", File::getSpecialLocation(File::userMusicDirectory), "*.wav;*.flac" };
+        void toggleRecording();
+
+        // Session restore, declared last so it stops before anything it reads
+        var captureSession() const;
+        void restoreSession(const var& session);
+        SessionStore sessionStore{ [this] { return captureSession(); } };
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
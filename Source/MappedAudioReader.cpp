@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    MappedAudioReader.cpp
+
+  ==============================================================================
+*/
+
+#include "MappedAudioReader.h"
+#include "DecodedBlockCache.h"
+
+AudioFormatReader* MappedAudioReader::createFor(const URL& url, AudioFormatManager& formatManager, bool fullFileScan)
+{
+    if (url.isLocalFile())
+    {
+        File file = url.getLocalFile();
+        MemoryMappedAudioFormatReader* reader = nullptr;
+
+        // Compressed variants return nullptr and take the stream path
+        if (file.hasFileExtension("wav"))
+            reader = WavAudioFormat().createMemoryMappedReader(file);
+        else if (file.hasFileExtension("aif;aiff"))
+            reader = AiffAudioFormat().createMemoryMappedReader(file);
+
+        if (reader != nullptr)
+            return new MappedAudioReader(reader);
+
+        // Compressed files are decoded once into the shared block cache
+        if (auto* decoder = formatManager.createReaderFor(file))
+            return new CachedAudioReader(decoder, file, fullFileScan);
+        return nullptr;
+    }
+
+    return formatManager.createReaderFor(url.createInputStream(false));
+}
+
+MappedAudioReader::MappedAudioReader(MemoryMappedAudioFormatReader* readerToUse) :
+    AudioFormatReader(nullptr, readerToUse->getFormatName()),
+    mapped(readerToUse)
+{
+    sampleRate = mapped->sampleRate;
+    bitsPerSample = mapped->bitsPerSample;
+    lengthInSamples = mapped->lengthInSamples;
+    numChannels = mapped->numChannels;
+    usesFloatingPointData = mapped->usesFloatingPointData;
+    metadataValues = mapped->metadataValues;
+
+    // Touching one sample per page is enough to fault the page in
+    int64 bytesPerFrame = jmax((int64)1, (int64)numChannels * bitsPerSample / 8);
+    samplesPerPage = jmax((int64)1, 4096 / bytesPerFrame);
+}
+
+MappedAudioReader::~MappedAudioReader()
+{
+
+}
+
+bool MappedAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    int64 startSampleInFile, int numSamples)
+{
+    // The part past the end is cleared by the mapped reader itself
+    Range<int64> wanted = Range<int64>(startSampleInFile, startSampleInFile + numSamples).getIntersectionWith({ 0, lengthInSamples });
+    if (!wanted.isEmpty() && !ensureMapped(wanted))
+        return false;
+
+    bool ok = mapped->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+    touchAhead(wanted.getEnd());
+    return ok;
+}
+
+bool MappedAudioReader::ensureMapped(Range<int64> samples)
+{
+    if (mapped->getMappedSection().contains(samples))
+        return true;
+
+    // A new window starting a little before the read, long enough for the read itself
+    int64 start = jmax((int64)0, samples.getStart() - (int64)(behindSeconds * sampleRate));
+    int64 end = jmin(lengthInSamples, jmax(samples.getEnd(), start + (int64)(windowSeconds * sampleRate)));
+    return mapped->mapSectionOfFile({ start, end });
+}
+
+void MappedAudioReader::touchAhead(int64 from)
+{
+    Range<int64> section = mapped->getMappedSection();
+    int64 end = jmin(section.getEnd(), from + (int64)(touchSeconds * sampleRate));
+
+    for (int64 sample = jmax(from, section.getStart()); sample < end; sample += samplesPerPage)
+        mapped->touchSample(sample);
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    MappedAudioReader.h
+
+    ### Zero-copy reads of uncompressed files ###
+
+    - WAV and AIFF files are read through a MemoryMappedAudioFormatReader,
+      samples are converted straight from the mapped pages, no stream buffers
+    - Only a window of the file is mapped, it moves along with the reads
+      (playback, seeks and analysis all read through the same path)
+    - After every read the next second is touched, so its pages are faulted
+      in on the reading thread before anyone needs them
+    - Other local files are read through the DecodedBlockCache, so a deck's
+      readers share their decoded blocks; full-file scans share them too but
+      keep theirs at low priority
+    - Everything else falls back to the usual stream reader
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class MappedAudioReader : public AudioFormatReader
+{
+    public:
+        // Mapped for local WAV/AIFF files, cached for other local files, a stream reader for anything else.
+        // Readers that go through a whole file once (analysis, waveforms) pass fullFileScan
+        static AudioFormatReader* createFor(const URL& url, AudioFormatManager& formatManager, bool fullFileScan = false);
+
+        // Takes ownership of the mapped reader
+        MappedAudioReader(MemoryMappedAudioFormatReader* readerToUse);
+        ~MappedAudioReader() override;
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+            int64 startSampleInFile, int numSamples) override;
+
+    private:
+        bool ensureMapped(Range<int64> samples);
+        void touchAhead(int64 from);
+
+        std::unique_ptr<MemoryMappedAudioFormatReader> mapped;
+
+        const double windowSeconds = 30.0;
+        const double behindSeconds = 2.0; // kept mapped before the read position, for small jumps back
+        const double touchSeconds = 1.0;
+        int64 samplesPerPage = 1024;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedAudioReader)
+};
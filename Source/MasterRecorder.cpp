@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    MasterRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "MasterRecorder.h"
+
+MasterRecorder::MasterRecorder() : Thread("Master recorder")
+{
+    resizeFifo();
+}
+
+MasterRecorder::~MasterRecorder()
+{
+    stopRecording();
+}
+
+void MasterRecorder::prepareToPlay(double sampleRate)
+{
+    // The open file was created for the old rate
+    if (sampleRate != currentSampleRate)
+        stopRecording();
+
+    currentSampleRate = sampleRate;
+
+    // The writer thread may still be draining a recording at the same rate
+    if (!isThreadRunning())
+        resizeFifo();
+}
+
+bool MasterRecorder::startRecording(const File& file)
+{
+    stopRecording();
+
+    file.deleteFile();
+    std::unique_ptr<OutputStream> stream(file.createOutputStream());
+    if (stream == nullptr)
+        return false;
+
+    // FLAC stores integers, WAV keeps the float mix as it is
+    std::unique_ptr<AudioFormat> format;
+    int bitsPerSample = 32;
+    if (file.hasFileExtension("flac")) {
+        format.reset(new FlacAudioFormat());
+        bitsPerSample = 24;
+    }
+    else {
+        format.reset(new WavAudioFormat());
+    }
+
+    writer.reset(format->createWriterFor(stream.get(), currentSampleRate, numChannels, bitsPerSample, {}, 0));
+    if (writer == nullptr)
+        return false;
+    stream.release(); // the writer owns it now
+
+    // Sized in prepareToPlay, the audio thread is not in pushBlock while recording is off
+    fifo.reset();
+    droppedSamples = 0;
+    writtenSamples = 0;
+
+    startThread(Thread::Priority::normal);
+    recording = true;
+    return true;
+}
+
+void MasterRecorder::stopRecording()
+{
+    if (!recording && !isThreadRunning())
+        return;
+
+    recording = false;
+
+    // A block that saw recording still on may be copying into the FIFO
+    while (pushing.load())
+        Thread::yield();
+
+    // The thread writes what is left in the FIFO before it exits
+    signalThreadShouldExit();
+    notify();
+    stopThread(10000);
+
+    writer.reset(); // flushes and closes the file
+}
+
+bool MasterRecorder::isRecording() const
+{
+    return recording.load();
+}
+
+void MasterRecorder::pushBlock(const AudioSourceChannelInfo& block)
+{
+    // Announced before recording is checked, stopRecording waits for it to clear
+    pushing = true;
+    if (!recording) {
+        pushing = false;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(block.numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        // Mono output is recorded on both channels
+        int sourceChannel = jmin(ch, block.buffer->getNumChannels() - 1);
+        if (size1 > 0)
+            fifoBuffer.copyFrom(ch, start1, *block.buffer, sourceChannel, block.startSample, size1);
+        if (size2 > 0)
+            fifoBuffer.copyFrom(ch, start2, *block.buffer, sourceChannel, block.startSample + size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+
+    // The FIFO was full - the writer could not keep up
+    if (size1 + size2 < block.numSamples)
+        droppedSamples += block.numSamples - (size1 + size2);
+
+    pushing = false;
+}
+
+int64 MasterRecorder::getDroppedSamples() const
+{
+    return droppedSamples.load();
+}
+
+double MasterRecorder::getRecordedSeconds() const
+{
+    return writtenSamples.load() / currentSampleRate;
+}
+
+void MasterRecorder::resizeFifo()
+{
+    // Only called while neither the audio thread nor the writer touch the FIFO
+    int fifoSize = (int)(currentSampleRate * fifoSeconds);
+    fifoBuffer.setSize(numChannels, fifoSize);
+    fifo.setTotalSize(fifoSize);
+    fifo.reset();
+}
+
+void MasterRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        // Let a few blocks collect so the encoder gets large writes
+        if (fifo.getNumReady() < chunkSize)
+            wait(50);
+
+        writePendingSamples();
+    }
+
+    // Whatever arrived before recording was switched off
+    writePendingSamples();
+}
+
+void MasterRecorder::writePendingSamples()
+{
+    while (fifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        if (size1 > 0)
+            writer->writeFromAudioSampleBuffer(fifoBuffer, start1, size1);
+        if (size2 > 0)
+            writer->writeFromAudioSampleBuffer(fifoBuffer, start2, size2);
+
+        fifo.finishedRead(size1 + size2);
+        writtenSamples += size1 + size2;
+    }
+}
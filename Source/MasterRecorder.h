@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    MasterRecorder.h
+
+    ### Records the master output to disk ###
+
+    - The audio thread copies each block into a lock-free FIFO (AbstractFifo)
+    - A writer thread drains the FIFO and encodes in large chunks, so the
+      audio thread never touches the disk
+    - WAV (32-bit float, bit-exact with the mix, RF64 past 4 GB) or FLAC (24-bit)
+    - Fixed memory for any length of recording, blocks that do not fit in the
+      FIFO are counted as dropped samples
+    - The FIFO is only resized in prepareToPlay, and stopping waits until the
+      audio thread has left pushBlock before the writer is torn down
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class MasterRecorder : private Thread
+{
+    public:
+        MasterRecorder();
+        ~MasterRecorder() override;
+
+        // Audio callbacks are stopped here, the FIFO is sized for the new rate.
+        // A recording at a different rate is finished first
+        void prepareToPlay(double sampleRate);
+
+        // Message thread - the file extension picks the format (.flac or .wav)
+        bool startRecording(const File& file);
+        void stopRecording();
+        bool isRecording() const;
+
+        // Audio thread - copies the first two channels of the block
+        void pushBlock(const AudioSourceChannelInfo& block);
+
+        // Samples per channel that were lost because the writer fell behind
+        int64 getDroppedSamples() const;
+        double getRecordedSeconds() const;
+
+    private:
+        void run() override;
+        void writePendingSamples();
+        void resizeFifo();
+
+        enum { numChannels = 2, fifoSeconds = 4, chunkSize = 16384 };
+
+        double currentSampleRate = 44100.0;
+
+        AbstractFifo fifo{ 1 };
+        AudioBuffer<float> fifoBuffer;
+        std::unique_ptr<AudioFormatWriter> writer; // writer thread only while recording
+
+        std::atomic<bool> recording{ false };
+        std::atomic<bool> pushing{ false }; // set while the audio thread is inside pushBlock
+        std::atomic<int64> droppedSamples{ 0 };
+        std::atomic<int64> writtenSamples{ 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterRecorder)
+};
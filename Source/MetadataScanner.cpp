@@ -0,0 +1,512 @@
+/*
+  ==============================================================================
+
+    MetadataScanner.cpp
+
+  ==============================================================================
+*/
+
+#include "MetadataScanner.h"
+
+namespace
+{
+    const int headSize = 65536; // first read, covers the headers of most files
+    const int maxTagSize = 1 << 20; // tag chunks bigger than this are skipped
+
+    // ID3v2 sizes store 7 bits per byte
+    size_t syncSafe(const uint8* p)
+    {
+        return ((size_t)(p[0] & 0x7f) << 21) | ((size_t)(p[1] & 0x7f) << 14) | ((size_t)(p[2] & 0x7f) << 7) | (size_t)(p[3] & 0x7f);
+    }
+
+    // Decode an ID3 text frame, only the first value is kept
+    String decodeID3Text(const uint8* p, size_t size)
+    {
+        if (size < 2)
+            return {};
+
+        uint8 encoding = p[0];
+        ++p;
+        --size;
+
+        String text;
+        // ISO-8859-1 and UTF-8, NUL terminated
+        if (encoding == 0 || encoding == 3) {
+            size_t length = 0;
+            while (length < size && p[length] != 0)
+                ++length;
+            if (encoding == 3)
+                return String::fromUTF8((const char*)p, (int)length).trim();
+            for (size_t i = 0; i < length; ++i)
+                text += (juce_wchar)p[i];
+            return text.trim();
+        }
+
+        // UTF-16 with BOM (1) or big-endian without BOM (2)
+        bool bigEndian = encoding == 2;
+        if (encoding == 1 && size >= 2) {
+            bigEndian = p[0] == 0xfe && p[1] == 0xff;
+            p += 2;
+            size -= 2;
+        }
+        for (size_t i = 0; i + 1 < size; i += 2) {
+            uint32 unit = bigEndian ? (uint32)((p[i] << 8) | p[i + 1]) : (uint32)((p[i + 1] << 8) | p[i]);
+            if (unit == 0)
+                break;
+            // Surrogate pair
+            if (unit >= 0xd800 && unit < 0xdc00 && i + 3 < size) {
+                uint32 low = bigEndian ? (uint32)((p[i + 2] << 8) | p[i + 3]) : (uint32)((p[i + 3] << 8) | p[i + 2]);
+                unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                i += 2;
+            }
+            text += (juce_wchar)unit;
+        }
+        return text.trim();
+    }
+
+    // ID3v1 genre numbers, also used by "(17)" style ID3v2 genres
+    String genreName(int index)
+    {
+        static const char* genres[] = {
+            "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+            "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+            "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+            "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+            "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+            "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+            "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes",
+            "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock"
+        };
+        return index >= 0 && index < (int)numElementsInArray(genres) ? String(genres[index]) : String();
+    }
+
+    // Fixed-size, NUL padded ISO-8859-1 field (ID3v1)
+    String fixedText(const uint8* p, size_t size)
+    {
+        String text;
+        for (size_t i = 0; i < size && p[i] != 0; ++i)
+            text += (juce_wchar)p[i];
+        return text.trim();
+    }
+
+    bool hasTag(const void* data, const char* tag)
+    {
+        return std::memcmp(data, tag, 4) == 0;
+    }
+}
+
+bool MetadataScanner::scan(const File& file, TrackMetadata& metadata)
+{
+    FileInputStream in(file);
+    if (in.failedToOpen())
+        return false;
+
+    // One small read covers the headers of most formats
+    MemoryBlock head;
+    in.readIntoMemoryBlock(head, headSize);
+    if (head.getSize() < 12)
+        return false;
+
+    const char* data = static_cast<const char*>(head.getData());
+
+    if (hasTag(data, "RIFF") && hasTag(data + 8, "WAVE"))
+        return scanRiff(in, metadata);
+    if (hasTag(data, "FORM") && (hasTag(data + 8, "AIFF") || hasTag(data + 8, "AIFC")))
+        return scanAiff(in, metadata);
+    if (hasTag(data, "fLaC"))
+        return scanFlac(in, metadata);
+    if (hasTag(data, "OggS"))
+        return scanOgg(in, head, metadata);
+    if (std::memcmp(data, "ID3", 3) == 0 || file.hasFileExtension("mp3"))
+        return scanMP3(in, head, metadata);
+
+    return false;
+}
+
+bool MetadataScanner::scanMP3(FileInputStream& in, const MemoryBlock& head, TrackMetadata& metadata)
+{
+    const uint8* data = static_cast<const uint8*>(head.getData());
+    size_t headBytes = head.getSize();
+    int64 audioStart = 0;
+
+    // ID3v2 tag at the front
+    if (std::memcmp(data, "ID3", 3) == 0 && headBytes >= 10) {
+        size_t tagSize = syncSafe(data + 6);
+        audioStart = 10 + (int64)tagSize + ((data[5] & 0x10) != 0 ? 10 : 0); // optional footer
+
+        // Tags with big pictures may go past the first read
+        if (10 + tagSize > headBytes && tagSize <= (size_t)maxTagSize) {
+            MemoryBlock tag;
+            in.setPosition(0);
+            in.readIntoMemoryBlock(tag, (ssize_t)(10 + tagSize));
+            parseID3(static_cast<const uint8*>(tag.getData()), tag.getSize(), metadata);
+        }
+        else {
+            parseID3(data, headBytes, metadata);
+        }
+    }
+
+    // ID3v1 at the end, only used for fields the ID3v2 tag did not have
+    int64 totalLength = in.getTotalLength();
+    if (totalLength > 128 && in.setPosition(totalLength - 128)) {
+        uint8 v1[128];
+        if (in.read(v1, 128) == 128 && std::memcmp(v1, "TAG", 3) == 0) {
+            if (metadata.title.isEmpty()) metadata.title = fixedText(v1 + 3, 30);
+            if (metadata.artist.isEmpty()) metadata.artist = fixedText(v1 + 33, 30);
+            if (metadata.album.isEmpty()) metadata.album = fixedText(v1 + 63, 30);
+            if (metadata.genre.isEmpty()) metadata.genre = genreName(v1[127]);
+            totalLength -= 128;
+        }
+    }
+
+    // Look for the first frame header just after the tag
+    MemoryBlock frameBlock;
+    in.setPosition(audioStart);
+    in.readIntoMemoryBlock(frameBlock, 8192);
+    const uint8* frames = static_cast<const uint8*>(frameBlock.getData());
+    size_t frameBytes = frameBlock.getSize();
+
+    for (size_t i = 0; i + 4 <= frameBytes; ++i)
+    {
+        const uint8* h = frames + i;
+        if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+            continue;
+
+        int version = (h[1] >> 3) & 3; // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+        int layer = (h[1] >> 1) & 3; // 1 = Layer III
+        int bitrateIndex = h[2] >> 4;
+        int sampleRateIndex = (h[2] >> 2) & 3;
+        bool mono = (h[3] >> 6) == 3;
+
+        if (version == 1 || layer != 1 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+            continue;
+
+        static const int mpeg1Bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+        static const int mpeg2Bitrates[] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+        static const int sampleRates[] = { 44100, 48000, 32000 };
+
+        bool isMpeg1 = version == 3;
+        int bitrate = (isMpeg1 ? mpeg1Bitrates : mpeg2Bitrates)[bitrateIndex] * 1000;
+        int sampleRate = sampleRates[sampleRateIndex] >> (isMpeg1 ? 0 : (version == 2 ? 1 : 2));
+        int samplesPerFrame = isMpeg1 ? 1152 : 576;
+
+        // VBR files carry the frame count in a Xing/Info or VBRI header
+        size_t sideInfo = isMpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+        const uint8* xing = h + 4 + sideInfo;
+        const uint8* vbri = h + 4 + 32;
+
+        if (xing + 12 <= frames + frameBytes && (hasTag(xing, "Xing") || hasTag(xing, "Info"))
+            && (ByteOrder::bigEndianInt(xing + 4) & 1) != 0) {
+            metadata.durationSeconds = ByteOrder::bigEndianInt(xing + 8) * (double)samplesPerFrame / sampleRate;
+        }
+        else if (vbri + 18 <= frames + frameBytes && hasTag(vbri, "VBRI")) {
+            metadata.durationSeconds = ByteOrder::bigEndianInt(vbri + 14) * (double)samplesPerFrame / sampleRate;
+        }
+        else {
+            // Constant bitrate
+            metadata.durationSeconds = (totalLength - audioStart - (int64)i) * 8.0 / bitrate;
+        }
+        break;
+    }
+
+    return true;
+}
+
+bool MetadataScanner::scanFlac(FileInputStream& in, TrackMetadata& metadata)
+{
+    // Walk the metadata blocks, only STREAMINFO and VORBIS_COMMENT are read
+    in.setPosition(4);
+    bool lastBlock = false;
+
+    while (!lastBlock && !in.isExhausted())
+    {
+        uint8 header[4];
+        if (in.read(header, 4) != 4)
+            break;
+
+        lastBlock = (header[0] & 0x80) != 0;
+        int type = header[0] & 0x7f;
+        int length = ByteOrder::bigEndian24Bit(header + 1);
+        int64 next = in.getPosition() + length;
+
+        if (type == 0 && length >= 18) {
+            uint8 info[18];
+            in.read(info, 18);
+            int sampleRate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+            int64 totalSamples = ((int64)(info[13] & 0x0f) << 32) | (int64)ByteOrder::bigEndianInt(info + 14);
+            if (sampleRate > 0)
+                metadata.durationSeconds = totalSamples / (double)sampleRate;
+        }
+        else if (type == 4 && length <= maxTagSize) {
+            MemoryBlock comments;
+            in.readIntoMemoryBlock(comments, length);
+            parseVorbisComments(static_cast<const uint8*>(comments.getData()), comments.getSize(), metadata);
+        }
+
+        in.setPosition(next);
+    }
+
+    return true;
+}
+
+bool MetadataScanner::scanOgg(FileInputStream& in, const MemoryBlock& head, TrackMetadata& metadata)
+{
+    const uint8* data = static_cast<const uint8*>(head.getData());
+    size_t size = head.getSize();
+
+    // Reassemble the first two packets (identification and comment header) from the pages
+    MemoryBlock packets[2];
+    int packetIndex = 0;
+    size_t pos = 0;
+
+    while (packetIndex < 2 && pos + 27 <= size && hasTag(data + pos, "OggS"))
+    {
+        int numSegments = data[pos + 26];
+        size_t body = pos + 27 + (size_t)numSegments;
+        if (body > size)
+            break;
+
+        for (int segment = 0; segment < numSegments && packetIndex < 2; ++segment) {
+            int lacing = data[pos + 27 + (size_t)segment];
+            if (body + (size_t)lacing > size)
+                break;
+            packets[packetIndex].append(data + body, (size_t)lacing);
+            body += (size_t)lacing;
+            // A lacing value below 255 ends the packet
+            if (lacing < 255)
+                ++packetIndex;
+        }
+
+        // Skip to the next page
+        size_t pageBodySize = 0;
+        for (int segment = 0; segment < numSegments; ++segment)
+            pageBodySize += data[pos + 27 + (size_t)segment];
+        pos += 27 + (size_t)numSegments + pageBodySize;
+    }
+
+    int sampleRate = 0;
+    const uint8* identification = static_cast<const uint8*>(packets[0].getData());
+    if (packets[0].getSize() >= 16 && std::memcmp(identification, "\x01vorbis", 7) == 0)
+        sampleRate = (int)ByteOrder::littleEndianInt(identification + 12);
+
+    const uint8* comment = static_cast<const uint8*>(packets[1].getData());
+    if (packets[1].getSize() > 7 && std::memcmp(comment, "\x03vorbis", 7) == 0)
+        parseVorbisComments(comment + 7, packets[1].getSize() - 7, metadata);
+
+    // The granule position of the last page is the total sample count
+    int64 totalLength = in.getTotalLength();
+    if (sampleRate > 0 && in.setPosition(jmax((int64)0, totalLength - headSize)))
+    {
+        MemoryBlock tail;
+        in.readIntoMemoryBlock(tail, headSize);
+        const uint8* t = static_cast<const uint8*>(tail.getData());
+
+        for (int64 i = (int64)tail.getSize() - 27; i >= 0; --i) {
+            if (hasTag(t + i, "OggS")) {
+                int64 granule = (int64)ByteOrder::littleEndianInt64(t + i + 6);
+                if (granule > 0)
+                    metadata.durationSeconds = granule / (double)sampleRate;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MetadataScanner::scanRiff(FileInputStream& in, TrackMetadata& metadata)
+{
+    int64 totalLength = in.getTotalLength();
+    int64 dataSize = -1;
+    int byteRate = 0;
+
+    // Chunk headers only, the audio data itself is skipped
+    in.setPosition(12);
+    while (in.getPosition() + 8 <= totalLength)
+    {
+        char id[4];
+        in.read(id, 4);
+        uint32 chunkSize = (uint32)in.readInt();
+        int64 body = in.getPosition();
+
+        if (hasTag(id, "fmt ") && chunkSize >= 16) {
+            uint8 fmt[16];
+            in.read(fmt, 16);
+            byteRate = (int)ByteOrder::littleEndianInt(fmt + 8);
+        }
+        else if (hasTag(id, "data")) {
+            dataSize = chunkSize;
+        }
+        else if (hasTag(id, "LIST") && chunkSize >= 4 && chunkSize <= (uint32)maxTagSize) {
+            MemoryBlock list;
+            in.readIntoMemoryBlock(list, (ssize_t)chunkSize);
+            const uint8* p = static_cast<const uint8*>(list.getData());
+            size_t listSize = list.getSize();
+
+            // INFO sub-chunks: four character id, size, NUL terminated text
+            if (listSize >= 4 && hasTag(p, "INFO")) {
+                for (size_t pos = 4; pos + 8 <= listSize;) {
+                    const uint8* sub = p + pos;
+                    size_t subSize = ByteOrder::littleEndianInt(sub + 4);
+                    if (pos + 8 + subSize > listSize)
+                        break;
+
+                    String text = fixedText(sub + 8, subSize);
+                    if (hasTag(sub, "INAM")) metadata.title = text;
+                    else if (hasTag(sub, "IART")) metadata.artist = text;
+                    else if (hasTag(sub, "IPRD")) metadata.album = text;
+                    else if (hasTag(sub, "IGNR")) metadata.genre = text;
+
+                    pos += 8 + subSize + (subSize & 1);
+                }
+            }
+        }
+        else if ((hasTag(id, "id3 ") || hasTag(id, "ID3 ")) && chunkSize <= (uint32)maxTagSize) {
+            MemoryBlock tag;
+            in.readIntoMemoryBlock(tag, (ssize_t)chunkSize);
+            parseID3(static_cast<const uint8*>(tag.getData()), tag.getSize(), metadata);
+        }
+
+        // Chunks are padded to an even size
+        if (!in.setPosition(body + chunkSize + (chunkSize & 1)))
+            break;
+    }
+
+    if (dataSize > 0 && byteRate > 0)
+        metadata.durationSeconds = dataSize / (double)byteRate;
+
+    return true;
+}
+
+bool MetadataScanner::scanAiff(FileInputStream& in, TrackMetadata& metadata)
+{
+    int64 totalLength = in.getTotalLength();
+
+    // Same layout as RIFF, but big-endian
+    in.setPosition(12);
+    while (in.getPosition() + 8 <= totalLength)
+    {
+        char id[4];
+        in.read(id, 4);
+        uint32 chunkSize = (uint32)in.readIntBigEndian();
+        int64 body = in.getPosition();
+
+        if (hasTag(id, "COMM") && chunkSize >= 18) {
+            uint8 comm[18];
+            in.read(comm, 18);
+            uint32 numFrames = ByteOrder::bigEndianInt(comm + 2);
+
+            // Sample rate is an 80-bit extended float
+            const uint8* ext = comm + 8;
+            int exponent = ((ext[0] & 0x7f) << 8) | ext[1];
+            uint64 mantissa = ByteOrder::bigEndianInt64(ext + 2);
+            double sampleRate = std::ldexp((double)mantissa, exponent - 16383 - 63);
+
+            if (sampleRate > 0.0)
+                metadata.durationSeconds = numFrames / sampleRate;
+        }
+        else if ((hasTag(id, "NAME") || hasTag(id, "AUTH")) && chunkSize <= 4096) {
+            MemoryBlock text;
+            in.readIntoMemoryBlock(text, (ssize_t)chunkSize);
+            String value = fixedText(static_cast<const uint8*>(text.getData()), text.getSize());
+            if (hasTag(id, "NAME")) metadata.title = value;
+            else metadata.artist = value;
+        }
+        else if (hasTag(id, "ID3 ") && chunkSize <= (uint32)maxTagSize) {
+            MemoryBlock tag;
+            in.readIntoMemoryBlock(tag, (ssize_t)chunkSize);
+            parseID3(static_cast<const uint8*>(tag.getData()), tag.getSize(), metadata);
+        }
+
+        if (!in.setPosition(body + chunkSize + (chunkSize & 1)))
+            break;
+    }
+
+    return true;
+}
+
+void MetadataScanner::parseID3(const uint8* data, size_t size, TrackMetadata& metadata)
+{
+    if (size < 10 || std::memcmp(data, "ID3", 3) != 0)
+        return;
+
+    int version = data[3]; // 2, 3 or 4
+    size_t end = jmin(size, 10 + syncSafe(data + 6));
+    size_t pos = 10;
+
+    // Skip the extended header
+    if ((data[5] & 0x40) != 0 && version >= 3 && pos + 4 <= end)
+        pos += version == 4 ? syncSafe(data + pos) : 4 + (size_t)ByteOrder::bigEndianInt(data + pos);
+
+    // ID3v2.2 uses three character ids and three byte sizes
+    bool shortFrames = version == 2;
+    size_t headerSize = shortFrames ? 6 : 10;
+
+    while (pos + headerSize <= end)
+    {
+        const uint8* frame = data + pos;
+        if (frame[0] == 0)
+            break; // padding
+
+        String id = String::fromUTF8((const char*)frame, shortFrames ? 3 : 4);
+        size_t frameSize = shortFrames ? (size_t)ByteOrder::bigEndian24Bit(frame + 3)
+            : version == 4 ? syncSafe(frame + 4) : (size_t)ByteOrder::bigEndianInt(frame + 4);
+
+        pos += headerSize;
+        if (frameSize == 0 || pos + frameSize > end)
+            break;
+
+        if (id.startsWithChar('T'))
+        {
+            String text = decodeID3Text(data + pos, frameSize);
+
+            if (id == "TIT2" || id == "TT2") metadata.title = text;
+            else if (id == "TPE1" || id == "TP1") metadata.artist = text;
+            else if (id == "TALB" || id == "TAL") metadata.album = text;
+            else if (id == "TLEN" || id == "TLE") metadata.durationSeconds = text.getDoubleValue() / 1000.0;
+            else if (id == "TCON" || id == "TCO") {
+                // "(17)" or "(17)Rock" refer to the ID3v1 genre list
+                if (text.startsWithChar('(') && text.containsChar(')')) {
+                    String rest = text.fromFirstOccurrenceOf(")", false, false).trim();
+                    text = rest.isNotEmpty() ? rest : genreName(text.substring(1).getIntValue());
+                }
+                metadata.genre = text;
+            }
+        }
+
+        pos += frameSize;
+    }
+}
+
+void MetadataScanner::parseVorbisComments(const uint8* data, size_t size, TrackMetadata& metadata)
+{
+    // Vendor string, then a count of "KEY=value" strings, all length-prefixed (little-endian)
+    if (size < 8)
+        return;
+
+    size_t pos = 4 + (size_t)ByteOrder::littleEndianInt(data);
+    if (pos + 4 > size)
+        return;
+
+    uint32 count = ByteOrder::littleEndianInt(data + pos);
+    pos += 4;
+
+    for (uint32 i = 0; i < count && pos + 4 <= size; ++i)
+    {
+        size_t length = ByteOrder::littleEndianInt(data + pos);
+        pos += 4;
+        if (pos + length > size)
+            break;
+
+        String entry = String::fromUTF8((const char*)data + pos, (int)length);
+        String key = entry.upToFirstOccurrenceOf("=", false, false).toUpperCase();
+        String value = entry.fromFirstOccurrenceOf("=", false, false).trim();
+
+        if (key == "TITLE") metadata.title = value;
+        else if (key == "ARTIST") metadata.artist = value;
+        else if (key == "ALBUM") metadata.album = value;
+        else if (key == "GENRE") metadata.genre = value;
+
+        pos += length;
+    }
+}
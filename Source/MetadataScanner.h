@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    MetadataScanner.h
+
+    ### Fast tag and duration reader for library imports ###
+
+    - Parses container headers and tag blocks directly, no decoder is set up
+    - MP3: ID3v2 frames, duration from the Xing/Info/VBRI header or bitrate
+    - FLAC / Ogg Vorbis: STREAMINFO / identification header and Vorbis comments
+    - WAV: fmt/data chunks and LIST INFO, AIFF: COMM/NAME/AUTH chunks
+    - ID3 chunks inside WAV/AIFF are read as well
+    - Only reads the first few KB of a file plus a handful of chunk headers
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+struct TrackMetadata {
+    String title;
+    String artist;
+    String album;
+    String genre;
+    double durationSeconds = 0.0;
+};
+
+class MetadataScanner {
+    public:
+        // Returns false if the file is not a format we can parse
+        static bool scan(const File& file, TrackMetadata& metadata);
+
+    private:
+        static bool scanMP3(FileInputStream& in, const MemoryBlock& head, TrackMetadata& metadata);
+        static bool scanFlac(FileInputStream& in, TrackMetadata& metadata);
+        static bool scanOgg(FileInputStream& in, const MemoryBlock& head, TrackMetadata& metadata);
+        static bool scanRiff(FileInputStream& in, TrackMetadata& metadata);
+        static bool scanAiff(FileInputStream& in, TrackMetadata& metadata);
+
+        // Tag block parsers, fill in whichever fields they find
+        static void parseID3(const uint8* data, size_t size, TrackMetadata& metadata);
+        static void parseVorbisComments(const uint8* data, size_t size, TrackMetadata& metadata);
+};
@@ -8,28 +8,46 @@
 
 #include "MusicLibrary.h"
 #include "DeckGUI.h"
-#include "BPMAnalyzer.h"
+#include "AutoDJ.h"
+#include "KeyDetector.h"
 #include "ColourPalette.h"
 
-MusicLibrary::MusicLibrary(DeckGUI* deckToLoadInto, BPMAnalyzer* bpmAnalyzer) : deck(deckToLoadInto), bpmAnalyzer(bpmAnalyzer)
+MusicLibrary::MusicLibrary(TrackStore& trackStoreToUse, DeckGUI* deckToLoadInto, AutoDJ* autoDJToQueueInto) :
+    trackStore(trackStoreToUse),
+    deck(deckToLoadInto),
+    autoDJ(autoDJToQueueInto)
 {
-    // Register basic formats
-    formatManager.registerBasicFormats();
-
     // Add track button props
     addAndMakeVisible(addButton);
     addButton.addListener(this);
     addButton.setLookAndFeel(&buttonLookAndFeel);
 
+    // Watch folders button props
+    addAndMakeVisible(foldersButton);
+    foldersButton.addListener(this);
+    foldersButton.setLookAndFeel(&buttonLookAndFeel);
+
+    // Search box, filters on every keystroke
+    addAndMakeVisible(searchBox);
+    searchBox.setTextToShowWhenEmpty("Search... e.g. bpm:120-128 artist:foo dur:<6:00", ColourPalette::textColour.withAlpha(0.5f));
+    searchBox.setColour(TextEditor::backgroundColourId, ColourPalette::btnColour);
+    searchBox.setColour(TextEditor::textColourId, ColourPalette::textColour);
+    searchBox.setColour(TextEditor::outlineColourId, ColourPalette::tertiaryColour.withAlpha(0.5f));
+    searchBox.onTextChange = [this] { updateFilter(); };
+
     // Table setup
     addAndMakeVisible(table);
     table.setModel(this);
-    table.getHeader().addColumn("Title", 1, 200);
-    table.getHeader().addColumn("Duration", 2, 100);
-    table.getHeader().addColumn("BPM", 3, 80);
-    table.getHeader().addColumn("Artist", 4, 100);
-    table.getHeader().addColumn("", 5, 80); // load button
-    table.getHeader().addColumn("", 6, 80); // delete button
+    table.getHeader().addColumn("Title", TrackStore::titleColumn, 180);
+    table.getHeader().addColumn("Duration", TrackStore::durationColumn, 70);
+    table.getHeader().addColumn("BPM", TrackStore::bpmColumn, 50);
+    table.getHeader().addColumn("Key", TrackStore::keyColumn, 50);
+    table.getHeader().addColumn("Artist", TrackStore::artistColumn, 110);
+    table.getHeader().addColumn("Album", TrackStore::albumColumn, 110);
+    table.getHeader().addColumn("Genre", TrackStore::genreColumn, 70);
+    table.getHeader().addColumn("", 5, 70, 30, -1, TableHeaderComponent::notSortable); // load button
+    table.getHeader().addColumn("", 10, 70, 30, -1, TableHeaderComponent::notSortable); // queue button
+    table.getHeader().addColumn("", 6, 70, 30, -1, TableHeaderComponent::notSortable); // delete button
     table.getHeader().setColour(TableHeaderComponent::backgroundColourId, ColourPalette::bgColour);
     table.getHeader().setColour(TableHeaderComponent::textColourId, ColourPalette::textColour);
     table.getHeader().setColour(TableHeaderComponent::outlineColourId, ColourPalette::bgColour);
@@ -38,12 +56,17 @@ MusicLibrary::MusicLibrary(DeckGUI* deckToLoadInto, BPMAnalyzer* bpmAnalyzer) :
     table.setOutlineThickness(1);
     table.setRowHeight(32);
 
-    loadLibrary();
+    trackStore.addChangeListener(this);
+    trackStore.addListener(this);
+    updateFilter();
 }
 
 MusicLibrary::~MusicLibrary()
 {
-
+    trackStore.removeChangeListener(this);
+    trackStore.removeListener(this);
+    addButton.setLookAndFeel(nullptr);
+    foldersButton.setLookAndFeel(nullptr);
 }
 
 void MusicLibrary::paint(Graphics& g)
@@ -54,7 +77,11 @@ void MusicLibrary::paint(Graphics& g)
 void MusicLibrary::resized()
 {
     auto area = getLocalBounds();
-    addButton.setBounds(area.removeFromTop(40).reduced(5));
+    auto topRow = area.removeFromTop(40);
+    int buttonWidth = topRow.getWidth() / 5;
+    addButton.setBounds(topRow.removeFromLeft(buttonWidth).reduced(5));
+    foldersButton.setBounds(topRow.removeFromLeft(buttonWidth).reduced(5));
+    searchBox.setBounds(topRow.reduced(5));
     table.setBounds(area.reduced(5));
 }
 
@@ -62,22 +89,50 @@ void MusicLibrary::buttonClicked(Button* button)
 {
     // Add button
     if (button == &addButton) {
-        // Set flags to select one file
-        auto fileChooserFlags = FileBrowserComponent::canSelectFiles;
+        // Set flags to select one or more files
+        auto fileChooserFlags = FileBrowserComponent::canSelectFiles | FileBrowserComponent::canSelectMultipleItems;
 
         fChooser.launchAsync(fileChooserFlags, [this](const FileChooser& chooser)
             {
-                File chosenFile = chooser.getResult();
-                if (chosenFile.exists()) {
-                    addTrack(chosenFile); // add tracks to the library table
+                for (auto& chosenFile : chooser.getResults()) {
+                    if (chosenFile.existsAsFile()) {
+                        trackStore.addTrack(chosenFile); // add tracks to the library table
+                    }
                 }
             });
     }
+    // Watch folders button
+    if (button == &foldersButton) {
+        showFoldersMenu();
+    }
+}
+
+void MusicLibrary::showFoldersMenu()
+{
+    PopupMenu menu;
+    menu.addItem("Add watch folder...", [this] {
+        folderChooser.launchAsync(FileBrowserComponent::canSelectDirectories, [this](const FileChooser& chooser)
+            {
+                File folder = chooser.getResult();
+                if (folder.isDirectory())
+                    trackStore.addWatchFolder(folder);
+            });
+    });
+    menu.addItem("Rescan now", [this] { trackStore.rescan(); });
+
+    // One entry per watched folder to stop watching it
+    auto folders = trackStore.getWatchFolders();
+    if (!folders.isEmpty())
+        menu.addSeparator();
+    for (auto& folder : folders)
+        menu.addItem("Stop watching " + folder.getFullPathName(), [this, folder] { trackStore.removeWatchFolder(folder); });
+
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&foldersButton));
 }
 
 int MusicLibrary::getNumRows()
 {
-    return tracks.size();
+    return (int)visibleIds.size();
 }
 
 void MusicLibrary::paintRowBackground(Graphics& g, int rowNumber, int width, int height, bool rowIsSelected)
@@ -88,202 +143,147 @@ void MusicLibrary::paintRowBackground(Graphics& g, int rowNumber, int width, int
 
 void  MusicLibrary::paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
 {
-    g.setColour(rowIsSelected ? ColourPalette::btnColour : ColourPalette::textColour);
+    int index = getTrackIndex(rowNumber);
+    if (index < 0)
+        return;
+
     g.setFont(14.0f);
-    // Title column with ellipsis in case it does not fit the width
-    g.drawText(tracks[rowNumber].title, 2, 0, width - 4, height, Justification::centredLeft, true);
-}
 
-Component* MusicLibrary::refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate)
-{
-    // Duration column
-    if (columnId == 2) {
-        // Reuse component if it's already existent
-        if (existingComponentToUpdate == nullptr) {
-            auto* label = new Label();
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            label->setFont(14.0f);
-            label->setJustificationType(Justification::centredLeft);
-            int minutes = tracks[rowNumber].duration / 60; // minutes
-            int seconds = tracks[rowNumber].duration % 60; // seconds
-            // Format duration M:SS
-            label->setText(String::formatted("%d:%02d", minutes, seconds), dontSendNotification);
-            return label;
-        }
-        // Create a new one
-        else {
-            auto* label = (Label*)existingComponentToUpdate;
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            int minutes = tracks[rowNumber].duration / 60;
-            int seconds = tracks[rowNumber].duration % 60;
-            label->setText(String::formatted("%d:%02d", minutes, seconds), dontSendNotification);
-            return label;
-        }
+    // Load, queue and delete columns are painted as buttons, clicks go through cellClicked
+    if (columnId == 5 || columnId == 6 || columnId == 10) {
+        auto bounds = Rectangle<float>(0.0f, 0.0f, (float)width, (float)height).reduced(4.0f, 3.0f);
+        g.setColour(ColourPalette::btnColour);
+        g.fillRoundedRectangle(bounds, 10.0f);
+        g.setColour(ColourPalette::tertiaryColour.withAlpha(0.5f));
+        g.drawRoundedRectangle(bounds, 10.0f, 2.0f);
+        bool canLoad = columnId == 6 || !trackStore.isOffline(index);
+        g.setColour(ColourPalette::textColour.withAlpha(canLoad ? 1.0f : 0.4f));
+        g.drawText(columnId == 5 ? "Load" : columnId == 10 ? "Queue" : "Delete", bounds, Justification::centred, false);
+        return;
     }
-    // BPM column
-    else if (columnId == 3) {
-        if (existingComponentToUpdate == nullptr) {
-            auto* label = new Label();
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            label->setFont(14.0f);
-            label->setJustificationType(Justification::centredLeft);
-            String bpmStr = tracks[rowNumber].bpm > 0 ? String((int)tracks[rowNumber].bpm) : "--";
-            label->setText(bpmStr, dontSendNotification);
-            return label;
-        }
-        else {
-            auto* label = (Label*)existingComponentToUpdate;
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            String bpmStr = tracks[rowNumber].bpm > 0 ? String((int)tracks[rowNumber].bpm) : "--";
-            label->setText(bpmStr, dontSendNotification);
-            return label;
+
+    bool isOffline = trackStore.isOffline(index);
+    String text;
+    switch (columnId) {
+        case TrackStore::durationColumn: {
+            // Format duration M:SS
+            int duration = trackStore.getDuration(index);
+            text = String::formatted("%d:%02d", duration / 60, duration % 60);
+            break;
         }
+        case TrackStore::bpmColumn:
+            text = trackStore.getBpm(index) > 0 ? String((int)trackStore.getBpm(index)) : "--";
+            break;
+        case TrackStore::keyColumn:
+            text = KeyDetector::getKeyName(trackStore.getKey(index));
+            break;
+        case TrackStore::artistColumn:
+            text = trackStore.getArtist(index);
+            break;
+        case TrackStore::albumColumn:
+            text = trackStore.getAlbum(index);
+            break;
+        case TrackStore::genreColumn:
+            text = trackStore.getGenre(index);
+            break;
+        default:
+            text = trackStore.getTitle(index) + (isOffline ? " (offline)" : "");
+            break;
     }
-    // Artist column
-    else if (columnId == 4) {
-        if (existingComponentToUpdate == nullptr) {
-            auto* label = new Label();
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            label->setFont(14.0f);
-            label->setJustificationType(Justification::centredLeft);
-            label->setText(tracks[rowNumber].artist, dontSendNotification);
-            return label;
-        }
-        else {
-            auto* label = (Label*)existingComponentToUpdate;
-            label->setColour(Label::textColourId, isRowSelected ? ColourPalette::btnColour : ColourPalette::textColour);
-            label->setText(tracks[rowNumber].artist, dontSendNotification);
-            return label;
-        }
+
+    g.setColour(rowIsSelected ? ColourPalette::btnColour : ColourPalette::textColour);
+    // Dim tracks whose file is missing
+    if (isOffline)
+        g.setColour(ColourPalette::textColour.withAlpha(0.4f));
+    // Ellipsis in case the text does not fit the width
+    g.drawText(text, 2, 0, width - 4, height, Justification::centredLeft, true);
+}
+
+void MusicLibrary::cellClicked(int rowNumber, int columnId, const MouseEvent&)
+{
+    // Rows hold track ids, so a click always reaches the track that was painted
+    int index = getTrackIndex(rowNumber);
+    if (index < 0)
+        return;
+
+    // Load track, offline files are not handed to the deck
+    if (columnId == 5 && deck != nullptr && !trackStore.isOffline(index)) {
+        URL url = trackStore.getURL(index);
+        if (!deck->loadTrack(url))
+            trackStore.setOffline(index, !url.getLocalFile().existsAsFile());
     }
-    // Load track button column
-    else if (columnId == 5) {
-        TextButton* btn = (TextButton*)existingComponentToUpdate;
-        if (btn == nullptr) {
-            auto area = getLocalBounds();
-            btn = new TextButton("Load");
-            btn->setLookAndFeel(&buttonLookAndFeel);
-            btn->onClick = [this, rowNumber]() {
-                if (deck != nullptr) {
-                    deck->loadTrack(tracks[rowNumber].fileURL);
-                }
-            };
-        }
-        return btn;
+    // Queue track for the auto-DJ
+    else if (columnId == 10 && autoDJ != nullptr && !trackStore.isOffline(index)) {
+        autoDJ->addTrack(trackStore.getURL(index));
     }
     // Delete track
-    else if (columnId == 6)
-    {
-        TextButton* btn = (TextButton*)existingComponentToUpdate;
-        if (btn == nullptr)
-        {
-            btn = new TextButton("Delete");
-            btn->setLookAndFeel(&buttonLookAndFeel);
-            btn->onClick = [this, rowNumber]() {
-                if (rowNumber >= 0 && rowNumber < tracks.size()) {
-                    tracks.remove(rowNumber);
-                    saveLibrary();
-                    table.updateContent(); // reassign row numbers
-                }
-            };
-        }
-        return btn;
+    else if (columnId == 6) {
+        trackStore.removeTrack(index);
     }
-
-
-    return nullptr;
 }
 
-void MusicLibrary::addTrack(const File& f)
+void MusicLibrary::sortOrderChanged(int newSortColumnId, bool isForwards)
 {
-    // Add metadata to a track
-    Track t;
-    t.title = f.getFileName();
-    t.duration = 0;
-    t.artist = "Unknown Artist";
-    t.fileURL = URL{ f };
-    t.bpm = bpmAnalyzer->estimateBPM(f);
-
-    if (auto* reader = formatManager.createReaderFor(f)) {
-        // Read the duration and convert to int representing seconds
-        t.duration = static_cast<int>(reader->lengthInSamples / reader->sampleRate);
-
-        auto metadata = reader->metadataValues;
+    sortColumn = newSortColumnId;
+    sortForwards = isForwards;
+    updateFilter();
+}
 
-        if (metadata.containsKey("artist"))
-            t.artist = metadata["artist"]; 
+URL MusicLibrary::getTrackURL(int row)
+{
+    int index = getTrackIndex(row);
+    return index >= 0 ? trackStore.getURL(index) : URL();
+}
 
-        // Check also for standard ID3 tag that contains artist name
-        else if (metadata.containsKey("ID3:TPE1"))
-            t.artist = metadata["ID3:TPE1"];
+void MusicLibrary::changeListenerCallback(ChangeBroadcaster* source)
+{
+    // Tracks were added or removed
+    updateFilter();
+}
 
-        delete reader;
+void MusicLibrary::trackUpdated(uint32 id, int columns)
+{
+    // Changed values that the sort or the search depend on need a new query,
+    // results arrive in batches so the rebuild waits for the whole batch
+    bool affectsRows = (columns & (1 << sortColumn)) != 0 || (columns != 0 && searchBox.getText().isNotEmpty());
+    if (affectsRows) {
+        triggerAsyncUpdate();
+        return;
     }
 
-    tracks.add(t);
-    table.updateContent();
-    // Save to JSON file
-    saveLibrary();
+    if (id < rowOfId.size() && rowOfId[id] >= 0)
+        table.repaintRow(rowOfId[id]);
 }
 
-void MusicLibrary::saveLibrary()
+void MusicLibrary::handleAsyncUpdate()
 {
-    var libraryJson;
-    // Iterate through the tracks array
-    for (auto& t : tracks)
-    {
-        // Create new object to save to the JSON
-        DynamicObject* obj = new DynamicObject();
-        obj->setProperty("title", t.title);
-        obj->setProperty("duration", t.duration);
-        obj->setProperty("artist", t.artist);
-        obj->setProperty("url", t.fileURL.toString(false));
-        obj->setProperty("bpm", t.bpm);
-        libraryJson.append(var(obj));
-    }
-    // Find the file or create one
-    File f = File::getCurrentWorkingDirectory().getChildFile("library.json");
-    // Save data from object to the file
-    String jsonString = JSON::toString(libraryJson);
-    f.replaceWithText(jsonString);
+    updateFilter();
 }
 
-void MusicLibrary::loadLibrary()
+int MusicLibrary::getTrackIndex(int row) const
 {
-    // Clear tracks array to add all from JSON file again on startup
-    tracks.clear();
-    File f = File::getCurrentWorkingDirectory().getChildFile("library.json");
+    if (row < 0 || row >= (int)visibleIds.size())
+        return -1;
+    return trackStore.findId(visibleIds[(size_t)row]);
+}
 
-    if (f.existsAsFile())
-    {
-        var library = JSON::parse(f);
+void MusicLibrary::updateFilter()
+{
+    cancelPendingUpdate();
 
-        if (library.isArray())
-        {
-            // Iterate through all items
-            for (auto& item : *library.getArray())
-            {
-                // Create obj variable to hold item's data and check if it is ok
-                if (auto* obj = item.getDynamicObject())
-                {
-                    // Create track and add to the tracks array 
-                    Track t;
-                    t.title = obj->getProperty("title").toString();
-                    t.duration = (int)obj->getProperty("duration");
-                    t.artist = obj->getProperty("artist");
-                    t.fileURL = URL(obj->getProperty("url").toString());
-                    t.bpm = obj->getProperty("bpm");
-                    tracks.add(t);
-                }
-            }
-        }
+    const auto& rows = query.evaluate(searchBox.getText(), sortColumn, sortForwards);
+
+    visibleIds.resize(rows.size());
+    rowOfId.assign(rowOfId.size(), -1);
+    for (size_t row = 0; row < rows.size(); ++row)
+    {
+        uint32 id = trackStore.getId(rows[row]);
+        visibleIds[row] = id;
+        if (rowOfId.size() <= id)
+            rowOfId.resize((size_t)id + 1, -1);
+        rowOfId[id] = (int)row;
     }
-    table.updateContent();
-}
 
-URL MusicLibrary::getTrackURL(int row)
-{
-    if (row >= 0 && row < tracks.size())
-        return tracks[row].fileURL;
-    return {};
+    table.updateContent();
+    table.repaint();
 }
@@ -4,9 +4,14 @@
 	MusicLibrary.h
 
 	- Add multiple audio tracks
-	- Display each track's details (title, artist, duration)
-	- Load tracks from library into decks
-	- Persistent memory
+	- Display each track's details (title, artist, duration, BPM, key)
+	- BPM and key are analysed in the background by AnalysisQueue
+	- Load tracks from library into decks, or queue them for the auto-DJ
+	- Sort by any column and search with TrackQuery (e.g. "bpm:120-128 artist:foo")
+	- Cells are painted directly, rows hold stable track ids of the shared TrackStore
+	- Analysis results repaint only their own row unless they change the
+	  current sort order or search results
+	- Watch folders are added/removed from the Folders menu, offline tracks are dimmed
 
   ==============================================================================
 */
@@ -16,24 +21,21 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DJAudioPlayer.h"
 #include "ButtonLookAndFeel.h"
-
-struct Track {
-	String title;
-	int duration;
-	String artist;
-	URL fileURL;
-	double bpm = 0.0;
-};
+#include "TrackStore.h"
+#include "TrackQuery.h"
 
 class DeckGUI; // forward declaration
-class BPMAnalyzer; // forward declaration
+class AutoDJ;
 
 class MusicLibrary : public Component,
 	public TableListBoxModel,
-	public Button::Listener
+	public Button::Listener,
+	private ChangeListener,
+	private TrackStore::Listener,
+	private AsyncUpdater
 {
 	public:
-		MusicLibrary(DeckGUI* deckToLoadInto = nullptr, BPMAnalyzer* bpmAnalyzer = nullptr);
+		MusicLibrary(TrackStore& trackStoreToUse, DeckGUI* deckToLoadInto = nullptr, AutoDJ* autoDJToQueueInto = nullptr);
 		~MusicLibrary() override;
 
 		void paint(Graphics&) override;
@@ -44,28 +46,44 @@ class MusicLibrary : public Component,
 		int getNumRows() override;
 		void paintRowBackground(Graphics& g, int rowNumber, int width, int height, bool rowIsSelected) override;
 		void paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
-		Component* refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, Component* existingComponentToUpdate) override;
-
-		// Library controls - add, save, load library
-		void addTrack(const File& f);
-		void saveLibrary();
-		void loadLibrary();
+		void cellClicked(int rowNumber, int columnId, const MouseEvent& event) override;
+		void sortOrderChanged(int newSortColumnId, bool isForwards) override;
 
 		URL getTrackURL(int row); // get track URL by row
 
 	private:
-		FileChooser fChooser{ "Select a file..." };
+		void changeListenerCallback(ChangeBroadcaster* source) override;
+		void trackUpdated(uint32 id, int columns) override;
+		void handleAsyncUpdate() override;
 
-		DeckGUI* deck = nullptr; // pointer to the deck to load tracks into
-		BPMAnalyzer* bpmAnalyzer = nullptr; // pointer to the bpm analyzer
+		// Store index of the track shown in a row, -1 if it is gone
+		int getTrackIndex(int row) const;
+
+		// Rebuild the visible rows from the search query and sort order
+		void updateFilter();
 
-		AudioFormatManager formatManager;
+		// Popup menu for adding/removing watch folders
+		void showFoldersMenu();
+
+		FileChooser fChooser{ "Select files..." };
+		FileChooser folderChooser{ "Select a folder to watch..." };
+
+		TrackStore& trackStore; // shared track data
+		DeckGUI* deck = nullptr; // pointer to the deck to load tracks into
+		AutoDJ* autoDJ = nullptr; // playlist the Queue column adds to
 
 		ButtonLookAndFeel buttonLookAndFeel; // custom button design
 		TextButton addButton{ "Add Tracks" };
+		TextButton foldersButton{ "Watch Folders" };
+		TextEditor searchBox; // search query, see TrackQuery for the syntax
 
 		TableListBox table; // table that contains all tracks with details
-		Array<Track> tracks; // array to handle saved tracks
+
+		TrackQuery query{ trackStore };
+		std::vector<uint32> visibleIds; // track ids shown in the table, in display order
+		std::vector<int> rowOfId; // track id -> table row, -1 if not shown
+		int sortColumn = 0; // 0 = insertion order
+		bool sortForwards = true;
 
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MusicLibrary)
 };
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    RefreshClock.cpp
+
+  ==============================================================================
+*/
+
+#include "RefreshClock.h"
+
+RefreshClock::RefreshClock(Component& componentOnScreen) :
+    vBlank(&componentOnScreen, [this] { onVBlank(); })
+{
+
+}
+
+void RefreshClock::addListener(Listener* listener)
+{
+    listeners.add(listener);
+}
+
+void RefreshClock::removeListener(Listener* listener)
+{
+    listeners.remove(listener);
+}
+
+void RefreshClock::onVBlank()
+{
+    // 120/144 Hz displays would otherwise redraw more often than needed
+    double now = Time::getMillisecondCounterHiRes();
+    if (now - lastRefreshMs < minIntervalMs)
+        return;
+    lastRefreshMs = now;
+
+    listeners.call([](Listener& l) { l.refresh(); });
+}
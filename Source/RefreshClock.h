@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    RefreshClock.h
+
+    ### One UI refresh clock for all decks ###
+
+    - Driven by the display's vertical blank (VBlankAttachment)
+    - Throttled to 60 Hz on faster displays
+    - Stops by itself while the window is not on screen
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class RefreshClock
+{
+    public:
+        class Listener {
+            public:
+                virtual ~Listener() = default;
+                // Called on the message thread once per frame
+                virtual void refresh() = 0;
+        };
+
+        // The clock follows the display this component is on
+        RefreshClock(Component& componentOnScreen);
+
+        void addListener(Listener* listener);
+        void removeListener(Listener* listener);
+
+    private:
+        void onVBlank();
+
+        const double minIntervalMs = 1000.0 / 60.0 - 2.0; // a little slack for frame jitter
+        double lastRefreshMs = 0.0;
+
+        ListenerList<Listener> listeners;
+        VBlankAttachment vBlank;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RefreshClock)
+};
@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    ScratchEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "ScratchEngine.h"
+
+ScratchEngine::ScratchEngine() : Thread("Scratch decoder")
+{
+    startThread(Thread::Priority::high);
+}
+
+ScratchEngine::~ScratchEngine()
+{
+    stopThread(4000);
+}
+
+void ScratchEngine::setReader(AudioFormatReader* newReader)
+{
+    active = false;
+    wantedCentre = -1.0;
+    sourceLength = newReader != nullptr ? newReader->lengthInSamples : 0;
+    if (newReader != nullptr)
+        sampleRate = newReader->sampleRate;
+
+    // The decode thread swaps it in, it may be in the middle of a window for the old one
+    {
+        const ScopedLock sl(readerLock);
+        pendingReader.reset(newReader);
+        readerChanged = true;
+    }
+    notify();
+}
+
+void ScratchEngine::begin(double seconds)
+{
+    if (sourceLength.load() <= 0)
+        return;
+
+    // The decode thread starts on the window around here now, unless the last grab left it decoded
+    double samples = seconds * sampleRate.load();
+    target = samples;
+    position = samples;
+    wantedCentre = samples;
+    active = true;
+    notify();
+}
+
+void ScratchEngine::moveTo(double seconds)
+{
+    if (!active)
+        return;
+
+    double samples = jlimit(0.0, (double)sourceLength.load(), seconds * sampleRate.load());
+    target = samples;
+    wantedCentre = samples;
+    notify();
+}
+
+double ScratchEngine::end()
+{
+    active = false;
+    return getPosition();
+}
+
+bool ScratchEngine::isActive() const
+{
+    return active.load();
+}
+
+double ScratchEngine::getPosition() const
+{
+    return position.load() / sampleRate.load();
+}
+
+void ScratchEngine::render(const AudioSourceChannelInfo& bufferToFill)
+{
+    const SpinLock::ScopedTryLockType sl(windowLock);
+    int length = window.getNumSamples();
+    int numSamples = bufferToFill.numSamples;
+    if (!sl.isLocked() || length < 4 || numSamples <= 0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    // Glide from the current position to the latest target over this block
+    double start = position.load();
+    double end = target.load();
+    double step = (end - start) / numSamples;
+
+    // The window for this spot is still being decoded - silent until it arrives
+    if (jmin(start, end) < windowStart || jmax(start, end) > windowStart + length) {
+        bufferToFill.clearActiveBufferRegion();
+        lastGain = 0.0f;
+        position = end;
+        return;
+    }
+
+    // Silent while the record stands still, faded so stopping does not click
+    float gain = (float)jmin(1.0, std::abs(step) * 4.0);
+
+    using Register = dsp::SIMDRegister<float>;
+    const int lanes = (int)Register::size();
+    alignas(64) float y0[16], y1[16], y2[16], y3[16], frac[16], out[16];
+
+    int outChannels = bufferToFill.buffer->getNumChannels();
+    for (int ch = 0; ch < outChannels; ++ch)
+    {
+        const float* in = window.getReadPointer(jmin(ch, window.getNumChannels() - 1));
+        float* dest = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+
+        for (int i = 0; i < numSamples; i += lanes)
+        {
+            // Gather the four taps of each output sample, the math then runs on all lanes at once
+            int count = jmin(lanes, numSamples - i);
+            for (int k = 0; k < lanes; ++k)
+            {
+                double pos = jlimit(1.0, length - 3.0, start + step * (i + k + 1) - windowStart);
+                int index = (int)pos;
+                bool valid = k < count;
+                frac[k] = valid ? (float)(pos - index) : 0.0f;
+                y0[k] = valid ? in[index - 1] : 0.0f;
+                y1[k] = valid ? in[index] : 0.0f;
+                y2[k] = valid ? in[index + 1] : 0.0f;
+                y3[k] = valid ? in[index + 2] : 0.0f;
+            }
+
+            Register a = Register::fromRawArray(y0), b = Register::fromRawArray(y1);
+            Register c = Register::fromRawArray(y2), d = Register::fromRawArray(y3);
+            Register t = Register::fromRawArray(frac);
+
+            // Catmull-Rom: b + t/2 * (c - a + t * (2a - 5b + 4c - d + t * (3(b - c) + d - a)))
+            Register c3 = (b - c) * 3.0f + d - a;
+            Register c2 = a * 2.0f - b * 5.0f + c * 4.0f - d;
+            Register c1 = c - a;
+            Register result = b + t * 0.5f * (c1 + t * (c2 + t * c3));
+            result.copyToRawArray(out);
+
+            memcpy(dest + i, out, sizeof(float) * (size_t)count);
+        }
+
+        bufferToFill.buffer->applyGainRamp(ch, bufferToFill.startSample, numSamples, lastGain, gain);
+    }
+
+    lastGain = gain;
+    position = end;
+}
+
+void ScratchEngine::run()
+{
+    while (!threadShouldExit())
+    {
+        {
+            const ScopedLock sl(readerLock);
+            if (readerChanged)
+            {
+                readerChanged = false;
+                reader = std::move(pendingReader);
+
+                AudioBuffer<float> oldWindow;
+                {
+                    const SpinLock::ScopedLockType windowSl(windowLock);
+                    std::swap(window, oldWindow);
+                    windowStart = 0;
+                }
+            }
+        }
+
+        // Only a held track needs a window, a playing deck streams through the transport
+        double centre = wantedCentre;
+        if (active && reader != nullptr && centre >= 0.0 && needsWindowAround((int64)centre))
+        {
+            // Right after a grab a short window comes first, the full one on the next pass
+            bool missing = window.getNumSamples() == 0 || centre < windowStart || centre >= windowStart + window.getNumSamples();
+            if (loadWindowAround((int64)centre, missing ? grabSeconds : windowSeconds))
+                continue;
+        }
+
+        // Woken by grabs, scratch moves and new readers
+        wait(active ? 20 : -1);
+    }
+}
+
+bool ScratchEngine::needsWindowAround(int64 centre) const
+{
+    // Only this thread replaces the window, so no lock is needed to look at it
+    int64 windowEnd = windowStart + window.getNumSamples();
+    int64 edge = (int64)(edgeSeconds * reader->sampleRate);
+
+    if (window.getNumSamples() == 0 || centre < windowStart || centre > windowEnd)
+        return true;
+
+    // Near an edge that is not the start or end of the file
+    return (centre < windowStart + edge && windowStart > 0)
+        || (centre > windowEnd - edge && windowEnd < reader->lengthInSamples);
+}
+
+bool ScratchEngine::loadWindowAround(int64 centre, double halfSeconds)
+{
+    // Decode outside the lock, the audio thread keeps scratching the old window meanwhile
+    int64 half = (int64)(halfSeconds * reader->sampleRate);
+    int64 start = jmax((int64)0, centre - half);
+    int length = (int)jmin(half * 2, reader->lengthInSamples - start);
+    if (length <= 0)
+        return false;
+
+    // In one-second pieces, so a new reader or shutdown does not wait for the whole window
+    AudioBuffer<float> audio(jmax(1, (int)reader->numChannels), length);
+    int piece = jmax(1, (int)reader->sampleRate);
+    for (int done = 0; done < length; done += piece)
+    {
+        if (threadShouldExit() || readerChanged)
+            return false;
+        reader->read(&audio, done, jmin(piece, length - done), start + done, true, true);
+    }
+
+    {
+        const SpinLock::ScopedLockType sl(windowLock);
+        std::swap(window, audio);
+        windowStart = start;
+    }
+    // The old window is freed here, off the audio thread
+    return true;
+}
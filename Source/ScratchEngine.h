@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    ScratchEngine.h
+
+    ### Vinyl-style scratching for a deck ###
+
+    - Nothing is decoded while the deck just plays. Grabbing the track has a
+      background thread decode half a second either side of the grab first,
+      so the sound starts within a block or two, then the full window; the
+      window moves along when the scratch gets near its edge
+    - The UI only sets a target position; each audio block glides from where
+      it is to that target, so the sound follows the hand within one block
+    - Any rate in either direction, including standing still (silent)
+    - Cubic (Catmull-Rom) interpolation, evaluated on SIMDRegister lanes
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class ScratchEngine : private Thread
+{
+    public:
+        ScratchEngine();
+        ~ScratchEngine() override;
+
+        // Message thread - takes ownership of a separate reader on the deck's file
+        void setReader(AudioFormatReader* newReader);
+
+        // Message thread - grab the record, move it, let go (returns where it was let go)
+        void begin(double seconds);
+        void moveTo(double seconds);
+        double end();
+        bool isActive() const;
+
+        // Audio thread position, in seconds
+        double getPosition() const;
+
+        // Audio thread - replaces the block with scratched audio
+        void render(const AudioSourceChannelInfo& bufferToFill);
+
+    private:
+        void run() override;
+        bool needsWindowAround(int64 centre) const;
+        bool loadWindowAround(int64 centre, double halfSeconds); // false if nothing was swapped in
+
+        std::unique_ptr<AudioFormatReader> reader; // decode thread only
+        CriticalSection readerLock;
+        std::unique_ptr<AudioFormatReader> pendingReader; // handed over by setReader
+        std::atomic<bool> readerChanged{ false };
+
+        const double windowSeconds = 8.0; // decoded either side of the centre
+        const double grabSeconds = 0.5; // decoded either side first, right after a grab
+        const double edgeSeconds = 2.0; // re-centre when the target gets this close to the edge
+
+        SpinLock windowLock; // held by the decode thread while swapping a window in
+        AudioBuffer<float> window;
+        int64 windowStart = 0; // source sample of window[0]
+        std::atomic<double> wantedCentre{ -1.0 }; // source samples the window should cover while active
+        std::atomic<int64> sourceLength{ 0 };
+
+        std::atomic<bool> active{ false };
+        std::atomic<double> target{ 0.0 }; // source samples
+        std::atomic<double> position{ 0.0 }; // source samples, written by the audio thread
+        std::atomic<double> sampleRate{ 44100.0 }; // of the source
+        float lastGain = 0.0f; // audio thread only
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScratchEngine)
+};
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    SessionStore.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionStore.h"
+
+SessionStore::SessionStore(std::function<var()> captureSession) :
+    Thread("Session writer"),
+    capture(std::move(captureSession))
+{
+    startThread(Thread::Priority::background);
+    startTimer(2000);
+}
+
+SessionStore::~SessionStore()
+{
+    stopTimer();
+    stopThread(4000);
+}
+
+var SessionStore::load()
+{
+    File f = getFile();
+    return f.existsAsFile() ? JSON::parse(f) : var();
+}
+
+void SessionStore::saveNow()
+{
+    stopTimer();
+    stopThread(4000);
+
+    // Nothing else is writing now. The last capture may never have reached the file,
+    // so compare with what the writer thread actually wrote
+    String json = JSON::toString(capture());
+    lastJson = json;
+
+    const ScopedLock sl(lock);
+    pendingJson.clear();
+    if (json != writtenJson) {
+        write(json);
+        writtenJson = json;
+    }
+}
+
+void SessionStore::timerCallback()
+{
+    // Nothing to do while nothing changes
+    String json = JSON::toString(capture());
+    if (json == lastJson)
+        return;
+    lastJson = json;
+
+    {
+        const ScopedLock sl(lock);
+        pendingJson = json;
+    }
+    notify();
+}
+
+void SessionStore::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        String json;
+        {
+            const ScopedLock sl(lock);
+            json.swapWith(pendingJson);
+        }
+        if (json.isNotEmpty()) {
+            write(json);
+            const ScopedLock sl(lock);
+            writtenJson = json;
+        }
+    }
+}
+
+File SessionStore::getFile()
+{
+    return File::getCurrentWorkingDirectory().getChildFile("session.json");
+}
+
+void SessionStore::write(const String& json)
+{
+    // A crash mid-write keeps the previous session
+    TemporaryFile temp(getFile());
+    if (temp.getFile().replaceWithText(json))
+        temp.overwriteTargetFileWithTemporary();
+}
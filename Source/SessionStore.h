@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    SessionStore.h
+
+    ### Keeps session.json up to date ###
+
+    - Every few seconds the message thread captures the session (both decks
+      and the mixer controls) as JSON
+    - Only a changed snapshot is handed to a writer thread, which replaces
+      session.json through a temporary file
+    - saveNow() compares against what was actually written, so a snapshot
+      still waiting for the writer on shutdown is not lost
+    - The audio thread is never involved, the state comes from the UI and
+      the players' position snapshots
+    - load() returns the last saved session for restoring on startup
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class SessionStore : private Timer,
+    private Thread
+{
+    public:
+        // captureSession is called on the message thread
+        SessionStore(std::function<var()> captureSession);
+        ~SessionStore() override;
+
+        // Saved session, or void if there is none
+        static var load();
+
+        // Captures and writes straight away, used on shutdown
+        void saveNow();
+
+    private:
+        void timerCallback() override;
+        void run() override;
+        static File getFile();
+        static void write(const String& json);
+
+        std::function<var()> capture;
+        String lastJson; // last capture handed over, message thread only
+
+        CriticalSection lock;
+        String pendingJson; // handed to the writer thread
+        String writtenJson; // what session.json holds
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionStore)
+};
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    SpectrogramColourMap.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrogramColourMap.h"
+#include "ColourPalette.h"
+
+namespace
+{
+    uint32 keyFor(float value)
+    {
+        uint32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits >> 16; // sign, exponent and 7 mantissa bits - about 0.07 dB steps
+    }
+}
+
+SpectrogramColourMap::SpectrogramColourMap(float minDecibels) :
+    minGain(Decibels::decibelsToGain(minDecibels, minDecibels - 1.0f))
+{
+    buildIndexTable();
+    setPalette(appPalette);
+}
+
+void SpectrogramColourMap::setPalette(Palette newPalette)
+{
+    palette = newPalette;
+
+    ColourGradient gradient;
+    switch (palette)
+    {
+        case magmaPalette:
+            gradient.addColour(0.0, Colour(0xff000004));
+            gradient.addColour(0.3, Colour(0xff51127c));
+            gradient.addColour(0.6, Colour(0xffb73779));
+            gradient.addColour(0.8, Colour(0xfffc8961));
+            gradient.addColour(1.0, Colour(0xfffcfdbf));
+            break;
+        case greyPalette:
+            gradient.addColour(0.0, Colours::black);
+            gradient.addColour(1.0, Colours::white);
+            break;
+        default:
+            // The app's own colours, in the order the old stepped map used them
+            gradient.addColour(0.0, ColourPalette::btnColour);
+            gradient.addColour(0.2, ColourPalette::btnColour);
+            gradient.addColour(0.4, ColourPalette::primaryColour);
+            gradient.addColour(0.6, ColourPalette::tertiaryColour);
+            gradient.addColour(0.8, ColourPalette::secondaryColour);
+            gradient.addColour(1.0, ColourPalette::accentColour);
+            break;
+    }
+
+    for (int i = 0; i < 256; ++i)
+        lut[i] = gradient.getColourAtPosition(i / 255.0).getPixelARGB();
+}
+
+SpectrogramColourMap::Palette SpectrogramColourMap::getPalette() const
+{
+    return palette;
+}
+
+String SpectrogramColourMap::getPaletteName(Palette palette)
+{
+    switch (palette)
+    {
+        case magmaPalette: return "Magma";
+        case greyPalette: return "Grey";
+        default: return "OtoDecks";
+    }
+}
+
+void SpectrogramColourMap::mapRow(float* magnitudes, int numValues, PixelARGB* destination) const
+{
+    // Keeps every key inside the table
+    FloatVectorOperations::clip(magnitudes, magnitudes, minGain, 1.0f, numValues);
+
+    const uint8* indices = indexTable.data();
+    for (int i = 0; i < numValues; ++i)
+        destination[i] = lut[indices[keyFor(magnitudes[i]) - firstKey]];
+}
+
+PixelARGB SpectrogramColourMap::getPixel(float level) const
+{
+    return lut[jlimit(0, 255, (int)(level * 255.0f))];
+}
+
+void SpectrogramColourMap::buildIndexTable()
+{
+    // A few thousand entries cover the whole dB range
+    firstKey = keyFor(minGain);
+    uint32 lastKey = keyFor(1.0f);
+    indexTable.resize(lastKey - firstKey + 1);
+
+    float minDecibels = Decibels::gainToDecibels(minGain);
+    for (uint32 key = firstKey; key <= lastKey; ++key)
+    {
+        // Middle of the range of floats that share this key
+        uint32 bits = (key << 16) | 0x8000;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+
+        float dB = Decibels::gainToDecibels(jmin(value, 1.0f), minDecibels);
+        indexTable[key - firstKey] = (uint8)jlimit(0, 255, (int)((dB - minDecibels) / -minDecibels * 255.0f));
+    }
+}
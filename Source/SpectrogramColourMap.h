@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    SpectrogramColourMap.h
+
+    ### Turns spectrum magnitudes into pixels ###
+
+    - Selectable gradient palettes, precomputed into a 256-entry colour LUT
+    - mapRow converts a whole row of magnitudes to pixels in one pass:
+      clamped with SIMD (FloatVectorOperations), then dB and palette index come
+      from a small table keyed by the float's exponent and top mantissa bits,
+      so there is no log, jmap or branch per pixel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class SpectrogramColourMap
+{
+    public:
+        enum Palette { appPalette, magmaPalette, greyPalette, numPalettes };
+
+        // Magnitudes at or below minDecibels get the first colour, 0 dB and above the last
+        SpectrogramColourMap(float minDecibels = -100.0f);
+
+        void setPalette(Palette newPalette);
+        Palette getPalette() const;
+        static String getPaletteName(Palette palette);
+
+        // Clamps magnitudes in place and writes one pixel per entry
+        void mapRow(float* magnitudes, int numValues, PixelARGB* destination) const;
+
+        // For levels that are already normalised to 0..1
+        PixelARGB getPixel(float level) const;
+
+    private:
+        void buildIndexTable();
+
+        Palette palette = appPalette;
+        PixelARGB lut[256];
+
+        // Palette index for every (float bits >> 16) between the floor and 0 dB
+        float minGain;
+        uint32 firstKey = 0;
+        std::vector<uint8> indexTable;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramColourMap)
+};
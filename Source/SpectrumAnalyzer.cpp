@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+#include "ColourPalette.h"
+
+SpectrumAnalyzer::SpectrumAnalyzer() : Thread("Spectrum analyzer")
+{
+    fifoData.calloc(fifoSize);
+    history.calloc(fftSize);
+    fftData.calloc(fftSize * 2);
+    columns.calloc(numColumns * numRows);
+    ringImage.clear(ringImage.getBounds(), ColourPalette::btnColour);
+
+    // Rows are spaced logarithmically from the first bin to Nyquist
+    const int numBins = fftSize / 2;
+    int previous = 0;
+    for (int row = 0; row < numRows; ++row)
+    {
+        int bin = jlimit(1, numBins - 1, roundToInt(std::pow((double)numBins, (row + 1) / (double)numRows)));
+        firstBin[row] = jmin(previous + 1, bin);
+        lastBin[row] = bin;
+        previous = bin;
+    }
+
+    startThread(Thread::Priority::low);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stopThread(1000);
+}
+
+void SpectrumAnalyzer::paint(Graphics& g)
+{
+    // Oldest column sits at the write position, draw from there so the image scrolls left
+    int split = (int)(columnsDrawn % numColumns);
+    float columnWidth = getWidth() / (float)numColumns;
+    int splitX = roundToInt((numColumns - split) * columnWidth);
+
+    g.drawImage(ringImage, 0, 0, splitX, getHeight(), split, 0, numColumns - split, numRows);
+    if (split > 0)
+        g.drawImage(ringImage, splitX, 0, getWidth() - splitX, getHeight(), 0, 0, split, numRows);
+}
+
+void SpectrumAnalyzer::pushSamples(const AudioSourceChannelInfo& block)
+{
+    int numChannels = block.buffer->getNumChannels();
+    if (numChannels == 0)
+        return;
+
+    int numToWrite = jmin(block.numSamples, fifo.getFreeSpace());
+    const auto scope = fifo.write(numToWrite);
+    float scale = 1.0f / numChannels;
+
+    // Two parts when the write wraps around the end of the FIFO
+    int offset = block.startSample;
+    for (auto [start, size] : { std::make_pair(scope.startIndex1, scope.blockSize1),
+                                std::make_pair(scope.startIndex2, scope.blockSize2) })
+    {
+        for (int i = 0; i < size; ++i) {
+            float sum = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch)
+                sum += block.buffer->getSample(ch, offset + i);
+            fifoData[start + i] = sum * scale;
+        }
+        offset += size;
+    }
+}
+
+void SpectrumAnalyzer::refresh()
+{
+    int64 written = columnsWritten.load(std::memory_order_acquire);
+    if (written == columnsDrawn)
+        return;
+
+    // If the UI stalled for longer than the ring, only the last numColumns are still valid
+    columnsDrawn = jmax(columnsDrawn, written - numColumns);
+
+    Image::BitmapData pixels(ringImage, Image::BitmapData::writeOnly);
+    for (; columnsDrawn < written; ++columnsDrawn)
+    {
+        int x = (int)(columnsDrawn % numColumns);
+        const float* column = columns + x * numRows;
+
+        // Low frequencies at the bottom
+        for (int row = 0; row < numRows; ++row)
+            *reinterpret_cast<PixelARGB*>(pixels.getPixelPointer(x, numRows - 1 - row)) = colourMap.getPixel(column[row]);
+    }
+
+    repaint();
+}
+
+void SpectrumAnalyzer::run()
+{
+    while (!threadShouldExit())
+    {
+        if (!processNextColumn())
+            wait(5);
+    }
+}
+
+bool SpectrumAnalyzer::processNextColumn()
+{
+    if (fifo.getNumReady() < hopSize)
+        return false;
+
+    // Slide the window along by one hop
+    memmove(history.get(), history + hopSize, sizeof(float) * (fftSize - hopSize));
+    {
+        const auto scope = fifo.read(hopSize);
+        float* destination = history + (fftSize - hopSize);
+        memcpy(destination, fifoData + scope.startIndex1, sizeof(float) * (size_t)scope.blockSize1);
+        memcpy(destination + scope.blockSize1, fifoData + scope.startIndex2, sizeof(float) * (size_t)scope.blockSize2);
+    }
+
+    memcpy(fftData.get(), history.get(), sizeof(float) * fftSize);
+    zeromem(fftData + fftSize, sizeof(float) * fftSize);
+    window.multiplyWithWindowingTable(fftData, fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData);
+
+    // A full-scale sine through the Hann window peaks at fftSize / 4
+    int64 index = columnsWritten.load(std::memory_order_relaxed);
+    float* column = columns + (index % numColumns) * numRows;
+    const float scale = 4.0f / fftSize;
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        float magnitude = 0.0f;
+        for (int bin = firstBin[row]; bin <= lastBin[row]; ++bin)
+            magnitude = jmax(magnitude, fftData[bin]);
+
+        float dB = Decibels::gainToDecibels(magnitude * scale, -90.0f);
+        column[row] = jmap(dB, -90.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    columnsWritten.store(index + 1, std::memory_order_release);
+    return true;
+}
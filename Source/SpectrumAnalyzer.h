@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+
+    ### Live scrolling spectrogram of a deck ###
+
+    - The audio thread pushes the deck's output into a lock-free FIFO (AbstractFifo)
+    - A background thread runs windowed FFTs (same size as WaveformDisplay's)
+      with 50% overlap and writes one column per FFT into a fixed ring
+    - The message thread copies new columns into a fixed-size image ring and
+      draws it scrolling, newest column on the right
+    - All buffers are allocated in the constructor, nothing is allocated
+      while audio is running
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WaveformDisplay.h"
+#include "SpectrogramColourMap.h"
+
+class SpectrumAnalyzer : public Component, private Thread
+{
+    public:
+        SpectrumAnalyzer();
+        ~SpectrumAnalyzer() override;
+
+        void paint(Graphics&) override;
+
+        // Audio thread - mixes the block down to mono, drops what does not fit
+        void pushSamples(const AudioSourceChannelInfo& block);
+
+        // Message thread, once per frame - picks up the columns computed since the last one
+        void refresh();
+
+    private:
+        void run() override;
+        bool processNextColumn();
+
+        enum {
+            fftOrder = WaveformDisplay::fftOrder,
+            fftSize = WaveformDisplay::fftSize,
+            hopSize = fftSize / 2,
+            fifoSize = fftSize * 8,
+            numColumns = 256, // image width, about 3 seconds at 44.1 kHz
+            numRows = 96 // logarithmic frequency rows
+        };
+
+        // Audio thread -> FFT thread
+        AbstractFifo fifo{ fifoSize };
+        HeapBlock<float> fifoData;
+
+        // FFT thread only
+        dsp::FFT fft{ fftOrder };
+        dsp::WindowingFunction<float> window{ fftSize, dsp::WindowingFunction<float>::hann };
+        HeapBlock<float> history; // last fftSize samples
+        HeapBlock<float> fftData; // 2 * fftSize for the in-place transform
+        int firstBin[numRows], lastBin[numRows]; // bins that make up each row
+
+        // FFT thread -> message thread, levels 0..1 per row
+        HeapBlock<float> columns; // numColumns * numRows
+        std::atomic<int64> columnsWritten{ 0 };
+
+        // Message thread only
+        Image ringImage{ Image::ARGB, numColumns, numRows, true };
+        SpectrogramColourMap colourMap;
+        int64 columnsDrawn = 0;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
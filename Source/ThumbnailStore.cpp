@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    ThumbnailStore.cpp
+
+  ==============================================================================
+*/
+
+#include "ThumbnailStore.h"
+
+ContentHashInputSource::ContentHashInputSource(const File& fileToUse) : file(fileToUse)
+{
+    // Size plus the first and last 64 KB, enough to tell files apart without reading them whole
+    const int64 sampleSize = 65536;
+    int64 size = file.getSize();
+    uint64 hash = 14695981039346656037ull ^ (uint64)size; // FNV-1a
+
+    FileInputStream in(file);
+    if (in.openedOk())
+    {
+        HeapBlock<uint8> data((size_t)sampleSize);
+        int64 offsets[] = { 0, jmax((int64)0, size - sampleSize) };
+
+        for (int64 offset : offsets)
+        {
+            in.setPosition(offset);
+            int bytesRead = in.read(data, (int)sampleSize);
+            for (int i = 0; i < bytesRead; ++i)
+                hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+    }
+
+    contentHash = (int64)hash;
+}
+
+InputStream* ContentHashInputSource::createInputStream()
+{
+    return file.createInputStream().release();
+}
+
+InputStream* ContentHashInputSource::createInputStreamFor(const String& relatedItemPath)
+{
+    return file.getSiblingFile(relatedItemPath).createInputStream().release();
+}
+
+int64 ContentHashInputSource::hashCode() const
+{
+    return contentHash;
+}
+
+ThumbnailStore::ThumbnailStore() :
+    // The base class only keeps the latest thumbnail, the budgeted cache lives here
+    AudioThumbnailCache(1),
+    directory(File::getCurrentWorkingDirectory().getChildFile("thumbnails"))
+{
+    directory.createDirectory();
+    getTimeSliceThread().addTimeSliceClient(this);
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    getTimeSliceThread().removeTimeSliceClient(this);
+
+    // Write anything still queued
+    while (useTimeSlice() == 0) {}
+}
+
+ThumbnailStore::Stats ThumbnailStore::getStats() const
+{
+    const ScopedLock sl(lock);
+    Stats result = stats;
+    result.memoryBytes = memoryBytes;
+    return result;
+}
+
+double ThumbnailStore::getHitRate() const
+{
+    const ScopedLock sl(lock);
+    int64 lookups = stats.memoryHits + stats.diskHits + stats.misses;
+    return lookups > 0 ? (double)(stats.memoryHits + stats.diskHits) / lookups : 0.0;
+}
+
+void ThumbnailStore::storeData(int64 key, const MemoryBlock& data)
+{
+    const ScopedLock sl(lock);
+    addToMemory(key, data);
+    pendingWrites.push_back({ key, data });
+}
+
+bool ThumbnailStore::findData(int64 key, MemoryBlock& data)
+{
+    return find(key, data, false);
+}
+
+bool ThumbnailStore::find(int64 key, MemoryBlock& data, bool isThumbnail)
+{
+    {
+        const ScopedLock sl(lock);
+        auto found = entryIndex.find(key);
+        if (found != entryIndex.end())
+        {
+            // Move to the front of the LRU list
+            entries.splice(entries.begin(), entries, found->second);
+            ++(isThumbnail ? stats.memoryHits : stats.dataHits);
+            data = found->second->data;
+            return true;
+        }
+    }
+
+    // Written by an earlier session
+    if (getFileFor(key).loadFileAsData(data) && data.getSize() > 0)
+    {
+        const ScopedLock sl(lock);
+        ++(isThumbnail ? stats.diskHits : stats.dataHits);
+        addToMemory(key, data);
+        return true;
+    }
+
+    const ScopedLock sl(lock);
+    ++(isThumbnail ? stats.misses : stats.dataMisses);
+    return false;
+}
+
+void ThumbnailStore::saveNewlyFinishedThumbnail(const AudioThumbnailBase& thumb, int64 hashCode)
+{
+    MemoryBlock data;
+    {
+        MemoryOutputStream out(data, false);
+        thumb.saveTo(out);
+    }
+    storeData(hashCode, data);
+}
+
+bool ThumbnailStore::loadNewThumb(AudioThumbnailBase& thumb, int64 hashCode)
+{
+    MemoryBlock data;
+    if (!find(hashCode, data, true))
+        return false;
+
+    MemoryInputStream in(data, false);
+    return thumb.loadFrom(in);
+}
+
+int ThumbnailStore::useTimeSlice()
+{
+    Entry entry;
+    {
+        const ScopedLock sl(lock);
+        if (pendingWrites.empty())
+            return 500;
+
+        entry = std::move(pendingWrites.back());
+        pendingWrites.pop_back();
+    }
+
+    // Write to a temp file first so a crash never leaves half a thumbnail
+    TemporaryFile temp(getFileFor(entry.hashCode));
+    if (temp.getFile().replaceWithData(entry.data.getData(), entry.data.getSize()))
+        temp.overwriteTargetFileWithTemporary();
+
+    trimDiskStore();
+    return 0;
+}
+
+void ThumbnailStore::addToMemory(int64 hashCode, const MemoryBlock& data)
+{
+    auto found = entryIndex.find(hashCode);
+    if (found != entryIndex.end()) {
+        memoryBytes -= found->second->data.getSize();
+        entries.erase(found->second);
+        entryIndex.erase(found);
+    }
+
+    entries.push_front({ hashCode, data });
+    entryIndex[hashCode] = entries.begin();
+    memoryBytes += data.getSize();
+
+    // Evict the least recently used thumbnails until the budget fits
+    while (memoryBytes > memoryBudget && entries.size() > 1)
+    {
+        memoryBytes -= entries.back().data.getSize();
+        entryIndex.erase(entries.back().hashCode);
+        entries.pop_back();
+    }
+}
+
+File ThumbnailStore::getFileFor(int64 hashCode) const
+{
+    return directory.getChildFile(String::toHexString(hashCode) + ".thumb");
+}
+
+void ThumbnailStore::trimDiskStore()
+{
+    Array<File> files = directory.findChildFiles(File::findFiles, false, "*.thumb");
+
+    int64 total = 0;
+    for (auto& f : files)
+        total += f.getSize();
+    if (total <= diskBudget)
+        return;
+
+    // Oldest first
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+        return a.getLastAccessTime() < b.getLastAccessTime();
+    });
+
+    for (auto& f : files)
+    {
+        if (total <= diskBudget)
+            break;
+        total -= f.getSize();
+        f.deleteFile();
+    }
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    ThumbnailStore.h
+
+    ### Waveform thumbnail cache shared by both decks ###
+
+    - AudioThumbnailCache with a byte budget and least-recently-used eviction
+    - Thumbnails are keyed by a hash of the file content, not its path
+    - Finished thumbnails are written to thumbnails/ on the cache's own
+      background thread, so a track seen before is never scanned again
+    - Other per-track data (the banded waveform overview) can be stored
+      under its own key and shares the same budgets
+    - Memory hits, disk hits and misses are counted; lookups of the other
+      data are counted apart, so they do not skew the thumbnail hit rate
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Input source whose hash comes from the file size and content, so a moved
+// or renamed file keeps its thumbnail and an edited one gets a new one
+class ContentHashInputSource : public InputSource
+{
+    public:
+        ContentHashInputSource(const File& file);
+
+        InputStream* createInputStream() override;
+        InputStream* createInputStreamFor(const String& relatedItemPath) override;
+        int64 hashCode() const override;
+
+    private:
+        File file;
+        int64 contentHash = 0;
+};
+
+class ThumbnailStore : public AudioThumbnailCache,
+    private TimeSliceClient
+{
+    public:
+        ThumbnailStore();
+        ~ThumbnailStore() override;
+
+        struct Stats {
+            int64 memoryHits = 0; // thumbnail lookups
+            int64 diskHits = 0;
+            int64 misses = 0;
+            int64 dataHits = 0; // findData lookups (the overview), memory or disk
+            int64 dataMisses = 0;
+            size_t memoryBytes = 0;
+        };
+        Stats getStats() const;
+
+        // Share of thumbnail lookups answered without scanning the audio file
+        double getHitRate() const;
+
+        // Any thread - raw data kept next to the thumbnails, keys must not clash with content hashes
+        void storeData(int64 key, const MemoryBlock& data);
+        bool findData(int64 key, MemoryBlock& data);
+
+    private:
+        void saveNewlyFinishedThumbnail(const AudioThumbnailBase& thumb, int64 hashCode) override;
+        bool loadNewThumb(AudioThumbnailBase& thumb, int64 hashCode) override;
+        int useTimeSlice() override;
+
+        bool find(int64 key, MemoryBlock& data, bool isThumbnail);
+        void addToMemory(int64 hashCode, const MemoryBlock& data);
+        File getFileFor(int64 hashCode) const;
+        void trimDiskStore();
+
+        const size_t memoryBudget = 32 * 1024 * 1024;
+        const int64 diskBudget = 256 * 1024 * 1024;
+        const File directory;
+
+        CriticalSection lock;
+
+        // Most recently used at the front
+        struct Entry {
+            int64 hashCode;
+            MemoryBlock data;
+        };
+        std::list<Entry> entries;
+        std::unordered_map<int64, std::list<Entry>::iterator> entryIndex;
+        size_t memoryBytes = 0;
+
+        // Waiting for the background thread to write them
+        std::vector<Entry> pendingWrites;
+
+        Stats stats;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThumbnailStore)
+};
@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    TrackQuery.cpp
+
+  ==============================================================================
+*/
+
+#include "TrackQuery.h"
+#include "KeyDetector.h"
+
+TrackQuery::TrackQuery(TrackStore& trackStoreToUse) : trackStore(trackStoreToUse)
+{
+
+}
+
+const std::vector<int>& TrackQuery::evaluate(const String& queryText, int sortColumn, bool sortForwards)
+{
+    // Cached term results are only valid for one version of the store
+    bool storeChanged = cachedGeneration != trackStore.getGeneration();
+    if (storeChanged) {
+        termCache.clear();
+        cachedGeneration = trackStore.getGeneration();
+    }
+
+    Array<Term> terms = parse(queryText);
+    Array<Term> lastTerms = parse(lastQuery);
+
+    // The new query narrows the last one if it only appends terms or extends a trailing text term
+    bool narrows = !storeChanged && sortColumn == lastSortColumn && sortForwards == lastSortForwards
+        && lastQuery.isNotEmpty() && terms.size() >= lastTerms.size();
+
+    for (int i = 0; narrows && i < lastTerms.size(); ++i) {
+        const Term& before = lastTerms.getReference(i);
+        const Term& now = terms.getReference(i);
+        bool sameTerm = before.source == now.source;
+        bool extendedText = i == lastTerms.size() - 1 && before.type == Term::text && now.type == Term::text
+            && now.value.find(before.value) != std::string::npos;
+        narrows = sameTerm || extendedText;
+    }
+
+    lastQuery = queryText;
+    lastSortColumn = sortColumn;
+    lastSortForwards = sortForwards;
+
+    auto passes = [this](int index, const Term& term) {
+        if (term.type == Term::text)
+            return trackStore.getSearchText(index).find(term.value) != std::string::npos;
+        const auto& matches = lookup(term);
+        return std::binary_search(matches.begin(), matches.end(), index);
+    };
+
+    // Narrowing - re-check only the current rows, they are already in display order
+    if (narrows) {
+        int firstChanged = jmax(0, lastTerms.size() - 1);
+        std::vector<int> rows;
+        for (int index : result) {
+            bool keep = true;
+            for (int i = firstChanged; keep && i < terms.size(); ++i)
+                keep = passes(index, terms.getReference(i));
+            if (keep)
+                rows.push_back(index);
+        }
+        result.swap(rows);
+        return result;
+    }
+
+    // Intersect the indexed terms, smallest set first
+    std::vector<const std::vector<int>*> sets;
+    for (auto& term : terms) {
+        if (term.type != Term::text)
+            sets.push_back(&lookup(term));
+    }
+    std::sort(sets.begin(), sets.end(), [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+
+    std::vector<int> rows;
+    if (sets.empty()) {
+        rows = trackStore.getSortedIndices(0); // every live track, in insertion order
+    }
+    else {
+        rows = *sets[0];
+        for (size_t i = 1; i < sets.size() && !rows.empty(); ++i) {
+            std::vector<int> both;
+            std::set_intersection(rows.begin(), rows.end(), sets[i]->begin(), sets[i]->end(), std::back_inserter(both));
+            rows.swap(both);
+        }
+    }
+
+    // Substring terms are checked on what is left
+    for (auto& term : terms) {
+        if (term.type == Term::text) {
+            rows.erase(std::remove_if(rows.begin(), rows.end(), [&](int index) { return !passes(index, term); }), rows.end());
+        }
+    }
+
+    orderResults(rows, sortColumn, sortForwards);
+    result.swap(rows);
+    return result;
+}
+
+Array<TrackQuery::Term> TrackQuery::parse(const String& queryText)
+{
+    Array<Term> terms;
+
+    for (auto& token : StringArray::fromTokens(queryText, " \t", ""))
+    {
+        if (token.isEmpty())
+            continue;
+
+        Term term;
+        term.source = token.toLowerCase();
+
+        String field = token.upToFirstOccurrenceOf(":", false, false).toLowerCase();
+        String value = token.fromFirstOccurrenceOf(":", false, false);
+        bool hasField = token.containsChar(':');
+
+        if (hasField && field == "bpm") {
+            term.type = Term::bpm;
+            if (!parseRange(value, false, term.min, term.max))
+                continue; // incomplete while typing, ignore
+        }
+        else if (hasField && (field == "dur" || field == "duration")) {
+            term.type = Term::duration;
+            if (!parseRange(value, true, term.min, term.max))
+                continue;
+        }
+        else if (hasField && field == "key") {
+            term.type = Term::key;
+            term.min = -1;
+            for (int key = 0; key < 24; ++key) {
+                if (KeyDetector::getKeyName(key).equalsIgnoreCase(value))
+                    term.min = term.max = key;
+            }
+            if (term.min < 0)
+                continue;
+        }
+        else if (hasField && (field == "artist" || field == "title" || field == "album" || field == "genre")) {
+            term.type = field == "artist" ? Term::artist
+                : field == "album" ? Term::album
+                : field == "genre" ? Term::genre
+                : Term::title;
+            term.value = value.toLowerCase().toStdString();
+            if (term.value.empty())
+                continue;
+        }
+        else {
+            // Plain words and unknown fields are substring matches
+            term.value = token.toLowerCase().toStdString();
+        }
+
+        terms.add(term);
+    }
+
+    return terms;
+}
+
+bool TrackQuery::parseRange(const String& value, bool isDuration, double& min, double& max)
+{
+    String v = value.trim();
+    double lowest = std::numeric_limits<double>::lowest();
+    double highest = std::numeric_limits<double>::max();
+
+    if (v.startsWith("<=") || v.startsWith(">=")) {
+        double number = parseNumber(v.substring(2), isDuration);
+        min = v[0] == '>' ? number : lowest;
+        max = v[0] == '<' ? number : highest;
+        return number >= 0.0;
+    }
+    if (v.startsWithChar('<') || v.startsWithChar('>')) {
+        // Strict comparisons, nudge the bound just past the value
+        double number = parseNumber(v.substring(1), isDuration);
+        min = v[0] == '>' ? number + 1.0e-6 : lowest;
+        max = v[0] == '<' ? number - 1.0e-6 : highest;
+        return number >= 0.0;
+    }
+    if (v.indexOfChar('-') > 0) {
+        // "120-128", an open end while typing ("120-") means no upper bound
+        min = parseNumber(v.upToFirstOccurrenceOf("-", false, false), isDuration);
+        String upper = v.fromFirstOccurrenceOf("-", false, false);
+        max = upper.isEmpty() ? highest : parseNumber(upper, isDuration);
+        return min >= 0.0 && max >= min;
+    }
+
+    double number = parseNumber(v, isDuration);
+    // BPMs are shown rounded, so an exact BPM matches the whole integer
+    min = isDuration ? number : number - 0.5;
+    max = isDuration ? number : number + 0.5 - 1.0e-6;
+    return number >= 0.0;
+}
+
+double TrackQuery::parseNumber(const String& value, bool isDuration)
+{
+    String v = value.trim();
+    if (v.isEmpty() || !v.containsOnly(isDuration ? "0123456789.:" : "0123456789."))
+        return -1.0;
+
+    // Durations are m:ss or plain seconds
+    if (isDuration && v.containsChar(':'))
+        return v.upToFirstOccurrenceOf(":", false, false).getIntValue() * 60.0
+            + v.fromFirstOccurrenceOf(":", false, false).getDoubleValue();
+
+    return v.getDoubleValue();
+}
+
+const std::vector<int>& TrackQuery::lookup(const Term& term)
+{
+    auto found = termCache.find(term.source);
+    if (found != termCache.end())
+        return found->second;
+
+    std::vector<int> matches;
+    switch (term.type) {
+        case Term::title: matches = trackStore.findWordPrefix(TrackStore::titleColumn, term.value); break;
+        case Term::artist: matches = trackStore.findWordPrefix(TrackStore::artistColumn, term.value); break;
+        case Term::album: matches = trackStore.findWordPrefix(TrackStore::albumColumn, term.value); break;
+        case Term::genre: matches = trackStore.findWordPrefix(TrackStore::genreColumn, term.value); break;
+        case Term::bpm: matches = lookupRange(TrackStore::bpmColumn, term.min, term.max); break;
+        case Term::duration: matches = lookupRange(TrackStore::durationColumn, term.min, term.max); break;
+        case Term::key: matches = lookupRange(TrackStore::keyColumn, term.min, term.max); break;
+        default: break;
+    }
+
+    return termCache[term.source] = std::move(matches);
+}
+
+std::vector<int> TrackQuery::lookupRange(int column, double min, double max)
+{
+    auto valueOf = [this, column](int index) -> double {
+        switch (column) {
+            case TrackStore::bpmColumn: return trackStore.getBpm(index);
+            case TrackStore::durationColumn: return trackStore.getDuration(index);
+            default: return trackStore.getKey(index);
+        }
+    };
+
+    // The sorted column turns a range into one contiguous slice
+    const auto& sorted = trackStore.getSortedIndices(column);
+    auto first = std::lower_bound(sorted.begin(), sorted.end(), min, [&](int index, double value) { return valueOf(index) < value; });
+    auto last = std::upper_bound(first, sorted.end(), max, [&](double value, int index) { return value < valueOf(index); });
+
+    std::vector<int> matches(first, last);
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+void TrackQuery::orderResults(std::vector<int>& rows, int sortColumn, bool sortForwards)
+{
+    // Store indices are already in insertion order
+    if (sortColumn == 0)
+        return;
+
+    // Everything matched - the precomputed permutation is the answer
+    if ((int)rows.size() == trackStore.getNumTracks()) {
+        rows = trackStore.getSortedIndices(sortColumn);
+        if (!sortForwards)
+            std::reverse(rows.begin(), rows.end());
+        return;
+    }
+
+    const auto& ranks = trackStore.getSortRanks(sortColumn);
+    std::sort(rows.begin(), rows.end(), [&ranks, sortForwards](int a, int b) {
+        return sortForwards ? ranks[(size_t)a] < ranks[(size_t)b] : ranks[(size_t)a] > ranks[(size_t)b];
+    });
+}
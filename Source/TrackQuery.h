@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    TrackQuery.h
+
+    ### Query engine over the TrackStore ###
+
+    Query syntax, all terms must match:
+    - bpm:120-128   bpm:>120   bpm:<128   bpm:124
+    - dur:<6:00     dur:3:00-5:00          (m:ss or seconds)
+    - key:Am
+    - artist:foo    title:foo              (word prefix match)
+    - album:foo     genre:foo
+    - anything else is a substring match on title and artist
+
+    - Field terms use the store's word index and sorted columns, so compound
+      queries only touch matching tracks
+    - Results per term are cached, so typing only re-evaluates the last term
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackStore.h"
+
+class TrackQuery {
+    public:
+        TrackQuery(TrackStore& trackStoreToUse);
+
+        // Store indices matching the query, ordered by sortColumn (0 = insertion order)
+        const std::vector<int>& evaluate(const String& queryText, int sortColumn, bool sortForwards);
+
+    private:
+        struct Term {
+            enum Type { text, title, artist, album, genre, bpm, duration, key } type = text;
+            String source; // term as typed, used as the cache key
+            std::string value; // lowercase text for text and word terms
+            double min = 0.0, max = 0.0; // inclusive range for bpm/duration/key
+        };
+
+        static Array<Term> parse(const String& queryText);
+        static bool parseRange(const String& value, bool isDuration, double& min, double& max);
+        static double parseNumber(const String& value, bool isDuration);
+
+        // Sorted store indices for an indexed (non-text) term
+        const std::vector<int>& lookup(const Term& term);
+        std::vector<int> lookupRange(int column, double min, double max);
+
+        void orderResults(std::vector<int>& rows, int sortColumn, bool sortForwards);
+
+        TrackStore& trackStore;
+
+        std::map<String, std::vector<int>> termCache; // indexed term -> matching tracks
+        int cachedGeneration = -1;
+
+        std::vector<int> result;
+        String lastQuery; // query the result was built from
+        int lastSortColumn = 0;
+        bool lastSortForwards = true;
+};
@@ -0,0 +1,720 @@
+/*
+  ==============================================================================
+
+    TrackStore.cpp
+
+  ==============================================================================
+*/
+
+#include "TrackStore.h"
+#include <unordered_set>
+
+TrackStore::TrackStore()
+{
+    formatManager.registerBasicFormats();
+    analysisQueue.onAnalysisComplete = [this](const AnalysisResult& result) { analysisFinished(result); };
+
+    scanner = std::make_unique<LibraryScanner>(formatManager.getWildcardForAllFormats());
+    scanner->onScanComplete = [this](const LibraryScanner::Result& result) { scanFinished(result); };
+
+    loadLibrary();
+
+    // Let the scanner check every library file on its first pass
+    Array<File> files;
+    for (int i = 0; i < size(); ++i) {
+        URL url = getURL(i);
+        if (url.isLocalFile())
+            files.add(url.getLocalFile());
+    }
+    scanner->addFiles(files);
+    scanner->rescan();
+}
+
+TrackStore::~TrackStore()
+{
+    // Flush a pending deferred save
+    if (isTimerRunning())
+        saveLibrary();
+}
+
+void TrackStore::addListener(Listener* listener)
+{
+    listeners.add(listener);
+}
+
+void TrackStore::removeListener(Listener* listener)
+{
+    listeners.remove(listener);
+}
+
+int TrackStore::size() const
+{
+    return (int)titles.size();
+}
+
+int TrackStore::getNumTracks() const
+{
+    return size() - numRemoved;
+}
+
+bool TrackStore::isRemoved(int index) const
+{
+    return (flags[(size_t)index] & removedFlag) != 0;
+}
+
+uint32 TrackStore::getId(int index) const
+{
+    return ids[(size_t)index];
+}
+
+int TrackStore::findId(uint32 id) const
+{
+    return id < idIndex.size() ? idIndex[id] : -1;
+}
+
+TrackStore::MemoryStats TrackStore::getMemoryStats() const
+{
+    MemoryStats stats;
+    stats.numTracks = getNumTracks();
+    stats.numRemoved = numRemoved;
+
+    auto capacityBytes = [](const auto& column) { return (int64)(column.capacity() * sizeof(column[0])); };
+    stats.columnBytes = capacityBytes(titles) + capacityBytes(artists) + capacityBytes(albums) + capacityBytes(genres)
+        + capacityBytes(durations) + capacityBytes(bpms) + capacityBytes(downbeats) + capacityBytes(keys) + capacityBytes(paths)
+        + capacityBytes(searchIndex) + capacityBytes(ids) + capacityBytes(flags);
+
+    // String text is counted once per allocation, pooled strings share theirs
+    const int64 stringOverhead = 2 * sizeof(void*);
+    for (auto& title : titles)
+        stats.textBytes += (int64)title.getNumBytesAsUTF8() + 1 + stringOverhead;
+    std::unordered_set<const void*> pooled;
+    for (auto* column : { &artists, &albums, &genres }) {
+        for (auto& text : *column) {
+            if (pooled.insert(text.getCharPointer().getAddress()).second)
+                stats.textBytes += (int64)text.getNumBytesAsUTF8() + 1 + stringOverhead;
+        }
+    }
+    stats.numPooledStrings = (int)pooled.size();
+    stats.textBytes += (int64)(pathArena.capacity() + searchArena.capacity());
+
+    for (auto& entry : hotCues)
+        stats.columnBytes += (int64)(sizeof(entry) + entry.second.size() * sizeof(double));
+
+    stats.indexBytes = (int64)(pathIndex.size() * (sizeof(std::pair<int64, int>) + 2 * sizeof(void*)) + pathIndex.bucket_count() * sizeof(void*))
+        + capacityBytes(idIndex);
+    return stats;
+}
+
+const String& TrackStore::getTitle(int index) const
+{
+    return titles[(size_t)index];
+}
+
+const String& TrackStore::getArtist(int index) const
+{
+    return artists[(size_t)index];
+}
+
+const String& TrackStore::getAlbum(int index) const
+{
+    return albums[(size_t)index];
+}
+
+const String& TrackStore::getGenre(int index) const
+{
+    return genres[(size_t)index];
+}
+
+int TrackStore::getDuration(int index) const
+{
+    return durations[(size_t)index];
+}
+
+double TrackStore::getBpm(int index) const
+{
+    return bpms[(size_t)index];
+}
+
+double TrackStore::getDownbeat(int index) const
+{
+    return downbeats[(size_t)index];
+}
+
+int TrackStore::getKey(int index) const
+{
+    return keys[(size_t)index];
+}
+
+URL TrackStore::getURL(int index) const
+{
+    std::string_view path = viewText(pathArena, paths[(size_t)index]);
+    return URL(String::fromUTF8(path.data(), (int)path.size()));
+}
+
+const Array<double>& TrackStore::getHotCues(int index) const
+{
+    static const Array<double> noCues;
+    auto found = hotCues.find(ids[(size_t)index]);
+    return found != hotCues.end() ? found->second : noCues;
+}
+
+void TrackStore::setHotCue(int index, int slot, double seconds)
+{
+    if (index < 0 || index >= size() || isRemoved(index) || slot < 0)
+        return;
+
+    auto& cues = hotCues[ids[(size_t)index]];
+    while (cues.size() <= slot)
+        cues.add(-1.0);
+    cues.set(slot, seconds < 0.0 ? -1.0 : seconds);
+
+    // Cues do not affect sorting or search, only the saved file
+    startTimer(1000);
+}
+
+bool TrackStore::isOffline(int index) const
+{
+    return (flags[(size_t)index] & offlineFlag) != 0;
+}
+
+void TrackStore::setOffline(int index, bool isOffline)
+{
+    if (index < 0 || index >= size() || TrackStore::isOffline(index) == isOffline)
+        return;
+
+    flags[(size_t)index] ^= offlineFlag;
+    valuesChanged(index, 0);
+}
+
+std::string_view TrackStore::getSearchText(int index) const
+{
+    return viewText(searchArena, searchIndex[(size_t)index]);
+}
+
+const std::vector<int>& TrackStore::getSortedIndices(int column)
+{
+    // Build the permutation once, it stays valid until the next change
+    auto found = sortedIndices.find(column);
+    if (found != sortedIndices.end())
+        return found->second;
+
+    auto& indices = sortedIndices[column];
+    indices.reserve((size_t)getNumTracks());
+    for (int i = 0; i < size(); ++i) {
+        if (!isRemoved(i))
+            indices.push_back(i);
+    }
+
+    auto sortBy = [&indices](auto less) { std::stable_sort(indices.begin(), indices.end(), less); };
+
+    switch (column) {
+        case 0: break;
+        case durationColumn: sortBy([this](int a, int b) { return durations[(size_t)a] < durations[(size_t)b]; }); break;
+        case bpmColumn: sortBy([this](int a, int b) { return bpms[(size_t)a] < bpms[(size_t)b]; }); break;
+        case keyColumn: sortBy([this](int a, int b) { return keys[(size_t)a] < keys[(size_t)b]; }); break;
+        default: sortBy([this, column](int a, int b) { return getText(column, a).compareNatural(getText(column, b)) < 0; }); break;
+    }
+
+    return indices;
+}
+
+const std::vector<int>& TrackStore::getSortRanks(int column)
+{
+    auto& ranks = sortRanks[column];
+
+    if (ranks.size() != titles.size())
+    {
+        // Removed rows keep rank -1, they never appear in query results
+        const auto& sorted = getSortedIndices(column);
+        ranks.assign(titles.size(), -1);
+        for (size_t i = 0; i < sorted.size(); ++i)
+            ranks[(size_t)sorted[i]] = (int)i;
+    }
+
+    return ranks;
+}
+
+std::vector<int> TrackStore::findWordPrefix(int column, const std::string& prefix)
+{
+    const auto& words = getWordIndex(column);
+    std::vector<int> result;
+
+    // Words sharing the prefix are adjacent in the sorted index
+    auto it = std::lower_bound(words.begin(), words.end(), prefix,
+        [](const std::pair<std::string, std::vector<int>>& entry, const std::string& value) { return entry.first < value; });
+
+    for (; it != words.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+        result.insert(result.end(), it->second.begin(), it->second.end());
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int TrackStore::getGeneration() const
+{
+    return generation;
+}
+
+const TrackStore::WordIndex& TrackStore::getWordIndex(int column)
+{
+    auto found = wordIndices.find(column);
+    if (found != wordIndices.end())
+        return found->second;
+
+    // Split each lowercase text into words and collect the tracks per word
+    std::map<std::string, std::vector<int>> postings;
+    // Non-ASCII bytes count as word characters so UTF-8 words stay whole
+    auto isWordChar = [](unsigned char c) { return c >= 0x80 || std::isalnum(c); };
+
+    for (int i = 0; i < size(); ++i)
+    {
+        if (isRemoved(i))
+            continue;
+
+        std::string lower = getText(column, i).toLowerCase().toStdString();
+
+        size_t start = 0;
+        while (start < lower.size())
+        {
+            while (start < lower.size() && !isWordChar((unsigned char)lower[start]))
+                ++start;
+            size_t end = start;
+            while (end < lower.size() && isWordChar((unsigned char)lower[end]))
+                ++end;
+
+            if (end > start) {
+                auto& tracksForWord = postings[lower.substr(start, end - start)];
+                if (tracksForWord.empty() || tracksForWord.back() != i)
+                    tracksForWord.push_back(i);
+            }
+            start = end;
+        }
+    }
+
+    auto& words = wordIndices[column];
+    words.reserve(postings.size());
+    for (auto& entry : postings)
+        words.emplace_back(entry.first, std::move(entry.second));
+
+    return words;
+}
+
+void TrackStore::addTrack(const File& f)
+{
+    // Each file is only listed once
+    if (findTrack(URL{ f }) >= 0)
+        return;
+
+    // Tags and duration come straight from the file headers
+    TrackMetadata metadata;
+    if (!MetadataScanner::scan(f, metadata)) {
+        // Unknown container - fall back to a full reader
+        if (auto* reader = formatManager.createReaderFor(f)) {
+            metadata.durationSeconds = reader->lengthInSamples / reader->sampleRate;
+            metadata.artist = reader->metadataValues.getValue("artist", reader->metadataValues["ID3:TPE1"]);
+            delete reader;
+        }
+    }
+
+    addTrack(makeTrack(f, metadata));
+    scanner->addFiles({ f });
+
+    // BPM and key are filled in once the background analysis is done
+    analysisQueue.addJob(f);
+}
+
+void TrackStore::addTrack(const Track& t)
+{
+    // Keep the saved id unless another track already has it, or it is out of all
+    // proportion to the library (a damaged or hand-edited file)
+    const uint32 idLimit = (uint32)(size() + 1) * 4 + 65536;
+    uint32 id = t.id != 0 && t.id <= idLimit && findId(t.id) < 0 ? t.id : nextId;
+    nextId = jmax(nextId, id + 1);
+    if (idIndex.size() <= id)
+        idIndex.resize((size_t)id + 1, -1);
+    idIndex[id] = size();
+
+    String url = t.fileURL.toString(false);
+    pathIndex.emplace(url.hashCode64(), size());
+
+    titles.push_back(t.title);
+    artists.push_back(stringPool.getPooledString(t.artist));
+    albums.push_back(stringPool.getPooledString(t.album));
+    genres.push_back(stringPool.getPooledString(t.genre));
+    durations.push_back(t.duration);
+    bpms.push_back(t.bpm);
+    downbeats.push_back(t.downbeat);
+    keys.push_back(t.key);
+    paths.push_back(appendText(pathArena, url.toStdString()));
+    searchIndex.push_back(appendText(searchArena, (t.title + " " + t.artist).toLowerCase().toStdString()));
+    ids.push_back(id);
+    flags.push_back(0);
+
+    if (!t.hotCues.isEmpty())
+        hotCues[id] = t.hotCues;
+
+    contentsChanged();
+}
+
+void TrackStore::removeTrack(int index)
+{
+    if (index < 0 || index >= size() || isRemoved(index))
+        return;
+
+    // Tombstone - nothing shifts, ids and the other indices stay valid
+    flags[(size_t)index] |= removedFlag;
+    ++numRemoved;
+    idIndex[ids[(size_t)index]] = -1;
+    hotCues.erase(ids[(size_t)index]);
+
+    std::string_view path = viewText(pathArena, paths[(size_t)index]);
+    auto range = pathIndex.equal_range(String::fromUTF8(path.data(), (int)path.size()).hashCode64());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == index) {
+            pathIndex.erase(it);
+            break;
+        }
+    }
+
+    if (numRemoved * 2 >= size())
+        compact();
+
+    contentsChanged();
+}
+
+int TrackStore::findTrack(const URL& url)
+{
+    String text = url.toString(false);
+    std::string wanted = text.toStdString();
+
+    // Hashes can collide, the arena holds the real path
+    auto range = pathIndex.equal_range(text.hashCode64());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (viewText(pathArena, paths[(size_t)it->second]) == wanted)
+            return it->second;
+    }
+    return -1;
+}
+
+void TrackStore::addWatchFolder(const File& folder)
+{
+    scanner->addWatchFolder(folder);
+}
+
+void TrackStore::removeWatchFolder(const File& folder)
+{
+    scanner->removeWatchFolder(folder);
+}
+
+Array<File> TrackStore::getWatchFolders() const
+{
+    return scanner->getWatchFolders();
+}
+
+void TrackStore::rescan()
+{
+    scanner->rescan();
+}
+
+void TrackStore::saveLibrary()
+{
+    stopTimer();
+
+    var libraryJson;
+    // Iterate through the tracks
+    for (int i = 0; i < size(); ++i)
+    {
+        // Create new object to save to the JSON
+        if (isRemoved(i))
+            continue;
+
+        DynamicObject* obj = new DynamicObject();
+        obj->setProperty("id", (int)ids[(size_t)i]);
+        obj->setProperty("title", titles[(size_t)i]);
+        obj->setProperty("duration", durations[(size_t)i]);
+        obj->setProperty("artist", artists[(size_t)i]);
+        obj->setProperty("url", getURL(i).toString(false));
+        obj->setProperty("album", albums[(size_t)i]);
+        obj->setProperty("genre", genres[(size_t)i]);
+        obj->setProperty("bpm", bpms[(size_t)i]);
+        obj->setProperty("downbeat", downbeats[(size_t)i]);
+        obj->setProperty("key", keys[(size_t)i]);
+        if (!getHotCues(i).isEmpty()) {
+            var cues;
+            for (double cue : getHotCues(i))
+                cues.append(cue);
+            obj->setProperty("cues", cues);
+        }
+        libraryJson.append(var(obj));
+    }
+    // Find the file or create one
+    File f = File::getCurrentWorkingDirectory().getChildFile("library.json");
+    // Save data from object to the file
+    String jsonString = JSON::toString(libraryJson);
+    f.replaceWithText(jsonString);
+}
+
+void TrackStore::loadLibrary()
+{
+    File f = File::getCurrentWorkingDirectory().getChildFile("library.json");
+
+    if (f.existsAsFile())
+    {
+        var library = JSON::parse(f);
+
+        if (library.isArray())
+        {
+            // Iterate through all items
+            for (auto& item : *library.getArray())
+            {
+                // Create obj variable to hold item's data and check if it is ok
+                if (auto* obj = item.getDynamicObject())
+                {
+                    Track t;
+                    t.id = (uint32)(int)obj->getProperty("id");
+                    t.title = obj->getProperty("title").toString();
+                    t.duration = (int)obj->getProperty("duration");
+                    t.artist = obj->getProperty("artist");
+                    t.fileURL = URL(obj->getProperty("url").toString());
+                    t.album = obj->getProperty("album").toString();
+                    t.genre = obj->getProperty("genre").toString();
+                    t.bpm = obj->getProperty("bpm");
+                    t.downbeat = obj->getProperty("downbeat");
+                    t.key = obj->hasProperty("key") ? (int)obj->getProperty("key") : -1;
+                    if (auto* cues = obj->getProperty("cues").getArray()) {
+                        for (auto& cue : *cues)
+                            t.hotCues.add((double)cue);
+                    }
+                    addTrack(t);
+
+                    // Entries saved before key or downbeat detection existed still need analysing
+                    if ((!obj->hasProperty("key") || !obj->hasProperty("downbeat")) && t.fileURL.isLocalFile())
+                        analysisQueue.addJob(t.fileURL.getLocalFile());
+                }
+            }
+        }
+    }
+
+    // Nothing to write back yet
+    stopTimer();
+}
+
+void TrackStore::timerCallback()
+{
+    saveLibrary();
+}
+
+void TrackStore::analysisFinished(const AnalysisResult& result)
+{
+    int index = findTrack(URL{ result.file });
+    if (index < 0)
+        return;
+
+    bpms[(size_t)index] = result.bpm;
+    downbeats[(size_t)index] = result.downbeat;
+    keys[(size_t)index] = result.key;
+    int columns = (1 << bpmColumn) | (1 << keyColumn);
+
+    // Only fills in what the tag scan could not find
+    if (durations[(size_t)index] == 0) {
+        durations[(size_t)index] = result.duration;
+        columns |= 1 << durationColumn;
+    }
+    if (result.artist.isNotEmpty() && artists[(size_t)index] == "Unknown Artist") {
+        artists[(size_t)index] = stringPool.getPooledString(result.artist);
+        updateSearchText(index);
+        columns |= 1 << artistColumn;
+    }
+
+    valuesChanged(index, columns);
+}
+
+void TrackStore::scanFinished(const LibraryScanner::Result& result)
+{
+    for (int i = 0; i < result.newOrChanged.size(); ++i)
+    {
+        const File& file = result.newOrChanged.getReference(i);
+        const TrackMetadata& metadata = result.metadata.getReference(i);
+
+        // New files are listed straight away with their tags, the analysis adds BPM and key
+        int index = findTrack(URL{ file });
+        if (index < 0)
+            addTrack(makeTrack(file, metadata));
+        else
+            updateMetadata(index, metadata);
+
+        analysisQueue.addJob(file);
+    }
+
+    for (auto& file : result.missing)
+        setOffline(findTrack(URL{ file }), true);
+
+    for (auto& file : result.restored)
+        setOffline(findTrack(URL{ file }), false);
+}
+
+Track TrackStore::makeTrack(const File& f, const TrackMetadata& metadata)
+{
+    Track t;
+    t.title = metadata.title.isNotEmpty() ? metadata.title : f.getFileName();
+    t.duration = static_cast<int>(metadata.durationSeconds);
+    t.artist = metadata.artist.isNotEmpty() ? metadata.artist : "Unknown Artist";
+    t.album = metadata.album;
+    t.genre = metadata.genre;
+    t.fileURL = URL{ f };
+    return t;
+}
+
+void TrackStore::updateMetadata(int index, const TrackMetadata& metadata)
+{
+    // Re-tagged file, keep the old values for anything the new tags leave out
+    if (metadata.title.isNotEmpty()) titles[(size_t)index] = metadata.title;
+    if (metadata.artist.isNotEmpty()) artists[(size_t)index] = stringPool.getPooledString(metadata.artist);
+    if (metadata.album.isNotEmpty()) albums[(size_t)index] = stringPool.getPooledString(metadata.album);
+    if (metadata.genre.isNotEmpty()) genres[(size_t)index] = stringPool.getPooledString(metadata.genre);
+    if (metadata.durationSeconds > 0.0) durations[(size_t)index] = static_cast<int>(metadata.durationSeconds);
+
+    updateSearchText(index);
+    contentsChanged();
+}
+
+void TrackStore::updateSearchText(int index)
+{
+    std::string text = (titles[(size_t)index] + " " + artists[(size_t)index]).toLowerCase().toStdString();
+    TextRef& ref = searchIndex[(size_t)index];
+
+    // Overwritten in place when it fits, otherwise the old text is dead until the arena is compacted
+    if (text.size() <= ref.length) {
+        std::copy(text.begin(), text.end(), searchArena.begin() + ref.offset);
+        deadSearchBytes += ref.length - text.size();
+        ref.length = (uint32)text.size();
+    }
+    else {
+        deadSearchBytes += ref.length;
+        ref = appendText(searchArena, text);
+    }
+
+    if (deadSearchBytes * 2 > searchArena.size())
+        compactSearchText();
+}
+
+void TrackStore::compactSearchText()
+{
+    // Same order as the rows, only the search arena is rewritten
+    std::vector<char> newSearch;
+    newSearch.reserve(searchArena.size() - deadSearchBytes);
+    for (auto& ref : searchIndex)
+        ref = appendText(newSearch, std::string(viewText(searchArena, ref)));
+
+    searchArena.swap(newSearch);
+    deadSearchBytes = 0;
+}
+
+const String& TrackStore::getText(int column, int index) const
+{
+    switch (column) {
+        case artistColumn: return artists[(size_t)index];
+        case albumColumn: return albums[(size_t)index];
+        case genreColumn: return genres[(size_t)index];
+        default: return titles[(size_t)index];
+    }
+}
+
+void TrackStore::compact()
+{
+    // Copy the live rows down over the tombstones, in order
+    std::vector<char> newPaths, newSearch;
+    newPaths.reserve(pathArena.size());
+    newSearch.reserve(searchArena.size());
+    pathIndex.clear();
+
+    size_t live = 0;
+    for (size_t i = 0; i < titles.size(); ++i)
+    {
+        if ((flags[i] & removedFlag) != 0)
+            continue;
+
+        std::string_view path = viewText(pathArena, paths[i]);
+        std::string_view search = viewText(searchArena, searchIndex[i]);
+
+        titles[live] = titles[i];
+        artists[live] = artists[i];
+        albums[live] = albums[i];
+        genres[live] = genres[i];
+        durations[live] = durations[i];
+        bpms[live] = bpms[i];
+        downbeats[live] = downbeats[i];
+        keys[live] = keys[i];
+        paths[live] = appendText(newPaths, std::string(path));
+        searchIndex[live] = appendText(newSearch, std::string(search));
+        ids[live] = ids[i];
+        flags[live] = flags[i];
+
+        idIndex[ids[live]] = (int)live;
+        pathIndex.emplace(String::fromUTF8(path.data(), (int)path.size()).hashCode64(), (int)live);
+        ++live;
+    }
+
+    auto shrink = [live](auto& column) { column.resize(live); column.shrink_to_fit(); };
+    shrink(titles); shrink(artists); shrink(albums); shrink(genres);
+    shrink(durations); shrink(bpms); shrink(downbeats); shrink(keys); shrink(paths);
+    shrink(searchIndex); shrink(ids); shrink(flags);
+
+    newPaths.shrink_to_fit();
+    newSearch.shrink_to_fit();
+    pathArena.swap(newPaths);
+    searchArena.swap(newSearch);
+    deadSearchBytes = 0;
+    numRemoved = 0;
+
+    // Drop pooled strings nothing refers to any more
+    stringPool.garbageCollect();
+}
+
+TrackStore::TextRef TrackStore::appendText(std::vector<char>& arena, const std::string& text)
+{
+    TextRef ref;
+    ref.offset = (uint32)arena.size();
+    ref.length = (uint32)text.size();
+    arena.insert(arena.end(), text.begin(), text.end());
+    return ref;
+}
+
+std::string_view TrackStore::viewText(const std::vector<char>& arena, TextRef ref)
+{
+    return std::string_view(arena.data() + ref.offset, ref.length);
+}
+
+void TrackStore::contentsChanged()
+{
+    sortedIndices.clear();
+    sortRanks.clear();
+    wordIndices.clear();
+    ++generation;
+    sendChangeMessage();
+
+    // Batch writes to library.json, bulk imports would otherwise rewrite it per track
+    startTimer(1000);
+}
+
+void TrackStore::valuesChanged(int index, int columns)
+{
+    // Only the cached orderings of the changed columns go stale
+    for (int column : { titleColumn, durationColumn, bpmColumn, artistColumn, keyColumn, albumColumn, genreColumn })
+    {
+        if ((columns & (1 << column)) != 0) {
+            sortedIndices.erase(column);
+            sortRanks.erase(column);
+            wordIndices.erase(column);
+        }
+    }
+
+    if (columns != 0) {
+        ++generation;
+        startTimer(1000);
+    }
+
+    uint32 id = ids[(size_t)index];
+    listeners.call([id, columns](Listener& l) { l.trackUpdated(id, columns); });
+}
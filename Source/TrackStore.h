@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    TrackStore.h
+
+    ### Shared, column-oriented store of all library tracks ###
+
+    - One vector per column so sorting and searching only touch what they need
+    - Artists, albums and genres are interned in a StringPool, paths and
+      search text are packed into two byte arenas; changed search text is
+      rewritten in place when it fits, the arena is compacted once half of
+      it is dead
+    - Every track has a stable id; removed tracks are tombstoned and the
+      columns are compacted once tombstones make up half of them
+    - Precomputed sort permutations per column, rebuilt only after changes
+    - Lowercase "title artist" index used for substring search
+    - Inverted word index over titles, artists, albums and genres for field queries
+    - New tracks get their tags from MetadataScanner, no decoder needed
+    - Owns the background AnalysisQueue and the library.json persistence
+    - Owns the LibraryScanner; files it finds missing are marked offline
+    - Broadcasts a change message when tracks are added or removed; values
+      changed in place (analysis results, offline state) go to Listeners
+      with the track id, so views can repaint just that row
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AnalysisQueue.h"
+#include "LibraryScanner.h"
+#include "MetadataScanner.h"
+#include <string_view>
+
+struct Track {
+    String title;
+    int duration;
+    String artist;
+    URL fileURL;
+    String album;
+    String genre;
+    double bpm = 0.0;
+    double downbeat = 0.0; // seconds to the first bar line
+    int key = -1; // KeyDetector index, -1 until analysed
+    Array<double> hotCues; // seconds per cue slot, -1 for an empty slot
+    uint32 id = 0; // 0 lets the store pick one
+};
+
+class TrackStore : public ChangeBroadcaster,
+    private Timer
+{
+    public:
+        // Sortable columns, the values match the library table column ids
+        enum Column { titleColumn = 1, durationColumn = 2, bpmColumn = 3, artistColumn = 4, keyColumn = 7, albumColumn = 8, genreColumn = 9 };
+
+        class Listener {
+            public:
+                virtual ~Listener() = default;
+                // Called on the message thread when one track changed in place. columns is a
+                // mask of (1 << Column) for the changed values, 0 for display-only changes
+                virtual void trackUpdated(uint32 id, int columns) = 0;
+        };
+
+        void addListener(Listener* listener);
+        void removeListener(Listener* listener);
+
+        TrackStore();
+        ~TrackStore() override;
+
+        // Number of rows, including removed ones - valid indices are 0..size()-1
+        int size() const;
+        // Tracks that are not removed
+        int getNumTracks() const;
+        bool isRemoved(int index) const;
+
+        // Stable track ids, they survive removals, compaction and restarts
+        uint32 getId(int index) const;
+        int findId(uint32 id) const; // -1 if unknown or removed
+
+        struct MemoryStats {
+            int numTracks = 0;
+            int numRemoved = 0;
+            int numPooledStrings = 0;
+            int64 columnBytes = 0; // fixed-size per-track data
+            int64 textBytes = 0; // titles, pooled strings and both arenas
+            int64 indexBytes = 0; // path lookup and id table
+            int64 getTotalBytes() const { return columnBytes + textBytes + indexBytes; }
+        };
+        MemoryStats getMemoryStats() const;
+
+        const String& getTitle(int index) const;
+        const String& getArtist(int index) const;
+        const String& getAlbum(int index) const;
+        const String& getGenre(int index) const;
+        int getDuration(int index) const;
+        double getBpm(int index) const;
+        double getDownbeat(int index) const; // seconds to the first bar line
+        int getKey(int index) const;
+        URL getURL(int index) const;
+
+        // Hot cue positions in seconds, a negative position clears the slot
+        const Array<double>& getHotCues(int index) const;
+        void setHotCue(int index, int slot, double seconds);
+
+        // Offline tracks point to files that are currently missing
+        bool isOffline(int index) const;
+        void setOffline(int index, bool isOffline);
+
+        // Lowercase "title artist" text, used for substring search
+        std::string_view getSearchText(int index) const;
+
+        // Store indices of live tracks ordered by the given column (ascending, 0 = insertion order)
+        const std::vector<int>& getSortedIndices(int column);
+
+        // Position of every store index within getSortedIndices(column)
+        const std::vector<int>& getSortRanks(int column);
+
+        // Sorted store indices of tracks with a title/artist/album/genre word starting with prefix
+        std::vector<int> findWordPrefix(int column, const std::string& prefix);
+
+        // Incremented on every change, lets views know their cached results are stale
+        int getGeneration() const;
+
+        // Library controls - add, remove, save, load
+        void addTrack(const File& f);
+        void addTrack(const Track& t);
+        void removeTrack(int index);
+        int findTrack(const URL& url);
+        void saveLibrary();
+        void loadLibrary();
+
+        // Watch folders, new files in them are added automatically
+        void addWatchFolder(const File& folder);
+        void removeWatchFolder(const File& folder);
+        Array<File> getWatchFolders() const;
+        void rescan();
+
+    private:
+        void timerCallback() override;
+        void analysisFinished(const AnalysisResult& result);
+        void scanFinished(const LibraryScanner::Result& result);
+        void contentsChanged();
+        void valuesChanged(int index, int columns);
+
+        static Track makeTrack(const File& f, const TrackMetadata& metadata);
+        void updateMetadata(int index, const TrackMetadata& metadata);
+        void updateSearchText(int index);
+        const String& getText(int column, int index) const;
+        void compact();
+        void compactSearchText();
+
+        // Packed text, referenced by offset and length
+        struct TextRef {
+            uint32 offset = 0;
+            uint32 length = 0;
+        };
+        static TextRef appendText(std::vector<char>& arena, const std::string& text);
+        static std::string_view viewText(const std::vector<char>& arena, TextRef ref);
+
+        // Lowercase word -> sorted store indices, ordered by word
+        typedef std::vector<std::pair<std::string, std::vector<int>>> WordIndex;
+        const WordIndex& getWordIndex(int column);
+
+        AudioFormatManager formatManager;
+
+        // Track columns, all of the same length
+        std::vector<String> titles;
+        std::vector<String> artists; // pooled
+        std::vector<String> albums; // pooled
+        std::vector<String> genres; // pooled
+        std::vector<int> durations;
+        std::vector<double> bpms;
+        std::vector<double> downbeats;
+        std::vector<int> keys;
+        std::vector<TextRef> paths; // URL strings in pathArena
+        std::vector<TextRef> searchIndex; // lowercase "title artist" in searchArena
+        std::vector<uint32> ids;
+        std::vector<uint8> flags;
+
+        enum { offlineFlag = 1, removedFlag = 2 };
+
+        StringPool stringPool;
+        std::vector<char> pathArena;
+        std::vector<char> searchArena;
+        size_t deadSearchBytes = 0; // replaced text that did not fit in place
+        int numRemoved = 0;
+
+        // Only the few tracks with cues have an entry
+        std::unordered_map<uint32, Array<double>> hotCues;
+
+        // Hash of the URL string -> store indices, compared against the arena on lookup
+        std::unordered_multimap<int64, int> pathIndex;
+
+        // Track id -> store index, -1 for removed ids. Sized by the largest id,
+        // so ids far above the track count are not taken from the saved file
+        std::vector<int> idIndex;
+        uint32 nextId = 1;
+
+        // Cached sort permutations, cleared whenever the columns change
+        std::map<int, std::vector<int>> sortedIndices;
+        std::map<int, std::vector<int>> sortRanks;
+        std::map<int, WordIndex> wordIndices;
+        int generation = 0;
+
+        ListenerList<Listener> listeners;
+
+        AnalysisQueue analysisQueue; // background BPM and key analysis
+        std::unique_ptr<LibraryScanner> scanner; // created once the formats are registered
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackStore)
+};
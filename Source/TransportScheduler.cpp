@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    TransportScheduler.cpp
+
+  ==============================================================================
+*/
+
+#include "TransportScheduler.h"
+#include "DJAudioPlayer.h"
+
+TransportScheduler::TransportScheduler()
+{
+
+}
+
+bool TransportScheduler::schedule(const Event& event)
+{
+    const SpinLock::ScopedLockType sl(writeLock);
+    if (fifo.getFreeSpace() < 1)
+        return false;
+
+    // The audio at a jump target is decoded now, the event then only switches to it
+    if (event.type == positionEvent && event.player != nullptr)
+        event.player->prepareScheduledPosition(event.value);
+
+    const auto scope = fifo.write(1);
+    incoming[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2] = event;
+    return true;
+}
+
+int64 TransportScheduler::getSampleTime() const
+{
+    return sampleTime.load();
+}
+
+int64 TransportScheduler::getSampleTime(const std::function<void()>& readState) const
+{
+    while (true)
+    {
+        uint32 before = renderCount.load(std::memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            int64 time = sampleTime.load(std::memory_order_acquire);
+            readState();
+            if (renderCount.load(std::memory_order_acquire) == before)
+                return time;
+        }
+        Thread::yield();
+    }
+}
+
+double TransportScheduler::getSampleRate() const
+{
+    return currentSampleRate.load();
+}
+
+void TransportScheduler::prepareToPlay(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+}
+
+void TransportScheduler::process(AudioSource& source, const AudioSourceChannelInfo& block)
+{
+    renderCount.fetch_add(1, std::memory_order_acq_rel);
+    collectNewEvents();
+
+    int64 blockStart = sampleTime.load(std::memory_order_relaxed);
+    int done = 0;
+    int next = 0;
+
+    while (done < block.numSamples)
+    {
+        // Everything due at this sample, including late events
+        while (next < numPending && pending[next].sampleTime <= blockStart + done)
+            apply(pending[next++]);
+
+        // Render up to the next event or the end of the block
+        int end = block.numSamples;
+        if (next < numPending)
+            end = (int)jmin((int64)block.numSamples, pending[next].sampleTime - blockStart);
+
+        AudioSourceChannelInfo segment(block.buffer, block.startSample + done, end - done);
+        source.getNextAudioBlock(segment);
+        done = end;
+    }
+
+    // Drop what was applied
+    if (next > 0) {
+        std::move(pending + next, pending + numPending, pending);
+        numPending -= next;
+    }
+
+    sampleTime.store(blockStart + block.numSamples, std::memory_order_release);
+    renderCount.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void TransportScheduler::collectNewEvents()
+{
+    int numReady = fifo.getNumReady();
+    if (numReady == 0)
+        return;
+
+    const auto scope = fifo.read(numReady);
+    auto insert = [this](const Event& event)
+    {
+        // Full queue drops the newest event
+        if (numPending == maxEvents)
+            return;
+
+        // Insertion keeps the order, events with equal times stay in the order they were scheduled
+        int i = numPending++;
+        while (i > 0 && pending[i - 1].sampleTime > event.sampleTime) {
+            pending[i] = pending[i - 1];
+            --i;
+        }
+        pending[i] = event;
+    };
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        insert(incoming[scope.startIndex1 + i]);
+    for (int i = 0; i < scope.blockSize2; ++i)
+        insert(incoming[scope.startIndex2 + i]);
+}
+
+void TransportScheduler::apply(const Event& event)
+{
+    if (event.player == nullptr)
+        return;
+
+    // Flags and RAM only - no transport calls, locks or change messages on the audio thread
+    switch (event.type)
+    {
+        case startEvent: event.player->startNow(); break;
+        case stopEvent: event.player->stop(); break;
+        case positionEvent: event.player->jumpToScheduledPosition(); break;
+        case gainEvent: event.player->setGainNow(event.value); break;
+        case speedEvent: event.player->setSpeedNow(event.value); break;
+    }
+}
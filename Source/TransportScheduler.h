@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    TransportScheduler.h
+
+    ### Sample-accurate transport and parameter events ###
+
+    - One audio clock: the number of samples rendered since the device started
+    - Events (start, stop, position, gain, speed) are queued with a target
+      sample time from any non-audio thread through a lock-free FIFO
+    - The audio thread splits each block at event times, so every event lands
+      on its exact sample instead of at the next callback
+    - Fixed-size queues, nothing is allocated on the audio thread; events
+      whose time has already passed are applied at the start of the next block
+    - Gain and speed events skip the knob smoothing so they land on their
+      sample; the audio at a position event is decoded when it is scheduled,
+      one pending jump per deck (a later one replaces it)
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class DJAudioPlayer; // forward declaration
+
+class TransportScheduler
+{
+    public:
+        enum EventType { startEvent, stopEvent, positionEvent, gainEvent, speedEvent };
+
+        struct Event {
+            int64 sampleTime = 0; // on the audio clock
+            DJAudioPlayer* player = nullptr;
+            EventType type = startEvent;
+            double value = 0.0; // seconds, gain or speed ratio
+        };
+
+        TransportScheduler();
+
+        // Any thread but the audio thread - false if the queue is full
+        bool schedule(const Event& event);
+
+        // Clock position, and the same position paired with a read of the
+        // players' state, retried until no block was rendered in between
+        int64 getSampleTime() const;
+        int64 getSampleTime(const std::function<void()>& readState) const;
+        double getSampleRate() const;
+
+        // Audio thread - renders source, split at the events that fall inside the block
+        void prepareToPlay(double sampleRate);
+        void process(AudioSource& source, const AudioSourceChannelInfo& block);
+
+    private:
+        void collectNewEvents();
+        static void apply(const Event& event);
+
+        enum { maxEvents = 256 };
+
+        AbstractFifo fifo{ maxEvents };
+        Event incoming[maxEvents];
+
+        // Audio thread only, ordered by time
+        Event pending[maxEvents];
+        int numPending = 0;
+
+        std::atomic<int64> sampleTime{ 0 };
+        std::atomic<uint32> renderCount{ 0 }; // odd while a block is being rendered
+        std::atomic<double> currentSampleRate{ 44100.0 };
+        SpinLock writeLock; // several threads may schedule
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TransportScheduler)
+};
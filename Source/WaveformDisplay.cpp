@@ -10,46 +10,70 @@
 #include "WaveformDisplay.h"
 #include "DeckGUI.h"
 #include "ColourPalette.h"
+#include "ThumbnailStore.h"
+#include "MappedAudioReader.h"
 
 WaveformDisplay::WaveformDisplay(
     AudioFormatManager& formatManagerToUse,
-    AudioThumbnailCache& cacheToUse
+    ThumbnailStore& cacheToUse
 ) :
     audioThumb(1000, formatManagerToUse, cacheToUse),
     fileLoaded(false),
-    position(0)
+    position(0),
+    overview(cacheToUse)
 {
     audioThumb.addChangeListener(this);
+    overview.setThumbnail(&audioThumb);
+    overview.onReady = [this] {
+        buildPeakPyramid();
+        repaint();
+    };
 
     // FFT object 
     fft = std::make_unique<dsp::FFT>(fftOrder);
     // Hann window to prevent leakage and keep amplitude accuracy
     window = std::make_unique<dsp::WindowingFunction<float>>(fftSize, dsp::WindowingFunction<float>::hann);
+
+    // Waveform and spectrogram are drawn by the GPU, paint() only adds the overlay
+    openGLContext.setRenderer(&renderer);
+    openGLContext.attachTo(*this);
 }
 
 WaveformDisplay::~WaveformDisplay()
 {
-
+    openGLContext.detach();
 }
 
 void WaveformDisplay::paint(Graphics& g)
 {
-    g.fillAll(ColourPalette::btnColour);
+    // Until the overview is ready, the software renderer draws the thumbnail as it arrives
+    bool drawnByGPU = renderer.isActive() && peaksBuilt;
+    if (!drawnByGPU)
+        g.fillAll(ColourPalette::btnColour);
     g.setColour(ColourPalette::bgColour); // set colour for separator line
     g.drawLine(0.0f, 0.0f, getWidth(), 0.0f, 1.0f); // separator line
     g.setColour(ColourPalette::accentColour);
 
     if (fileLoaded) {
-        if (isSpectrogramEnabled && spectrogramImage.isValid()) {
-            // Draw spectogram
-            g.drawImageWithin(spectrogramImage, 0, 0, getWidth(), getHeight(), RectanglePlacement::fillDestination);
+        if (drawnByGPU) {
+            // Already drawn underneath by WaveformRenderer
+        }
+        else if (isSpectrogramEnabled && spectrogramImage.isValid()) {
+            // Draw the visible part of the spectogram
+            int imageX = (int)(viewStart * spectrogramImage.getWidth());
+            int imageWidth = jmax(1, (int)(viewLength * spectrogramImage.getWidth()));
+            g.drawImage(spectrogramImage, 0, 0, getWidth(), getHeight(), imageX, 0, imageWidth, spectrogramImage.getHeight());
+        }
+        else if (overview.isReady()) {
+            drawOverview(g);
         }
         else {
-            // Draw wave
-            audioThumb.drawChannel(g, getLocalBounds(), 0, audioThumb.getTotalLength(), 0, 1.0f);
+            // Draw the visible part of the wave
+            double length = audioThumb.getTotalLength();
+            audioThumb.drawChannel(g, getLocalBounds(), viewStart * length, (viewStart + viewLength) * length, 0, 1.0f);
         }
         g.setColour(ColourPalette::tertiaryColour);
-        g.drawRect(position * getWidth(), 0, getWidth() / 20, getHeight());
+        g.drawRect(getPlayheadBounds(position));
     }
     else {
         g.setFont(20.0f);
@@ -65,42 +89,185 @@ void WaveformDisplay::resized()
 void WaveformDisplay::loadURL(URL audioURL)
 {
     audioThumb.clear();
-    fileLoaded = audioThumb.setSource(new URLInputSource(audioURL));
+    overview.clear();
+    renderer.clear();
+    peaksBuilt = false;
+    zoom = 1.0;
+    position = 0.0;
+    updateView();
+    // Local files are cached by content, so either deck reuses the same thumbnail.
+    // The thumbnail has no source of its own, the overview's decode pass fills it
+    contentHash = 0;
+    if (audioURL.isLocalFile()) {
+        contentHash = ContentHashInputSource(audioURL.getLocalFile()).hashCode();
+        fileLoaded = audioURL.getLocalFile().existsAsFile();
+    }
+    else {
+        fileLoaded = !audioURL.isEmpty();
+    }
 
     if (fileLoaded) {
+        overview.load(audioURL, contentHash);
         if (isSpectrogramEnabled)
             generateSpectrogram(audioURL);
         repaint();
     }
 }
 
+int64 WaveformDisplay::getContentHash() const
+{
+    return contentHash;
+}
+
 void WaveformDisplay::changeListenerCallback(ChangeBroadcaster* source)
 {
+    // Thumbnail progress, only drawn until the overview takes over
+    repaint();
+}
+
+void WaveformDisplay::mouseWheelMove(const MouseEvent&, const MouseWheelDetails& wheel)
+{
+    if (!fileLoaded || wheel.deltaY == 0.0f)
+        return;
+
+    zoom = jlimit(1.0, 64.0, zoom * (wheel.deltaY > 0.0f ? 1.25 : 0.8));
+    updateView();
     repaint();
 }
 
 void WaveformDisplay::setPositionRelative(double pos)
 {
-    if (pos != position) {
+    // Zoomed views scroll with the playhead, everything moves
+    if (zoom > 1.0 && pos != position) {
         position = pos;
+        updateView();
         repaint();
+        return;
+    }
+
+    Rectangle<int> oldBounds = getPlayheadBounds(position);
+    Rectangle<int> newBounds = getPlayheadBounds(pos);
+    position = pos;
+
+    // Skip sub-pixel moves and leave the rest of the waveform alone
+    if (newBounds != oldBounds) {
+        repaint(oldBounds);
+        repaint(newBounds);
+    }
+}
+
+Rectangle<int> WaveformDisplay::getPlayheadBounds(double pos) const
+{
+    int x = (int)((pos - viewStart) / viewLength * getWidth());
+    return Rectangle<int>(x, 0, getWidth() / 20, getHeight());
+}
+
+void WaveformDisplay::updateView()
+{
+    // Whole track, or a window centred on the playhead
+    viewLength = 1.0 / zoom;
+    viewStart = zoom > 1.0 ? position - viewLength * 0.5 : 0.0;
+    renderer.setView(viewStart, viewLength);
+}
+
+void WaveformDisplay::buildPeakPyramid()
+{
+    peaksBuilt = true;
+
+    const auto& entries = overview.getEntries();
+    if (entries.empty())
+        return;
+
+    // Level 0 is the overview itself
+    std::vector<WaveformOverview::Entry> current(entries);
+    std::vector<uint32> packed, packedBands;
+    Array<WaveformRenderer::Level> levels;
+    auto pack = [](uint8 r, uint8 g, uint8 b) {
+        uint8 rgba[4] = { r, g, b, 255 };
+        uint32 entry;
+        memcpy(&entry, rgba, sizeof(entry));
+        return entry;
+    };
+
+    // Each further level merges pairs of the one before, all packed one after another
+    while (true)
+    {
+        WaveformRenderer::Level level;
+        level.offset = (int)packed.size();
+        level.count = (int)current.size();
+        levels.add(level);
+
+        for (auto& e : current) {
+            packed.push_back(pack(e.max, e.min, 0));
+            packedBands.push_back(pack(e.low, e.mid, e.high));
+        }
+
+        if (current.size() <= 64)
+            break;
+
+        for (size_t i = 0; i < current.size() / 2; ++i) {
+            const auto& a = current[i * 2];
+            const auto& b = current[i * 2 + 1];
+            current[i] = { jmax(a.max, b.max), jmin(a.min, b.min),
+                (uint8)((a.low + b.low) / 2), (uint8)((a.mid + b.mid) / 2), (uint8)((a.high + b.high) / 2) };
+        }
+        current.resize(current.size() / 2);
+    }
+
+    renderer.setPeaks(std::move(packed), std::move(packedBands), levels);
+}
+
+void WaveformDisplay::drawOverview(Graphics& g)
+{
+    // One vertical line per pixel column, merged from the overview entries it covers
+    const auto& entries = overview.getEntries();
+    int count = (int)entries.size();
+    float middle = getHeight() * 0.5f;
+    auto toY = [middle](uint8 value) { return middle - (value / 255.0f * 2.0f - 1.0f) * middle; };
+
+    for (int x = 0; x < getWidth(); ++x)
+    {
+        double start = viewStart + viewLength * x / getWidth();
+        double end = viewStart + viewLength * (x + 1) / getWidth();
+        if (start < 0.0 || start >= 1.0)
+            continue;
+
+        int first = (int)(start * count);
+        int last = jlimit(first + 1, count, (int)(end * count));
+
+        uint8 high = 0, low = 255;
+        int bandLow = 0, bandMid = 0, bandHigh = 0;
+        for (int i = first; i < last; ++i) {
+            const auto& e = entries[(size_t)i];
+            high = jmax(high, e.max);
+            low = jmin(low, e.min);
+            bandLow += e.low;
+            bandMid += e.mid;
+            bandHigh += e.high;
+        }
+
+        int n = last - first;
+        g.setColour(bandColours ? WaveformOverview::getBandColour((uint8)(bandLow / n), (uint8)(bandMid / n), (uint8)(bandHigh / n))
+            : ColourPalette::accentColour);
+        g.drawVerticalLine(x, toY(high), toY(low) + 1.0f);
     }
 }
 
 void WaveformDisplay::generateSpectrogram(URL audioURL)
 {
+    int width = getWidth();
+    int height = getHeight();
+    spectrogramMagnitudes.free();
+    if (width <= 0 || height <= 1) return;
+
     // Create empty spectrogram image
-    spectrogramImage = Image(Image::RGB, getWidth(), getHeight(), true);
+    spectrogramImage = Image(Image::ARGB, width, height, true);
     spectrogramImage.clear(spectrogramImage.getBounds(), ColourPalette::btnColour);
 
-    // Open file as input stream
-    auto input = audioURL.createInputStream(false);
-    if (!input) return;
-
     // Configure formatManager to read audio data
     AudioFormatManager formatManager;
     formatManager.registerBasicFormats();
-    auto* reader = formatManager.createReaderFor(std::move(input)); // create reader
+    std::unique_ptr<AudioFormatReader> reader(MappedAudioReader::createFor(audioURL, formatManager, true)); // uses the deck's cached blocks, does not add its own
     if (!reader) return;
 
     int numChannels = (int)reader->numChannels; // number of channels
@@ -108,11 +275,14 @@ void WaveformDisplay::generateSpectrogram(URL audioURL)
     AudioBuffer<float> buffer(numChannels, numSamples); // buffer to hold the audio data for all channels
     reader->read(&buffer, 0, numSamples, 0, true, true); // read the entire audio file into the buffer
 
+    // Columns past the end of the audio stay silent
+    spectrogramMagnitudes.calloc((size_t)width * height);
+
     // Process each vertical column of pixels in the image
-    for (int x = 0; x < getWidth(); ++x)
+    for (int x = 0; x < width; ++x)
     {
         // Calculate the start sample index for this slice
-        int startSample = (int)((x / (float)getWidth()) * (numSamples - fftSize));
+        int startSample = (int)((x / (float)width) * (numSamples - fftSize));
         if (startSample + fftSize >= numSamples) break; // stop if samples are finished
 
         // Fill FFT input data with samples
@@ -129,48 +299,95 @@ void WaveformDisplay::generateSpectrogram(URL audioURL)
         window->multiplyWithWindowingTable(fftData.data(), fftSize);
         fft->performFrequencyOnlyForwardTransform(fftData.data());
 
-        // Loop over each pixel in the column
-        for (int y = 0; y < getHeight(); ++y)
+        // Store the magnitude of each pixel's bin, flipped so low frequencies are at the bottom
+        for (int y = 0; y < height; ++y)
         {
-            int fftBin = jmap(y, 0, getHeight() - 1, 0, fftSize / 2 - 1);
-            float magnitude = fftData[fftBin]; // get magnitude of this frequency bin
+            int fftBin = y * (fftSize / 2 - 1) / (height - 1);
+            spectrogramMagnitudes[(size_t)(height - 1 - y) * width + x] = fftData[fftBin];
+        }
+    }
+
+    mapSpectrogramColours();
+}
 
-            float dB = Decibels::gainToDecibels(magnitude, -100.0f); // convert the raw magnitute to decibels
-            float level = jmap(dB, -100.0f, 0.0f, 0.0f, 1.0f); // normalize to range 0.0 - 1.0
+void WaveformDisplay::mapSpectrogramColours()
+{
+    if (!spectrogramImage.isValid() || spectrogramMagnitudes == nullptr)
+        return;
 
-            // Set the pixel colour based on level/magnitute
-            Colour colour = getSpectrogramColour(level);
-            // Flip y axis so low frequencies are at the bottom
-            spectrogramImage.setPixelAt(x, getHeight() - 1 - y, colour);
-        }
+    // Whole rows at a time, straight into the image memory
+    {
+        int width = spectrogramImage.getWidth();
+        Image::BitmapData pixels(spectrogramImage, Image::BitmapData::writeOnly);
+        for (int y = 0; y < spectrogramImage.getHeight(); ++y)
+            colourMap.mapRow(spectrogramMagnitudes + (size_t)y * width, width, reinterpret_cast<PixelARGB*>(pixels.getLinePointer(y)));
     }
 
+    renderer.setSpectrogram(spectrogramImage);
     repaint();
 }
 
+void WaveformDisplay::setSpectrogramPalette(SpectrogramColourMap::Palette palette)
+{
+    colourMap.setPalette(palette);
+    mapSpectrogramColours();
+}
+
+void WaveformDisplay::mouseDown(const MouseEvent& event)
+{
+    // Ctrl (Cmd on macOS) + drag grabs the track, a plain click leaves the deck playing
+    if (!event.mods.isPopupMenu()) {
+        scratching = fileLoaded && event.mods.isCommandDown() && onScratchStart != nullptr;
+        if (scratching)
+            onScratchStart();
+        return;
+    }
+
+    PopupMenu menu;
+    for (int i = 0; i < SpectrogramColourMap::numPalettes; ++i) {
+        auto palette = (SpectrogramColourMap::Palette)i;
+        menu.addItem(SpectrogramColourMap::getPaletteName(palette) + " palette", true, colourMap.getPalette() == palette,
+            [this, palette] { setSpectrogramPalette(palette); });
+    }
+    menu.addSeparator();
+    menu.addItem("Colour waveform by frequency", true, bandColours, [this] { setBandColoursEnabled(!bandColours); });
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(this));
+}
+
+
+void WaveformDisplay::mouseDrag(const MouseEvent& event)
+{
+    if (!scratching || onScratchMove == nullptr)
+        return;
+
+    // Like a platter: 5 ms per pixel, finer when zoomed in so the waveform follows the hand
+    double viewSeconds = audioThumb.getTotalLength() * viewLength;
+    double secondsPerPixel = jmin(0.005, viewSeconds / jmax(1, getWidth()));
+    onScratchMove(event.getDistanceFromDragStartX() * secondsPerPixel);
+}
+
+void WaveformDisplay::mouseUp(const MouseEvent&)
+{
+    if (scratching && onScratchEnd != nullptr)
+        onScratchEnd();
+    scratching = false;
+}
 
 void WaveformDisplay::setSpectrogramEnabled(bool enabled) 
 {
     isSpectrogramEnabled = enabled;
+    renderer.setShowSpectrogram(enabled);
     repaint();
 }
 
-bool WaveformDisplay::getSpectrogramEnabled() const 
+void WaveformDisplay::setBandColoursEnabled(bool enabled)
 {
-    return isSpectrogramEnabled;
+    bandColours = enabled;
+    renderer.setShowBands(enabled);
+    repaint();
 }
 
-Colour WaveformDisplay::getSpectrogramColour(float level)
+bool WaveformDisplay::getSpectrogramEnabled() const 
 {
-    // Start from lower magnitute
-    if (level < 0.2f)
-        return ColourPalette::btnColour;
-    if (level < 0.4f)
-        return ColourPalette::primaryColour;
-    if (level < 0.6f)
-        return ColourPalette::tertiaryColour;
-    if (level < 0.8f)
-        return ColourPalette::secondaryColour;
-    // Set yellow as default for all the higher levels
-    return ColourPalette::accentColour;
+    return isSpectrogramEnabled;
 }
@@ -6,8 +6,17 @@
     ### Show the audio visually ###
 
     - Visualizes the waveform of an audio track
-    - AudioThumbnail to render waveforms
-    - setPositionRelative moves the playhead indicator
+    - AudioThumbnail to render waveforms until the WaveformOverview is ready,
+      then peaks and low/mid/high colours come from the overview; the
+      thumbnail is filled by the overview's decode pass, not a scan of its own
+    - setPositionRelative moves the playhead indicator, only the old and new
+      playhead areas are repainted
+    - Drawn through OpenGL (WaveformRenderer) when a context is available,
+      with the software renderer as fallback
+    - Mouse wheel zooms in, zoomed views scroll with the playhead
+    - Spectrogram pixels come from SpectrogramColourMap, right-click picks the
+      palette or turns the frequency colours off
+    - Ctrl/Cmd + drag scratches: reports how far the track was moved since it was grabbed
 
   ==============================================================================
 */
@@ -15,21 +24,40 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "WaveformRenderer.h"
+#include "SpectrogramColourMap.h"
+#include "WaveformOverview.h"
+#include "ThumbnailStore.h"
 
 
 class WaveformDisplay : public Component, public ChangeListener
 {
     public:
-        WaveformDisplay(AudioFormatManager& formatManagerToUse, AudioThumbnailCache& cacheToUse);
+        WaveformDisplay(AudioFormatManager& formatManagerToUse, ThumbnailStore& cacheToUse);
         ~WaveformDisplay();
 
         void paint(Graphics&) override;
         void resized() override;
 
         void changeListenerCallback(ChangeBroadcaster* source) override;
+        void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
+        void mouseDown(const MouseEvent& event) override;
+        void mouseDrag(const MouseEvent& event) override;
+        void mouseUp(const MouseEvent& event) override;
+
+        // Scratch gestures, the offset is in seconds from the grab position
+        std::function<void()> onScratchStart;
+        std::function<void(double)> onScratchMove;
+        std::function<void()> onScratchEnd;
 
         void loadURL(URL audioURL);
 
+        // Thumbnail cache key of the loaded file, 0 for remote URLs
+        int64 getContentHash() const;
+
+        // Area covered by the playhead at the given position
+        Rectangle<int> getPlayheadBounds(double pos) const;
+
         // Set the relative position of the playhead
         void setPositionRelative(double pos);
 
@@ -37,17 +65,45 @@ class WaveformDisplay : public Component, public ChangeListener
         void generateSpectrogram(URL audioURL); // function to generate spectogram image
         void setSpectrogramEnabled(bool enabled); // setter
         bool getSpectrogramEnabled() const; // getter
-        Colour getSpectrogramColour(float level); // find colour
+        void setSpectrogramPalette(SpectrogramColourMap::Palette palette);
+
+        // Waveform coloured by low/mid/high content, on by default
+        void setBandColoursEnabled(bool enabled);
+
+        // FFT size, shared with the live SpectrumAnalyzer
+        enum { fftOrder = 10, fftSize = 1 << fftOrder };
 
     private:
         AudioThumbnail audioThumb;
         bool fileLoaded;
         double position;
+        int64 contentHash = 0;
+
+        // Visible part of the track, relative to its length
+        void updateView();
+        double zoom = 1.0;
+        double viewStart = 0.0;
+        double viewLength = 1.0;
+
+        bool scratching = false;
+
+        // Peaks and band levels in one decode pass, cached with the thumbnails
+        WaveformOverview overview;
+        bool bandColours = true;
+        void drawOverview(Graphics& g);
+
+        // GPU drawing, fed from the overview once it is ready
+        void buildPeakPyramid();
+        bool peaksBuilt = false;
+        OpenGLContext openGLContext;
+        WaveformRenderer renderer{ openGLContext };
 
         // Spectrogram related
         bool isSpectrogramEnabled = false;
         Image spectrogramImage;
-        enum { fftOrder = 10, fftSize = 1 << fftOrder }; 
+        SpectrogramColourMap colourMap;
+        HeapBlock<float> spectrogramMagnitudes; // one per pixel, row by row, kept for palette changes
+        void mapSpectrogramColours();
         std::unique_ptr<dsp::FFT> fft; // FFT object for frequency analysis
         std::unique_ptr<dsp::WindowingFunction<float>> window;
         std::vector<float> fftData = std::vector<float>(fftSize * 2, 0.0f); // buffer to hold FFT data
@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    WaveformOverview.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformOverview.h"
+#include "MappedAudioReader.h"
+
+namespace
+{
+    // Keeps overview entries apart from the thumbnails stored under the plain content hash
+    const int64 cacheKeySalt = 0x4f76657276696577; // "Overview"
+}
+
+WaveformOverview::WaveformOverview(ThumbnailStore& storeToUse) :
+    Thread("Waveform overview"),
+    store(storeToUse)
+{
+    formatManager.registerBasicFormats();
+    startThread(Thread::Priority::low);
+}
+
+WaveformOverview::~WaveformOverview()
+{
+    cancelPendingUpdate();
+    stopThread(4000);
+}
+
+void WaveformOverview::load(const URL& url, int64 contentHash)
+{
+    entries.clear();
+    ready = false;
+
+    {
+        const ScopedLock sl(jobLock);
+        jobURL = url;
+        jobHash = contentHash;
+        ++jobId;
+    }
+    notify();
+}
+
+void WaveformOverview::clear()
+{
+    load(URL(), 0);
+}
+
+void WaveformOverview::setThumbnail(AudioThumbnail* thumbnailToFill)
+{
+    thumbnail = thumbnailToFill;
+}
+
+bool WaveformOverview::isReady() const
+{
+    return ready;
+}
+
+const std::vector<WaveformOverview::Entry>& WaveformOverview::getEntries() const
+{
+    return entries;
+}
+
+Colour WaveformOverview::getBandColour(uint8 low, uint8 mid, uint8 high)
+{
+    // The louder band sets the hue, brightness is left to the waveform height
+    float strongest = (float)jmax(low, mid, high, (uint8)1);
+    return Colour::fromFloatRGBA(low / strongest, mid / strongest, high / strongest, 1.0f);
+}
+
+void WaveformOverview::run()
+{
+    int doneJob = 0;
+
+    while (!threadShouldExit())
+    {
+        URL url;
+        int64 hash;
+        int job = jobId;
+        if (job == doneJob) {
+            wait(-1);
+            continue;
+        }
+        {
+            const ScopedLock sl(jobLock);
+            url = jobURL;
+            hash = jobHash;
+            job = jobId;
+        }
+        doneJob = job;
+
+        if (url.isEmpty())
+            continue;
+
+        // Seen before - straight from the cache, the thumbnail too
+        std::vector<Entry> result;
+        MemoryBlock data;
+        int64 key = hash ^ cacheKeySalt;
+        if (hash != 0 && store.findData(key, data) && data.getSize() % sizeof(Entry) == 0)
+        {
+            result.resize(data.getSize() / sizeof(Entry));
+            data.copyTo(result.data(), 0, data.getSize());
+
+            // An evicted thumbnail is not rebuilt, the overview draws instead; it only needs the length
+            if (thumbnail != nullptr && !store.loadThumb(*thumbnail, hash)) {
+                std::unique_ptr<AudioFormatReader> reader(MappedAudioReader::createFor(url, formatManager, true));
+                if (reader != nullptr)
+                    thumbnail->reset(jmax(1, (int)reader->numChannels), reader->sampleRate, reader->lengthInSamples);
+            }
+        }
+        else
+        {
+            std::unique_ptr<AudioFormatReader> reader(MappedAudioReader::createFor(url, formatManager, true));
+            if (reader == nullptr)
+                continue;
+
+            if (thumbnail != nullptr)
+                thumbnail->reset(jmax(1, (int)reader->numChannels), reader->sampleRate, reader->lengthInSamples);
+
+            result = compute(*reader, job);
+            if (isStale(job))
+                continue;
+
+            if (hash != 0 && !result.empty()) {
+                store.storeData(key, MemoryBlock(result.data(), result.size() * sizeof(Entry)));
+                if (thumbnail != nullptr)
+                    store.storeThumb(*thumbnail, hash);
+            }
+        }
+
+        {
+            const ScopedLock sl(jobLock);
+            finished = std::move(result);
+            finishedJob = job;
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+void WaveformOverview::handleAsyncUpdate()
+{
+    {
+        const ScopedLock sl(jobLock);
+        // A newer track was loaded meanwhile
+        if (finishedJob != jobId)
+            return;
+        entries = std::move(finished);
+        finished.clear();
+    }
+    ready = true;
+
+    if (onReady != nullptr)
+        onReady();
+}
+
+std::vector<WaveformOverview::Entry> WaveformOverview::compute(AudioFormatReader& reader, int job)
+{
+    using Register = dsp::SIMDRegister<float>;
+    const int lanes = (int)Register::size();
+    const int warmUp = 256; // filter settling before each entry, lanes start from silence
+
+    int64 length = reader.lengthInSamples;
+    int numEntries = (int)((length + samplesPerEntry - 1) / samplesPerEntry);
+    std::vector<Entry> result((size_t)numEntries);
+    if (numEntries == 0 || reader.sampleRate <= 0.0)
+        return result;
+
+    const float lowCoeff = (float)(1.0 - std::exp(-MathConstants<double>::twoPi * 200.0 / reader.sampleRate));
+    const float midCoeff = (float)(1.0 - std::exp(-MathConstants<double>::twoPi * 2500.0 / reader.sampleRate));
+
+    // Each pass covers one entry per lane
+    int passSamples = warmUp + lanes * samplesPerEntry;
+    int numChannels = jmax(1, (int)reader.numChannels);
+    AudioBuffer<float> chunk(numChannels, passSamples);
+    HeapBlock<float> mono((size_t)passSamples);
+    alignas(64) float lows[16], mids[16], highs[16], maxs[16], mins[16];
+
+    // Lane-major copy of each pass: the lanes of one step sit side by side, 64-byte aligned
+    int steps = warmUp + samplesPerEntry;
+    HeapBlock<float> laneMemory((size_t)(steps * lanes + 16));
+    auto* laneSamples = reinterpret_cast<float*>((reinterpret_cast<pointer_sized_int>(laneMemory.get()) + 63) & ~(pointer_sized_int)63);
+
+    auto toByte = [](float value) { return (uint8)jlimit(0, 255, roundToInt(value * 255.0f)); };
+
+    for (int first = 0; first < numEntries; first += lanes)
+    {
+        if (isStale(job) || threadShouldExit())
+            return {};
+
+        // Samples before the start and past the end come back as silence
+        int64 start = (int64)first * samplesPerEntry - warmUp;
+        reader.read(&chunk, 0, passSamples, start, true, true);
+
+        // The thumbnail gets the same samples, less the warm-up, so the file is read once
+        if (thumbnail != nullptr) {
+            int64 entryStart = (int64)first * samplesPerEntry;
+            thumbnail->addBlock(entryStart, chunk, warmUp, (int)jmin((int64)lanes * samplesPerEntry, length - entryStart));
+        }
+
+        FloatVectorOperations::copy(mono, chunk.getReadPointer(0), passSamples);
+        for (int ch = 1; ch < numChannels; ++ch)
+            FloatVectorOperations::add(mono, chunk.getReadPointer(ch), passSamples);
+        FloatVectorOperations::multiply(mono, 1.0f / numChannels, passSamples);
+
+        // Lane k filters entry first + k, including its own warm-up; each lane's samples are read in one contiguous run
+        for (int k = 0; k < lanes; ++k)
+        {
+            const float* source = mono + k * samplesPerEntry;
+            for (int i = 0; i < steps; ++i)
+                laneSamples[i * lanes + k] = source[i];
+        }
+
+        Register lowState = Register::expand(0.0f), midState = Register::expand(0.0f);
+        Register lowEnergy = Register::expand(0.0f), midEnergy = Register::expand(0.0f), highEnergy = Register::expand(0.0f);
+        Register peakMax = Register::expand(-1.0f), peakMin = Register::expand(1.0f);
+
+        for (int i = 0; i < steps; ++i)
+        {
+            Register in = Register::fromRawArray(laneSamples + i * lanes);
+
+            lowState += (in - lowState) * lowCoeff;
+            midState += (in - midState) * midCoeff;
+            if (i < warmUp)
+                continue;
+
+            Register mid = midState - lowState;
+            Register high = in - midState;
+            lowEnergy += lowState * lowState;
+            midEnergy += mid * mid;
+            highEnergy += high * high;
+            peakMax = Register::max(peakMax, in);
+            peakMin = Register::min(peakMin, in);
+        }
+
+        lowEnergy.copyToRawArray(lows);
+        midEnergy.copyToRawArray(mids);
+        highEnergy.copyToRawArray(highs);
+        peakMax.copyToRawArray(maxs);
+        peakMin.copyToRawArray(mins);
+
+        auto level = [&toByte](float energy) { return toByte(std::sqrt(energy / samplesPerEntry) * MathConstants<float>::sqrt2); };
+        for (int k = 0; k < jmin(lanes, numEntries - first); ++k)
+        {
+            Entry& entry = result[(size_t)(first + k)];
+            entry.max = toByte(maxs[k] * 0.5f + 0.5f);
+            entry.min = toByte(mins[k] * 0.5f + 0.5f);
+            entry.low = level(lows[k]);
+            entry.mid = level(mids[k]);
+            entry.high = level(highs[k]);
+        }
+    }
+
+    return result;
+}
+
+bool WaveformOverview::isStale(int job) const
+{
+    return job != jobId.load();
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    WaveformOverview.h
+
+    ### Waveform overview coloured by frequency content ###
+
+    - One streaming decode pass per track gives, for every 1024 samples, the
+      peaks and the low/mid/high band levels
+    - The bands come from two one-pole low-pass filters (200 Hz and 2.5 kHz),
+      run on SIMDRegister lanes over several entries at once
+    - Computed on a background thread, stored in the ThumbnailStore next to
+      the thumbnail, so a track seen before costs no decoding at all
+    - The same decode pass fills the display's AudioThumbnail, which is only
+      drawn until the overview is ready, so a new file is read once
+    - Far cheaper than a spectrogram, no FFT involved
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ThumbnailStore.h"
+
+class WaveformOverview : private Thread,
+    private AsyncUpdater
+{
+    public:
+        // Peaks map -1..1 to 0..255, band levels (RMS, full scale sine = 255) 0..1 to 0..255
+        struct Entry {
+            uint8 max, min;
+            uint8 low, mid, high;
+        };
+
+        enum { samplesPerEntry = 1024 };
+
+        WaveformOverview(ThumbnailStore& storeToUse);
+        ~WaveformOverview() override;
+
+        // Message thread - starts on the new track, the old entries are dropped.
+        // contentHash is the thumbnail key of the file, 0 skips the cache
+        void load(const URL& url, int64 contentHash);
+        void clear();
+
+        // Message thread, before the first load - filled from the overview's decode pass, or
+        // from the store when the overview is cached there; the thumbnail must outlive this
+        void setThumbnail(AudioThumbnail* thumbnailToFill);
+
+        // Message thread
+        bool isReady() const;
+        const std::vector<Entry>& getEntries() const;
+        std::function<void()> onReady;
+
+        // Red for bass, green for mids, blue for highs
+        static Colour getBandColour(uint8 low, uint8 mid, uint8 high);
+
+    private:
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        std::vector<Entry> compute(AudioFormatReader& reader, int job);
+        bool isStale(int job) const;
+
+        ThumbnailStore& store;
+        AudioFormatManager formatManager;
+        AudioThumbnail* thumbnail = nullptr; // filled by the worker
+
+        // Handed between the message thread and the worker
+        CriticalSection jobLock;
+        URL jobURL;
+        int64 jobHash = 0;
+        std::atomic<int> jobId{ 0 };
+        std::vector<Entry> finished;
+        int finishedJob = -1;
+
+        // Message thread copy
+        std::vector<Entry> entries;
+        bool ready = false;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformOverview)
+};
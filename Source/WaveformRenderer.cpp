@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+    WaveformRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformRenderer.h"
+#include "ColourPalette.h"
+
+using namespace juce::gl;
+
+namespace
+{
+    // Full-viewport quad, uv runs 0..1 across it
+    const char* vertexShader =
+        "attribute vec2 position;\n"
+        "varying " JUCE_MEDIUMP " vec2 uv;\n"
+        "void main()\n"
+        "{\n"
+        "    uv = position * 0.5 + 0.5;\n"
+        "    gl_Position = vec4(position, 0.0, 1.0);\n"
+        "}\n";
+
+    // Looks up the peak entry for this column and fills between min and max,
+    // in the band colour when bands are shown (same hue rule as WaveformOverview::getBandColour)
+    const char* peakFragmentShader =
+        "varying " JUCE_MEDIUMP " vec2 uv;\n"
+        "uniform sampler2D peaks;\n"
+        "uniform sampler2D bands;\n"
+        "uniform " JUCE_LOWP " float useBands;\n"
+        "uniform " JUCE_HIGHP " float viewStart;\n"
+        "uniform " JUCE_HIGHP " float viewLength;\n"
+        "uniform " JUCE_HIGHP " float levelOffset;\n"
+        "uniform " JUCE_HIGHP " float levelCount;\n"
+        "uniform " JUCE_HIGHP " vec2 textureSize;\n"
+        "uniform " JUCE_LOWP " vec4 waveColour;\n"
+        "uniform " JUCE_LOWP " vec4 backgroundColour;\n"
+        "void main()\n"
+        "{\n"
+        "    " JUCE_HIGHP " float t = viewStart + uv.x * viewLength;\n"
+        "    if (t < 0.0 || t > 1.0) { gl_FragColor = backgroundColour; return; }\n"
+        "    " JUCE_HIGHP " float index = levelOffset + floor(t * (levelCount - 1.0) + 0.5);\n"
+        "    " JUCE_HIGHP " vec2 texel = vec2((mod(index, textureSize.x) + 0.5) / textureSize.x,\n"
+        "                                    (floor(index / textureSize.x) + 0.5) / textureSize.y);\n"
+        "    " JUCE_MEDIUMP " vec4 peak = texture2D(peaks, texel);\n"
+        "    " JUCE_MEDIUMP " float y = uv.y * 2.0 - 1.0;\n"
+        "    bool inside = y <= peak.r * 2.0 - 1.0 && y >= peak.g * 2.0 - 1.0;\n"
+        "    " JUCE_MEDIUMP " vec3 band = texture2D(bands, texel).rgb;\n"
+        "    " JUCE_MEDIUMP " vec4 bandColour = vec4(band / max(max(band.r, band.g), max(band.b, 1.0 / 255.0)), 1.0);\n"
+        "    gl_FragColor = inside ? (useBands > 0.5 ? bandColour : waveColour) : backgroundColour;\n"
+        "}\n";
+
+    // Spectrogram image, stretched over the visible range
+    const char* imageFragmentShader =
+        "varying " JUCE_MEDIUMP " vec2 uv;\n"
+        "uniform sampler2D image;\n"
+        "uniform " JUCE_HIGHP " float viewStart;\n"
+        "uniform " JUCE_HIGHP " float viewLength;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = texture2D(image, vec2(viewStart + uv.x * viewLength, uv.y));\n"
+        "}\n";
+
+    std::unique_ptr<OpenGLShaderProgram> compile(OpenGLContext& context, const char* fragmentShader)
+    {
+        auto program = std::make_unique<OpenGLShaderProgram>(context);
+        if (program->addVertexShader(OpenGLHelpers::translateVertexShaderToV3(vertexShader))
+            && program->addFragmentShader(OpenGLHelpers::translateFragmentShaderToV3(fragmentShader))
+            && program->link())
+            return program;
+
+        DBG("WaveformRenderer shader error: " + program->getLastError());
+        return nullptr;
+    }
+
+    void setColour(OpenGLShaderProgram& program, const char* name, Colour colour)
+    {
+        program.setUniform(name, colour.getFloatRed(), colour.getFloatGreen(), colour.getFloatBlue(), colour.getFloatAlpha());
+    }
+}
+
+WaveformRenderer::WaveformRenderer(OpenGLContext& contextToUse) : context(contextToUse)
+{
+
+}
+
+WaveformRenderer::~WaveformRenderer()
+{
+
+}
+
+void WaveformRenderer::setPeaks(std::vector<uint32> packedPeaks, std::vector<uint32> packedBands, const Array<Level>& newLevels)
+{
+    {
+        const ScopedLock sl(dataLock);
+        pendingPeaks = std::move(packedPeaks);
+        pendingBands = std::move(packedBands);
+        pendingLevels = newLevels;
+        peaksChanged = true;
+    }
+    context.triggerRepaint();
+}
+
+void WaveformRenderer::setSpectrogram(const Image& image)
+{
+    {
+        const ScopedLock sl(dataLock);
+        pendingSpectrogram = image.createCopy();
+        spectrogramChanged = true;
+    }
+    context.triggerRepaint();
+}
+
+void WaveformRenderer::clear()
+{
+    setPeaks({}, {}, {});
+    setSpectrogram({});
+}
+
+void WaveformRenderer::setView(double start, double length)
+{
+    if (start == viewStart && length == viewLength)
+        return;
+
+    viewStart = start;
+    viewLength = length;
+    context.triggerRepaint();
+}
+
+void WaveformRenderer::setShowSpectrogram(bool shouldShow)
+{
+    showSpectrogram = shouldShow;
+    context.triggerRepaint();
+}
+
+void WaveformRenderer::setShowBands(bool shouldShow)
+{
+    showBands = shouldShow;
+    context.triggerRepaint();
+}
+
+bool WaveformRenderer::isActive() const
+{
+    return active.load();
+}
+
+void WaveformRenderer::newOpenGLContextCreated()
+{
+    peakShader = compile(context, peakFragmentShader);
+    imageShader = compile(context, imageFragmentShader);
+
+    const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenBuffers(1, &quadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    glGenTextures(1, &peakTexture);
+    glGenTextures(1, &bandTexture);
+
+    // Data set before the context existed still has to go up
+    {
+        const ScopedLock sl(dataLock);
+        peaksChanged = true;
+        spectrogramChanged = true;
+    }
+
+    active = peakShader != nullptr && imageShader != nullptr;
+}
+
+void WaveformRenderer::renderOpenGL()
+{
+    if (!active)
+        return;
+
+    uploadPendingData();
+
+    OpenGLHelpers::clear(ColourPalette::btnColour);
+
+    auto* target = context.getTargetComponent();
+    if (target == nullptr || levels.isEmpty())
+        return;
+
+    bool drawSpectrogram = showSpectrogram && hasSpectrogram;
+    OpenGLShaderProgram& program = drawSpectrogram ? *imageShader : *peakShader;
+    program.use();
+    program.setUniform("viewStart", (GLfloat)viewStart.load());
+    program.setUniform("viewLength", (GLfloat)viewLength.load());
+
+    glActiveTexture(GL_TEXTURE0);
+    if (drawSpectrogram)
+    {
+        spectrogramTexture.bind();
+        program.setUniform("image", 0);
+    }
+    else
+    {
+        int pixelWidth = roundToInt(target->getWidth() * context.getRenderingScale());
+        const Level& level = chooseLevel(pixelWidth, viewLength);
+
+        glBindTexture(GL_TEXTURE_2D, peakTexture);
+        program.setUniform("peaks", 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, bandTexture);
+        program.setUniform("bands", 1);
+        program.setUniform("useBands", showBands && hasBands ? 1.0f : 0.0f);
+        glActiveTexture(GL_TEXTURE0);
+        program.setUniform("levelOffset", (GLfloat)level.offset);
+        program.setUniform("levelCount", (GLfloat)level.count);
+        program.setUniform("textureSize", (GLfloat)textureWidth, (GLfloat)peakTextureRows);
+        setColour(program, "waveColour", ColourPalette::accentColour);
+        setColour(program, "backgroundColour", ColourPalette::btnColour);
+    }
+
+    // One quad per frame
+    GLuint positionAttribute = (GLuint)glGetAttribLocation(program.getProgramID(), "position");
+    glBindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glEnableVertexAttribArray(positionAttribute);
+    glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(positionAttribute);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void WaveformRenderer::openGLContextClosing()
+{
+    active = false;
+    peakShader.reset();
+    imageShader.reset();
+    spectrogramTexture.release();
+    glDeleteTextures(1, &peakTexture);
+    glDeleteTextures(1, &bandTexture);
+    glDeleteBuffers(1, &quadBuffer);
+    peakTexture = 0;
+    bandTexture = 0;
+    quadBuffer = 0;
+}
+
+void WaveformRenderer::uploadPendingData()
+{
+    const ScopedLock sl(dataLock);
+
+    if (peaksChanged)
+    {
+        peaksChanged = false;
+        levels = pendingLevels;
+
+        // Long levels wrap over several texture rows
+        peakTextureRows = jmax(1, ((int)pendingPeaks.size() + textureWidth - 1) / textureWidth);
+        hasBands = !pendingBands.empty();
+        uploadEntries(peakTexture, pendingPeaks);
+        uploadEntries(bandTexture, pendingBands);
+    }
+
+    if (spectrogramChanged)
+    {
+        spectrogramChanged = false;
+        hasSpectrogram = pendingSpectrogram.isValid();
+        if (hasSpectrogram)
+            spectrogramTexture.loadImage(pendingSpectrogram);
+        else
+            spectrogramTexture.release();
+    }
+}
+
+void WaveformRenderer::uploadEntries(GLuint texture, std::vector<uint32>& data)
+{
+    data.resize((size_t)(peakTextureRows * textureWidth), 0);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, peakTextureRows, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+}
+
+const WaveformRenderer::Level& WaveformRenderer::chooseLevel(int pixelWidth, double length) const
+{
+    // Coarsest level that still has an entry for every pixel column
+    for (int i = levels.size() - 1; i > 0; --i) {
+        if (levels.getReference(i).count * length >= pixelWidth)
+            return levels.getReference(i);
+    }
+    return levels.getReference(0);
+}
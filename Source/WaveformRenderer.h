@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    WaveformRenderer.h
+
+    ### OpenGL drawing for WaveformDisplay ###
+
+    - Peak pyramid and spectrogram are uploaded as textures once per track
+    - Every frame is one textured quad, the shader picks the peaks for each
+      pixel column, so zooming and scrolling cost no CPU work
+    - The view (start and length, relative to the track) can change at any time
+    - An optional band texture with the same layout colours each column by
+      its low/mid/high levels
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class WaveformRenderer : public OpenGLRenderer
+{
+    public:
+        // One level of the pyramid inside the packed peak data
+        struct Level {
+            int offset = 0; // first entry
+            int count = 0;
+        };
+
+        WaveformRenderer(OpenGLContext& contextToUse);
+        ~WaveformRenderer() override;
+
+        // Message thread - RGBA per entry: R = max, G = min, both mapped from -1..1 to 0..255.
+        // packedBands is empty or matches packedPeaks entry for entry: R = low, G = mid, B = high
+        void setPeaks(std::vector<uint32> packedPeaks, std::vector<uint32> packedBands, const Array<Level>& levels);
+        void setSpectrogram(const Image& image);
+        void clear();
+
+        // Relative range of the track that fills the component
+        void setView(double start, double length);
+        void setShowSpectrogram(bool shouldShow);
+        void setShowBands(bool shouldShow);
+
+        // False until the context is up and the shaders compiled
+        bool isActive() const;
+
+        void newOpenGLContextCreated() override;
+        void renderOpenGL() override;
+        void openGLContextClosing() override;
+
+    private:
+        void uploadPendingData();
+        void uploadEntries(gl::GLuint texture, std::vector<uint32>& data);
+        const Level& chooseLevel(int pixelWidth, double viewLength) const;
+
+        OpenGLContext& context;
+
+        std::unique_ptr<OpenGLShaderProgram> peakShader;
+        std::unique_ptr<OpenGLShaderProgram> imageShader;
+        gl::GLuint quadBuffer = 0;
+        gl::GLuint peakTexture = 0;
+        gl::GLuint bandTexture = 0;
+        OpenGLTexture spectrogramTexture;
+
+        enum { textureWidth = 4096 }; // peak entries per texture row
+
+        // Handed over from the message thread, uploaded on the next frame and
+        // kept for when the context is recreated
+        CriticalSection dataLock;
+        std::vector<uint32> pendingPeaks;
+        std::vector<uint32> pendingBands;
+        Array<Level> pendingLevels;
+        Image pendingSpectrogram;
+        bool peaksChanged = false;
+        bool spectrogramChanged = false;
+
+        // GL thread copies
+        Array<Level> levels;
+        int peakTextureRows = 0;
+        bool hasBands = false;
+        bool hasSpectrogram = false;
+
+        std::atomic<double> viewStart{ 0.0 };
+        std::atomic<double> viewLength{ 1.0 };
+        std::atomic<bool> showSpectrogram{ false };
+        std::atomic<bool> showBands{ true };
+        std::atomic<bool> active{ false };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformRenderer)
+};